@@ -0,0 +1,437 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "broadcast_buffer.h"
+#include "shared_memory.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define CACHE_LINE_SIZE 64
+
+#define __cache_aligned __attribute__((aligned(CACHE_LINE_SIZE)))
+
+#define __var_name_concat(name, line) name##line
+
+#define __var_name(name, line) __var_name_concat(name, line)
+
+#define __unique_var(name) __var_name(name, __LINE__)
+
+#define __cache_line_padding char __unique_var(cache_line_padding)[0] __cache_aligned
+
+#ifndef likely
+#define likely(x) (__builtin_expect(!!(x), 1))
+#endif
+
+#ifndef unlikely
+#define unlikely(x) (__builtin_expect(!!(x), 0))
+#endif
+
+/**
+ * 无损模式下读者登记的游标，各占一个缓存行
+ */
+struct broadcast_buffer_cursor {
+    _Atomic size_t pos;  ///< 读位置，由读者以 release 语义写入
+    _Atomic pid_t pid;   ///< 占用游标的进程，0 表示空闲
+} __cache_aligned;
+
+/**
+ * 生产者的写位置集中在一个缓存行，读者只读取此缓存行；
+ * 有损模式下生产者先推进 intent 再写入数据，读者复制数据后据此判断是否被覆盖
+ */
+struct broadcast_buffer_header {
+    _Atomic size_t w;       ///< 已提交记录的末尾
+    _Atomic size_t intent;  ///< 正在写入的记录的末尾，仅有损模式使用
+    _Atomic size_t latest;  ///< 最近一条已提交记录的起始位置，被覆盖的读者跳到此处
+    size_t min_cache;       ///< 最慢读者位置的缓存，仅生产者使用
+    __cache_line_padding;   ///< 缓存行对齐填充
+    size_t capacity;        ///< 缓冲区容量
+    size_t max_readers;     ///< 游标数
+    long page_mask;         ///< 页掩码
+    int flag;               ///< 标志
+    char name[64];          ///< 共享内存对象名称
+    __cache_line_padding;   ///< 缓存行对齐填充
+    struct broadcast_buffer_cursor cursors[0];  ///< 游标
+};
+
+/**
+ * 记录头，与 circular_buffer 的记录格式相同
+ */
+struct broadcast_buffer_record {
+    _Atomic int32_t length;  ///< 记录长度，含记录头
+    int32_t type;            ///< 记录类型
+};
+
+#define RECORD_ALIGNMENT sizeof(struct broadcast_buffer_record)
+
+struct broadcast_reader {
+    struct broadcast_buffer_header *header;  ///< 广播缓冲区
+    struct broadcast_buffer_cursor *cursor;  ///< 无损模式下登记的游标，有损模式为空
+    size_t pos;                              ///< 读位置
+    size_t lost;                             ///< 累计丢失的字节数
+    char *scratch;                           ///< 有损模式下复制记录的私有缓冲区
+    size_t scratch_size;                     ///< 私有缓冲区大小
+};
+
+static inline size_t record_aligned(size_t length) {
+    return (length + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+}
+
+static inline size_t aligned_header_size(size_t max_readers, long page_mask) {
+    size_t const size = sizeof(struct broadcast_buffer_header) +
+                        max_readers * sizeof(struct broadcast_buffer_cursor);
+    return (size + page_mask) & (~page_mask);
+}
+
+static inline char *buffer_start(struct broadcast_buffer_header *bb) {
+    return (char *)bb + aligned_header_size(bb->max_readers, bb->page_mask);
+}
+
+static inline struct broadcast_buffer_record *record_at(struct broadcast_buffer_header *bb,
+                                                        size_t pos) {
+    return (struct broadcast_buffer_record *)(buffer_start(bb) + (pos & (bb->capacity - 1)));
+}
+
+static inline size_t mapping_size(struct broadcast_buffer_header *bb) {
+    return aligned_header_size(bb->max_readers, bb->page_mask) + bb->capacity * 2;
+}
+
+// 最慢的登记读者的位置，没有读者时为写位置
+static size_t slowest_reader(struct broadcast_buffer_header *bb, size_t w) {
+    size_t lag = 0;
+    for (size_t i = 0; i < bb->max_readers; ++i) {
+        struct broadcast_buffer_cursor *cursor = &bb->cursors[i];
+        if (!atomic_load_explicit(&cursor->pid, memory_order_acquire)) continue;
+        size_t const distance = w - atomic_load_explicit(&cursor->pos, memory_order_acquire);
+        if (distance > lag) lag = distance;
+    }
+
+    return w - lag;
+}
+
+broadcast_buffer *broadcast_buffer_create(const char *name,
+                                          size_t capacity,
+                                          size_t max_readers,
+                                          int const flag) {
+    assert(capacity > 0);
+    int const anonymous = name ? 0 : 1;
+    int shmfd;
+    if (anonymous)
+        shmfd = -1;
+    else {
+        // 创建共享内存对象
+        shmfd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP);
+        if (shmfd < 0) return NULL;
+    }
+
+    struct broadcast_buffer_header *header =
+        broadcast_buffer_fcreate(shmfd, capacity, max_readers, flag);
+    if unlikely (!header) {
+        int const err = errno;
+        if (!anonymous) {
+            close(shmfd);
+            shm_unlink(name);
+        }
+        errno = err;
+        return NULL;
+    }
+
+    if likely (!anonymous) {
+        // 保存共享内存对象名称
+        strcpy(header->name, name);
+        close(shmfd);
+    }
+
+    return header;
+}
+
+broadcast_buffer *broadcast_buffer_fcreate(int const shmfd,
+                                           size_t capacity,
+                                           size_t max_readers,
+                                           int const flag) {
+    // 获取系统页大小
+    long const page_mask = sysconf(_SC_PAGESIZE) - 1;
+
+    // 容量向上对齐到 2 的幂，不小于页大小；记录长度为 32 位
+    size_t aligned = (size_t)page_mask + 1;
+    while (aligned < capacity) aligned <<= 1;
+    capacity = aligned;
+    if unlikely (capacity > INT32_MAX) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // 有损模式不使用游标
+    if (!(flag & BROADCAST_BUFFER_LOSSLESS)) max_readers = 0;
+
+    // 计算对齐到系统页大小的头部大小
+    size_t const aligned_head_size = aligned_header_size(max_readers, page_mask);
+
+    // 设置共享内存大小
+    if unlikely (shmfd >= 0 && ftruncate(shmfd, capacity + aligned_head_size) < 0) {
+        return NULL;
+    }
+
+    // 映射共享内存
+    struct broadcast_buffer_header *header =
+        shared_memory_map_mirrored(shmfd, aligned_head_size, capacity, page_mask + 1, 0);
+    if unlikely (!header) return NULL;
+
+    // 初始共享内存头部
+    atomic_init(&header->w, 0);
+    atomic_init(&header->intent, 0);
+    atomic_init(&header->latest, 0);
+    header->min_cache = 0;
+    header->capacity = capacity;
+    header->max_readers = max_readers;
+    header->page_mask = page_mask;
+    header->flag = flag;
+    header->name[0] = 0;
+    for (size_t i = 0; i < max_readers; ++i) {
+        atomic_init(&header->cursors[i].pos, 0);
+        atomic_init(&header->cursors[i].pid, 0);
+    }
+
+    return header;
+}
+
+broadcast_buffer *broadcast_buffer_attach(const char *name) {
+    assert(name);
+
+    // 打开共享内存对象
+    struct broadcast_buffer_header *header = NULL;
+    int const shmfd = shm_open(name, O_RDWR, 0);
+    if unlikely (shmfd < 0) return header;
+
+    // 映射共享内存
+    header = broadcast_buffer_fattach(shmfd);
+    close(shmfd);
+    return header;
+}
+
+broadcast_buffer *broadcast_buffer_fattach(int const shmfd) {
+    assert(shmfd >= 0);
+
+    // 从共享内存对象文件中读出 header 的副本
+    struct broadcast_buffer_header header;
+    ssize_t const nread = pread(shmfd, &header, sizeof header, 0);
+    if likely (nread == sizeof header) {
+        size_t head_size = aligned_header_size(header.max_readers, header.page_mask);
+        return shared_memory_map_mirrored(shmfd, head_size, header.capacity, header.page_mask + 1,
+                                          0);
+    }
+
+    return NULL;
+}
+
+void *broadcast_buffer_reserve(broadcast_buffer *bb, size_t size) {
+    assert(bb);
+    struct broadcast_buffer_header *header = (struct broadcast_buffer_header *)bb;
+
+    size_t const length = sizeof(struct broadcast_buffer_record) + size;
+    size_t const aligned = record_aligned(length);
+    if unlikely (aligned > header->capacity) return NULL;
+
+    size_t const w = atomic_load_explicit(&header->w, memory_order_relaxed);
+    if (header->flag & BROADCAST_BUFFER_LOSSLESS) {
+        // 缓存的最慢读者位置用尽时才扫描游标
+        if (w + aligned - header->min_cache > header->capacity) {
+            header->min_cache = slowest_reader(header, w);
+            if (w + aligned - header->min_cache > header->capacity) return NULL;
+        }
+    } else {
+        // 先公布将要覆盖的范围再写入，读者据此判断复制的数据是否有效
+        atomic_store_explicit(&header->intent, w + aligned, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+    }
+
+    struct broadcast_buffer_record *record = record_at(header, w);
+    atomic_store_explicit(&record->length, (int32_t)length, memory_order_relaxed);
+    return record + 1;
+}
+
+void broadcast_buffer_commit(broadcast_buffer *bb, void *data, int type) {
+    assert(bb);
+    assert(data);
+    struct broadcast_buffer_header *header = (struct broadcast_buffer_header *)bb;
+    struct broadcast_buffer_record *record = (struct broadcast_buffer_record *)data - 1;
+    size_t const w = atomic_load_explicit(&header->w, memory_order_relaxed);
+    assert(record == record_at(header, w) ||
+           (char *)record == (char *)record_at(header, w) + header->capacity);
+
+    record->type = type;
+    size_t const length = atomic_load_explicit(&record->length, memory_order_relaxed);
+    atomic_store_explicit(&header->latest, w, memory_order_release);
+    atomic_store_explicit(&header->w, w + record_aligned(length), memory_order_release);
+}
+
+size_t broadcast_buffer_reap(broadcast_buffer *bb) {
+    assert(bb);
+    struct broadcast_buffer_header *header = (struct broadcast_buffer_header *)bb;
+    size_t count = 0;
+    for (size_t i = 0; i < header->max_readers; ++i) {
+        struct broadcast_buffer_cursor *cursor = &header->cursors[i];
+        pid_t pid = atomic_load_explicit(&cursor->pid, memory_order_relaxed);
+        if (pid && kill(pid, 0) != 0 && errno == ESRCH &&
+            atomic_compare_exchange_strong(&cursor->pid, &pid, 0)) {
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+void broadcast_buffer_detach(broadcast_buffer *bb) {
+    assert(bb);
+    struct broadcast_buffer_header *header = (struct broadcast_buffer_header *)bb;
+    munmap(header, mapping_size(header));
+}
+
+void broadcast_buffer_destroy(broadcast_buffer *bb) {
+    assert(bb);
+    // 删除共享内存对象
+    struct broadcast_buffer_header *header = (struct broadcast_buffer_header *)bb;
+    if (header->name[0]) {
+        shm_unlink(header->name);
+    }
+
+    munmap(header, mapping_size(header));
+}
+
+broadcast_reader *broadcast_reader_open(broadcast_buffer *bb) {
+    assert(bb);
+    struct broadcast_buffer_header *header = (struct broadcast_buffer_header *)bb;
+    struct broadcast_reader *reader = calloc(1, sizeof *reader);
+    if unlikely (!reader) return NULL;
+    reader->header = header;
+
+    if (header->flag & BROADCAST_BUFFER_LOSSLESS) {
+        // 占用空闲游标，在设置读位置前生产者看到的旧位置不会超过写位置，只会使其保守地等待
+        for (size_t i = 0; i < header->max_readers && !reader->cursor; ++i) {
+            pid_t expected = 0;
+            if (atomic_compare_exchange_strong(&header->cursors[i].pid, &expected, getpid())) {
+                reader->cursor = &header->cursors[i];
+            }
+        }
+
+        if unlikely (!reader->cursor) {
+            free(reader);
+            errno = EBUSY;
+            return NULL;
+        }
+
+        reader->pos = atomic_load_explicit(&header->w, memory_order_acquire);
+        atomic_store_explicit(&reader->cursor->pos, reader->pos, memory_order_release);
+    } else {
+        reader->pos = atomic_load_explicit(&header->w, memory_order_acquire);
+    }
+
+    return reader;
+}
+
+// 无损模式，原地读取
+static size_t read_lossless(struct broadcast_reader *reader,
+                            broadcast_buffer_record_handler handler,
+                            void *arg,
+                            size_t limit) {
+    struct broadcast_buffer_header *header = reader->header;
+    size_t const w = atomic_load_explicit(&header->w, memory_order_acquire);
+    size_t pos = reader->pos;
+    size_t count = 0;
+    while (count < limit && pos != w) {
+        struct broadcast_buffer_record *record = record_at(header, pos);
+        int32_t const length = atomic_load_explicit(&record->length, memory_order_relaxed);
+        handler(record->type, record + 1, length - sizeof *record, arg);
+        pos += record_aligned(length);
+        ++count;
+    }
+
+    // 一批记录只更新一次游标
+    if (pos != reader->pos) {
+        reader->pos = pos;
+        atomic_store_explicit(&reader->cursor->pos, pos, memory_order_release);
+    }
+
+    return count;
+}
+
+// 有损模式，复制到私有缓冲区后校验
+static size_t read_lossy(struct broadcast_reader *reader,
+                         broadcast_buffer_record_handler handler,
+                         void *arg,
+                         size_t limit) {
+    struct broadcast_buffer_header *header = reader->header;
+    size_t const capacity = header->capacity;
+    size_t count = 0;
+    while (count < limit) {
+        size_t const w = atomic_load_explicit(&header->w, memory_order_acquire);
+        size_t const pos = reader->pos;
+        if (pos == w) break;
+
+        // 读位置已被覆盖，跳到最近一条已提交的记录
+        if (atomic_load_explicit(&header->intent, memory_order_relaxed) - pos > capacity) {
+            size_t const latest = atomic_load_explicit(&header->latest, memory_order_acquire);
+            if ((ptrdiff_t)(latest - pos) <= 0) break;
+            reader->lost += latest - pos;
+            reader->pos = latest;
+            continue;
+        }
+
+        // 复制记录，长度可能已被覆盖，校验后才使用
+        struct broadcast_buffer_record *record = record_at(header, pos);
+        int32_t const length = atomic_load_explicit(&record->length, memory_order_relaxed);
+        int const type = record->type;
+        size_t const size = length - sizeof *record;
+        if (length >= (int32_t)sizeof *record && (size_t)length <= capacity) {
+            if (size > reader->scratch_size) {
+                char *scratch = realloc(reader->scratch, size);
+                if unlikely (!scratch) break;
+                reader->scratch = scratch;
+                reader->scratch_size = size;
+            }
+            memcpy(reader->scratch, record + 1, size);
+        }
+
+        // 复制期间生产者越过了此记录，数据无效，重新检查
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&header->intent, memory_order_relaxed) - pos > capacity) continue;
+
+        handler(type, reader->scratch, size, arg);
+        reader->pos = pos + record_aligned(length);
+        ++count;
+    }
+
+    return count;
+}
+
+size_t broadcast_reader_read(broadcast_reader *reader,
+                             broadcast_buffer_record_handler handler,
+                             void *arg,
+                             size_t limit) {
+    assert(reader);
+    assert(handler);
+    if (reader->cursor) return read_lossless(reader, handler, arg, limit);
+    return read_lossy(reader, handler, arg, limit);
+}
+
+size_t broadcast_reader_lost(broadcast_reader *reader) {
+    assert(reader);
+    return reader->lost;
+}
+
+void broadcast_reader_close(broadcast_reader *reader) {
+    assert(reader);
+    if (reader->cursor) atomic_store_explicit(&reader->cursor->pid, 0, memory_order_release);
+    free(reader->scratch);
+    free(reader);
+}
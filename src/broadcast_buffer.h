@@ -0,0 +1,164 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief 广播环形缓冲区，一个生产者写入一次，多个读者各自持有独立的读位置读取全部记录
+ *        写入开销与读者数量无关，可跨线程、跨进程使用。
+ *        数据以记录为单位，每条记录带 8 字节记录头（长度与类型），按 8 字节对齐；
+ *        与 circular_buffer 一样使用镜像内存区，记录总是连续的。
+ *        有损模式（默认）：生产者从不等待读者，慢读者被覆盖后跳到最新的记录，并累计丢失的字节数；
+ *        读者读取记录时先复制到私有缓冲区再校验是否被覆盖，处理函数看到的总是完整的记录。
+ *        无损模式：读者在共享内存中登记游标，生产者在最慢的读者之后停止写入，读者原地读取记录
+ */
+typedef void broadcast_buffer;
+
+/**
+ * \brief 读者对象，只能在一个线程中使用
+ */
+typedef struct broadcast_reader broadcast_reader;
+
+/**
+ * \brief 无损模式，最慢的登记读者对生产者施加背压
+ */
+#define BROADCAST_BUFFER_LOSSLESS 0x1
+
+/**
+ * \brief 记录处理函数
+ *
+ * \param type 记录类型
+ * \param data 记录数据，处理函数返回后失效
+ * \param size 记录数据长度
+ * \param arg  broadcast_reader_read 传入的参数
+ */
+typedef void (*broadcast_buffer_record_handler)(int type, const void* data, size_t size, void* arg);
+
+/**
+ * \brief 创建广播缓冲区
+ *
+ * \param name        共享内存对象名称，为空指针时创建只能通过 fork 共享的匿名缓冲区
+ * \param capacity    缓冲区容量，向上对齐到 2 的幂与页大小，不能超过 2GB
+ * \param max_readers 无损模式下可同时登记的读者数，有损模式下忽略
+ * \param flag        0 或 BROADCAST_BUFFER_LOSSLESS
+ *
+ * \return 成功时返回广播缓冲区对象指针，失败时返回空指针
+ */
+broadcast_buffer* broadcast_buffer_create(
+    const char* name, size_t capacity, size_t max_readers, int flag);
+
+/**
+ * \brief 在共享内存对象文件描述符上创建广播缓冲区
+ *
+ * \param shmfd       共享内存对象文件描述符，需要以 O_RDWR 方式打开；为 -1 时创建匿名缓冲区
+ * \param capacity    缓冲区容量
+ * \param max_readers 无损模式下可同时登记的读者数
+ * \param flag        0 或 BROADCAST_BUFFER_LOSSLESS
+ *
+ * \return 成功时返回广播缓冲区对象指针，失败时返回空指针
+ */
+broadcast_buffer* broadcast_buffer_fcreate(
+    int shmfd, size_t capacity, size_t max_readers, int flag);
+
+/**
+ * \brief 附着到一个命名广播缓冲区
+ *
+ * \param name 广播缓冲区名称，不可为空指针
+ *
+ * \return 成功时返回广播缓冲区对象指针，失败时返回空指针
+ */
+broadcast_buffer* broadcast_buffer_attach(const char* name);
+
+/**
+ * \brief 附着到已初始化的广播缓冲区
+ *
+ * \param shmfd 共享内存对象文件描述符
+ *
+ * \return 成功时返回广播缓冲区对象指针，失败时返回空指针
+ */
+broadcast_buffer* broadcast_buffer_fattach(int shmfd);
+
+/**
+ * \brief 生产者接口，预订一条记录的空间，提交前不能再次预订
+ *
+ * \param bb   广播缓冲区对象指针，不可为空指针
+ * \param size 记录数据长度
+ *
+ * \return 成功时返回记录数据的写入位置；无损模式下最慢的读者尚未读完时返回空指针
+ */
+void* broadcast_buffer_reserve(broadcast_buffer* bb, size_t size);
+
+/**
+ * \brief 生产者接口，提交已写入的记录，记录对所有读者可见
+ *
+ * \param bb   广播缓冲区对象指针，不可为空指针
+ * \param data broadcast_buffer_reserve 返回的写入位置
+ * \param type 记录类型
+ */
+void broadcast_buffer_commit(broadcast_buffer* bb, void* data, int type);
+
+/**
+ * \brief 回收已退出进程登记的游标，避免无损模式下生产者被已崩溃的读者永久阻塞
+ *
+ * \param bb 广播缓冲区对象指针，不可为空指针
+ *
+ * \return 返回回收的游标数
+ */
+size_t broadcast_buffer_reap(broadcast_buffer* bb);
+
+/**
+ * \brief 解除附着，释放内存，共享内存对象不会销毁
+ *
+ * \param bb 广播缓冲区对象指针，不可为空指针
+ */
+void broadcast_buffer_detach(broadcast_buffer* bb);
+
+/**
+ * \brief 释放内存，删除共享内存对象
+ *
+ * \param bb 广播缓冲区对象指针，不可为空指针
+ */
+void broadcast_buffer_destroy(broadcast_buffer* bb);
+
+/**
+ * \brief 创建读者，从当前写位置开始读取；无损模式下在共享内存中登记游标
+ *
+ * \param bb 广播缓冲区对象指针，不可为空指针
+ *
+ * \return 成功时返回读者对象指针；没有空闲游标时返回空指针，errno 为 EBUSY
+ */
+broadcast_reader* broadcast_reader_open(broadcast_buffer* bb);
+
+/**
+ * \brief 读取已提交的记录
+ *
+ * \param reader  读者对象指针，不可为空指针
+ * \param handler 记录处理函数
+ * \param arg     传给记录处理函数的参数
+ * \param limit   最多读取的记录数
+ *
+ * \return 返回读取的记录数
+ */
+size_t broadcast_reader_read(
+    broadcast_reader* reader, broadcast_buffer_record_handler handler, void* arg, size_t limit);
+
+/**
+ * \brief 有损模式下读者因被覆盖而跳过的累计字节数，无损模式下总是 0
+ *
+ * \param reader 读者对象指针，不可为空指针
+ */
+size_t broadcast_reader_lost(broadcast_reader* reader);
+
+/**
+ * \brief 注销游标，释放读者
+ *
+ * \param reader 读者对象指针，不可为空指针
+ */
+void broadcast_reader_close(broadcast_reader* reader);
+
+#ifdef __cplusplus
+}
+#endif
@@ -3,13 +3,22 @@
 #endif
 
 #include "circular_buffer.h"
+#include "shared_memory.h"
 
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -35,14 +44,39 @@
 #define unlikely(x) (__builtin_expect(!!(x), 0))
 #endif
 
+/**
+ * 读写索引各占一个缓存行，每一方只写自己的缓存行。
+ * 一方在本地缓存对端索引，只有缓存的长度不够本次所需时才读取对端的缓存行。
+ */
 struct circular_buffer_index {
-    size_t value;  ///< 索引
+    _Atomic size_t value;     ///< 索引，由所属一方以 release 语义写入，对端以 acquire 语义读取
+    size_t cache;             ///< 对端索引的本地缓存，只由所属一方读写
+    _Atomic uint32_t futex;   ///< 等待本索引推进的对端阻塞在此字上，最高位为等待标志，其余位为序号
+    size_t reserved;          ///< 单生产者记录接口已预订到的位置，仅写索引使用
+    size_t committed;         ///< 单生产者记录接口已提交到的位置，仅写索引使用
+    int records;              ///< 单生产者最近使用的是记录接口，仅写索引使用
+};
+
+#define FUTEX_WAITER 0x80000000u
+
+/**
+ * 日志模式的持久化状态，持久化时先同步数据再同步头部，保证头部中的索引不超前于数据太多；
+ * 即便如此，写回顺序仍由内核决定，恢复时以记录的校验和为准
+ */
+struct circular_buffer_journal {
+    _Atomic size_t synced;        ///< 已持久化到的写位置，之前的记录都已提交
+    _Atomic uint64_t last_sync;   ///< 上次持久化的时间，CLOCK_MONOTONIC 纳秒
+    _Atomic size_t sync_bytes;    ///< 未持久化的数据达到此长度时自动持久化，0 表示不按长度
+    _Atomic uint64_t sync_ns;     ///< 距上次持久化达到此时长时自动持久化，0 表示不按时间
+    _Atomic int syncing;          ///< 是否有生产者正在持久化
+    _Atomic uint64_t sync_started;  ///< 已开始的持久化次数，circular_buffer_sync 据此等待之后开始的一次
+    _Atomic uint64_t sync_done;     ///< 最后一次成功的持久化的序号
 };
 
 struct circular_buffer_header {
-    struct circular_buffer_index r;  ///< 写缓冲区上下文
+    struct circular_buffer_index r;  ///< 读索引，属于消费者
     __cache_line_padding;            ///< 缓存行对齐填充
-    struct circular_buffer_index w;  ///< 读缓冲区上下文
+    struct circular_buffer_index w;  ///< 写索引，属于生产者
     __cache_line_padding;            ///< 缓存行对齐填充
     size_t capacity;                 ///< 缓冲区容量
     size_t private_size;             ///< 私有数据大小
@@ -50,15 +84,119 @@ struct circular_buffer_header {
     int flag;                        ///< 标志
     char name[64];                   ///< 共享内存对象名称
     __cache_line_padding;            ///< 缓存行对齐填充
+    struct circular_buffer_journal journal;  ///< 日志模式的持久化状态
+    __cache_line_padding;            ///< 缓存行对齐填充
     char private_data[0];            ///< 私有数据
 };
 
-static inline size_t readable_size(struct circular_buffer_header *cb) {
-    return cb->w.value - cb->r.value;
+/**
+ * 记录头，记录按 RECORD_ALIGNMENT 对齐。
+ * 镜像内存区保证记录在缓冲区末尾也是连续的，无须在回绕处填充。
+ * 单生产者模式下记录按序提交，写索引之前的记录都是完整的，长度在预订时即写入。
+ * 多生产者模式下生产者预订空间后立即写入负的长度，写完数据后写入正的长度完成提交；
+ * 消费者清零已读空间后才归还，因此长度为 0 表示记录头尚未写入。
+ * 日志模式下记录数据之后附加 4 字节 CRC32C 校验和，覆盖记录头与数据，计入记录长度。
+ */
+struct circular_buffer_record {
+    _Atomic int32_t length;  ///< 记录长度，含记录头；负数表示正在写入
+    int32_t type;            ///< 记录类型
+};
+
+#define RECORD_ALIGNMENT sizeof(struct circular_buffer_record)
+
+#define RECORD_CHECKSUM_SIZE sizeof(uint32_t)
+
+static inline size_t load_own(struct circular_buffer_index *idx) {
+    return atomic_load_explicit(&idx->value, memory_order_relaxed);
+}
+
+static inline size_t load_peer(struct circular_buffer_index *idx) {
+    return atomic_load_explicit(&idx->value, memory_order_acquire);
+}
+
+static inline void store_own(struct circular_buffer_index *idx, size_t value) {
+    atomic_store_explicit(&idx->value, value, memory_order_release);
+}
+
+// 消费者视角的可读长度，缓存的写索引显示不足 need 时才重新读取写索引
+static inline size_t readable_size(struct circular_buffer_header *cb, size_t need) {
+    size_t const r = load_own(&cb->r);
+    if (cb->r.cache - r < need) cb->r.cache = load_peer(&cb->w);
+    return cb->r.cache - r;
+}
+
+// 生产者视角的可写长度，缓存的读索引显示不足 need 时才重新读取读索引
+static inline size_t writable_size(struct circular_buffer_header *cb, size_t need) {
+    size_t const w = load_own(&cb->w);
+    if (cb->capacity - (w - cb->w.cache) < need) cb->w.cache = load_peer(&cb->r);
+    return cb->capacity - (w - cb->w.cache);
+}
+
+// 索引推进后唤醒对端，只有对端设置了等待标志时才进行系统调用
+static inline void notify(struct circular_buffer_index *idx) {
+    // 与等待方的 fetch_or 构成 Dekker 式同步：要么等待方看到新索引，要么此处看到等待标志
+    atomic_thread_fence(memory_order_seq_cst);
+    uint32_t v = atomic_load_explicit(&idx->futex, memory_order_relaxed);
+    if likely (!(v & FUTEX_WAITER)) return;
+
+    while (!atomic_compare_exchange_weak_explicit(&idx->futex, &v, (v + 1) & ~FUTEX_WAITER,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+        if (!(v & FUTEX_WAITER)) return;
+    }
+
+    syscall(SYS_futex, &idx->futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+typedef size_t (*available_fn)(struct circular_buffer_header *);
+
+// 阻塞直到 available 不小于 size 或超时，idx 是对端推进的索引
+static size_t wait_for(struct circular_buffer_header *cb,
+                       struct circular_buffer_index *idx,
+                       available_fn available,
+                       size_t size,
+                       int timeout) {
+    struct timespec deadline;
+    if (timeout >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout / 1000;
+        deadline.tv_nsec += (long)(timeout % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    for (;;) {
+        size_t n = available(cb);
+        if (n >= size) return n;
+
+        // 设置等待标志后再检查一次，避免错过设置标志前的推进
+        uint32_t const v =
+            atomic_fetch_or_explicit(&idx->futex, FUTEX_WAITER, memory_order_seq_cst) | FUTEX_WAITER;
+        n = available(cb);
+        if (n >= size) return n;
+
+        struct timespec rel, *prel = NULL;
+        if (timeout >= 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            rel.tv_sec = deadline.tv_sec - now.tv_sec;
+            rel.tv_nsec = deadline.tv_nsec - now.tv_nsec;
+            if (rel.tv_nsec < 0) {
+                rel.tv_sec -= 1;
+                rel.tv_nsec += 1000000000;
+            }
+            if (rel.tv_sec < 0) return n;
+            prel = &rel;
+        }
+
+        // 被唤醒、序号已变化或被信号中断时都重新检查
+        syscall(SYS_futex, &idx->futex, FUTEX_WAIT, v, prel, NULL, 0);
+    }
 }
 
-static inline size_t writable_size(struct circular_buffer_header *cb) {
-    return cb->capacity - readable_size(cb);
+static inline size_t record_aligned(size_t length) {
+    return (length + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
 }
 
 static inline size_t aligned_header_size(size_t private_size, long page_mask) {
@@ -73,43 +211,237 @@ static inline char *buffer_pos(struct circular_buffer_header *cb, size_t pos) {
     return buffer_start(cb) + (pos & (cb->capacity - 1));
 }
 
-static void *map_shared_memory(int const shmfd, size_t head_size, size_t const capacity) {
-    // head_size 和 capacity 必须是系统页大小的整数倍
-    assert(head_size > 0);
-    assert(capacity > 0);
-    assert((head_size & (sysconf(_SC_PAGESIZE) - 1)) == 0);
-    assert((capacity & (sysconf(_SC_PAGESIZE) - 1)) == 0);
+static inline struct circular_buffer_record *record_at(struct circular_buffer_header *cb,
+                                                       size_t pos) {
+    return (struct circular_buffer_record *)buffer_pos(cb, pos);
+}
+
+// 多生产者模式下已预订记录的结束位置，记录距写索引不超过容量，由地址与当前写索引推算出位置
+static inline size_t record_end(struct circular_buffer_header *cb,
+                                struct circular_buffer_record *record, int32_t length) {
+    size_t const w = load_peer(&cb->w);
+    size_t const offset = (size_t)((char *)record - buffer_start(cb)) & (cb->capacity - 1);
+    size_t back = (w - offset) & (cb->capacity - 1);
+    if (back == 0) back = cb->capacity;
+    return w - back + record_aligned(length);
+}
+
+// 记录中校验和的长度，非日志模式为 0
+static inline size_t checksum_size(struct circular_buffer_header *cb) {
+    return (cb->flag & CIRCULAR_BUFFER_JOURNAL) ? RECORD_CHECKSUM_SIZE : 0;
+}
 
-    // 先预订 total + capacity 长度的地址空间
-    size_t const total = capacity + head_size;
-    void *addr =
-        mmap(NULL, total + capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-    if unlikely (unlikely(!addr)) goto ERROR_RETURN;
+// 数据长度为 size 的记录长度，含记录头与校验和
+static inline size_t record_length(struct circular_buffer_header *cb, size_t size) {
+    return sizeof(struct circular_buffer_record) + size + checksum_size(cb);
+}
 
-    // 将共享内存的 [0, total) 段映射到预订的内存 [addr, addr + total) 段上
-    int flags = MAP_SHARED | MAP_FIXED | (shmfd == -1 ? MAP_ANONYMOUS : 0);
-    int prot = PROT_READ | PROT_WRITE;
-    void *new_addr = mmap(addr, total, prot, flags, shmfd, 0);
-    if unlikely (new_addr != addr) {
-        goto ERROR_RETURN;
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *p, size_t n) {
+    while (n--) {
+        crc ^= *p++;
+        for (int k = 0; k < 8; ++k) crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
     }
+    return crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) static uint32_t crc32c_hw(uint32_t crc,
+                                                            const unsigned char *p,
+                                                            size_t n) {
+    for (; n >= 8; p += 8, n -= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof v);
+        crc = (uint32_t)__builtin_ia32_crc32di(crc, v);
+    }
+    while (n--) crc = __builtin_ia32_crc32qi(crc, *p++);
+    return crc;
+}
+#endif
 
-    // 创建地址相邻的镜像内存区
-    // 将共享内存 [head_size, total) 段内存再次映射到预订的内存 [addr + total, addr + total +
-    // capacity) 段上
-    if unlikely (mremap((char *)addr + head_size, 0, capacity, MREMAP_MAYMOVE | MREMAP_FIXED,
-                        (char *)addr + total) != (char *)addr + total) {
-        goto ERROR_RETURN;
+// CRC32C，可以通过 crc 参数分段计算
+static uint32_t crc32c(const void *data, size_t size, uint32_t crc) {
+    crc = ~crc;
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse4.2")) return ~crc32c_hw(crc, data, size);
+#endif
+    return ~crc32c_sw(crc, data, size);
+}
+
+// 计算记录的校验和，length 为提交后的正长度
+static uint32_t record_checksum(struct circular_buffer_record *record, int32_t length) {
+    int32_t const head[2] = {length, record->type};
+    uint32_t const crc = crc32c(head, sizeof head, 0);
+    return crc32c(record + 1, length - sizeof *record - RECORD_CHECKSUM_SIZE, crc);
+}
+
+// 在记录数据之后写入校验和
+static void seal_record(struct circular_buffer_record *record, int32_t length) {
+    uint32_t const crc = record_checksum(record, length);
+    memcpy((char *)record + length - RECORD_CHECKSUM_SIZE, &crc, sizeof crc);
+}
+
+// 校验记录
+static int verify_record(struct circular_buffer_record *record, int32_t length) {
+    uint32_t crc;
+    memcpy(&crc, (char *)record + length - RECORD_CHECKSUM_SIZE, sizeof crc);
+    return crc == record_checksum(record, length);
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// 多生产者模式下从 pos 开始连续已提交的记录之后的位置，不超过 w
+static size_t committed_frontier(struct circular_buffer_header *cb, size_t pos, size_t w) {
+    while (pos != w) {
+        int32_t const length =
+            atomic_load_explicit(&record_at(cb, pos)->length, memory_order_acquire);
+        if (length <= 0 || record_aligned(length) > w - pos) break;
+        pos += record_aligned(length);
     }
+    return pos;
+}
+
+// 持久化写位置之前的数据与头部，同一时刻只有一个生产者执行
+// 成功时返回 0，失败时返回 -1，已有生产者正在持久化时返回 1
+static int journal_sync(struct circular_buffer_header *cb) {
+    struct circular_buffer_journal *journal = &cb->journal;
+    int expected = 0;
+    if (!atomic_compare_exchange_strong(&journal->syncing, &expected, 1)) return 1;
+    uint64_t const seq = atomic_fetch_add(&journal->sync_started, 1) + 1;
 
-    return addr;
+    // 已消费的数据无须持久化，且可能已被下一圈覆盖，从读索引与已持久化位置中较大者开始
+    size_t const w = load_peer(&cb->w);
+    size_t const r = load_peer(&cb->r);
+    size_t from = atomic_load_explicit(&journal->synced, memory_order_relaxed);
+    if (from < r) from = r;
+    if (from > w) from = w;
 
-ERROR_RETURN:
-    if (addr != MAP_FAILED) {
-        munmap(addr, total + capacity);
+    // 多生产者模式下写索引是预订位置，synced 只推进到第一条尚未提交的记录，
+    // 之后提交的记录由下一次持久化再次覆盖；遍历须在 msync 之前，msync 才覆盖遍历时已提交的记录。
+    // 遍历期间消费者越过 from 时，其后的空间可能已被下一圈覆盖，从新的读索引重新遍历
+    size_t frontier = w;
+    if (cb->flag & CIRCULAR_BUFFER_MPSC) {
+        for (;;) {
+            frontier = committed_frontier(cb, from, w);
+            size_t const now = load_peer(&cb->r);
+            if (now <= from) break;
+            if (now >= w) {
+                from = frontier = w;
+                break;
+            }
+            from = now;
+        }
     }
 
-    return NULL;
+    // 镜像内存区使 [from, w) 在地址上连续，起始地址向下对齐到页
+    size_t const page_mask = (size_t)sysconf(_SC_PAGESIZE) - 1;
+    int ret = 0;
+    if (w != from) {
+        uintptr_t const start = (uintptr_t)buffer_pos(cb, from);
+        uintptr_t const aligned = start & ~(uintptr_t)page_mask;
+        ret = msync((void *)aligned, start - aligned + (w - from), MS_SYNC);
+    }
+
+    // 数据持久化后再持久化头部中的索引
+    if (ret == 0) ret = msync(cb, aligned_header_size(cb->private_size, cb->page_mask), MS_SYNC);
+
+    if (ret == 0) {
+        atomic_store_explicit(&journal->synced, frontier, memory_order_release);
+        atomic_store_explicit(&journal->last_sync, monotonic_ns(), memory_order_relaxed);
+        atomic_store_explicit(&journal->sync_done, seq, memory_order_release);
+    }
+
+    atomic_store_explicit(&journal->syncing, 0, memory_order_release);
+    return ret;
+}
+
+// 提交后按组提交策略决定是否持久化，end 为刚提交的记录的结束位置
+static void journal_commit(struct circular_buffer_header *cb, size_t end) {
+    struct circular_buffer_journal *journal = &cb->journal;
+    size_t const sync_bytes = atomic_load_explicit(&journal->sync_bytes, memory_order_relaxed);
+    uint64_t const sync_ns = atomic_load_explicit(&journal->sync_ns, memory_order_relaxed);
+    if likely (!sync_bytes && !sync_ns) return;
+
+    size_t const synced = atomic_load_explicit(&journal->synced, memory_order_relaxed);
+    size_t const pending = end > synced ? end - synced : 0;
+    if ((sync_bytes && pending >= sync_bytes) ||
+        (sync_ns && pending &&
+         monotonic_ns() - atomic_load_explicit(&journal->last_sync, memory_order_relaxed) >=
+             sync_ns)) {
+        journal_sync(cb);
+    }
+}
+
+#ifndef MFD_HUGE_2MB
+#define MFD_HUGE_2MB (21U << 26)
+#endif
+
+#ifndef MFD_HUGE_1GB
+#define MFD_HUGE_1GB (30U << 26)
+#endif
+
+#define HUGE_PAGE_2MB ((size_t)1 << 21)
+#define HUGE_PAGE_1GB ((size_t)1 << 30)
+
+#define HUGETLB_FLAGS (CIRCULAR_BUFFER_HUGE_2MB | CIRCULAR_BUFFER_HUGE_1GB)
+
+// 预先触碰映射的每一页，使其在当前内存策略下分配
+static void prefault(char *addr, size_t size, int const write) {
+    if (madvise(addr, size, MADV_POPULATE_WRITE) == 0) return;
+
+    // 内核不支持 MADV_POPULATE_WRITE 时逐页触碰，其他进程可能正在读写时只读不写
+    size_t const page_size = (size_t)sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < size; i += page_size) {
+        volatile char *p = addr + i;
+        if (write)
+            *p = *p;
+        else
+            (void)*p;
+    }
+}
+
+// 按标志预分配并锁定整个映射，失败时解除映射
+static int populate_mapping(void *addr, size_t size, int const flag, int const write) {
+    if (!(flag & (CIRCULAR_BUFFER_PREFAULT | CIRCULAR_BUFFER_MLOCK))) return 0;
+
+    prefault((char *)addr, size, write);
+    if ((flag & CIRCULAR_BUFFER_MLOCK) && mlock(addr, size) != 0) {
+        int const err = errno;
+        munmap(addr, size);
+        errno = err;
+        return -1;
+    }
+
+    return 0;
+}
+
+// 将映射绑定到指定 NUMA 节点，已分配的页一并迁移
+static int bind_numa_node(void *addr, size_t size, int node) {
+    unsigned long mask[(CIRCULAR_BUFFER_MAX_NUMA_NODE + 1 + 8 * sizeof(unsigned long) - 1) /
+                       (8 * sizeof(unsigned long))] = {0};
+    mask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    return (int)syscall(SYS_mbind, addr, size, MPOL_BIND, mask, 8 * sizeof mask, MPOL_MF_MOVE);
+}
+
+// 两种大页只能选择一种
+static inline int valid_flag(int const flag) { return (flag & HUGETLB_FLAGS) != HUGETLB_FLAGS; }
+
+// 按标志计算映射的对齐粒度，头部与缓冲区都对齐到此粒度
+static size_t mapping_alignment(int const flag) {
+    if (flag & CIRCULAR_BUFFER_HUGE_1GB) return HUGE_PAGE_1GB;
+    if (flag & (CIRCULAR_BUFFER_HUGE_2MB | CIRCULAR_BUFFER_THP)) return HUGE_PAGE_2MB;
+    return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+// 创建 memfd，按标志使用大页
+static int open_memfd(const char *name, int const flag) {
+    unsigned int mfd_flags = MFD_CLOEXEC;
+    if (flag & CIRCULAR_BUFFER_HUGE_2MB) mfd_flags |= MFD_HUGETLB | MFD_HUGE_2MB;
+    if (flag & CIRCULAR_BUFFER_HUGE_1GB) mfd_flags |= MFD_HUGETLB | MFD_HUGE_1GB;
+    return memfd_create(name ? name : "circular_buffer", mfd_flags);
 }
 
 circular_buffer *circular_buffer_create(const char *name,
@@ -117,9 +449,19 @@ circular_buffer *circular_buffer_create(const char *name,
                                         size_t private_size,
                                         int const flag) {
     assert(capacity > 0);
-    int const anonymous = name ? 0 : 1;
+    if unlikely (!valid_flag(flag)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    int const memfd = (flag & (CIRCULAR_BUFFER_MEMFD | HUGETLB_FLAGS)) ? 1 : 0;
+    int const anonymous = name && !memfd ? 0 : 1;
     int shmfd;
-    if (anonymous)
+    if (memfd) {
+        // 创建 memfd，不依赖 /dev/shm，名称仅用于调试
+        shmfd = open_memfd(name, flag);
+        if (shmfd < 0) return NULL;
+    } else if (anonymous)
         shmfd = -1;
     else {
         // 创建共享内存对象
@@ -130,45 +472,104 @@ circular_buffer *circular_buffer_create(const char *name,
     struct circular_buffer_header *header =
         circular_buffer_fcreate(shmfd, capacity, private_size, flag);
     if unlikely (!header) {
-        close(shmfd);
+        int const err = errno;
+        if (shmfd >= 0) close(shmfd);
+        if (!anonymous) shm_unlink(name);
+        errno = err;
         return NULL;
     }
 
     if likely (!anonymous) {
         // 保存共享内存对象名称
         strcpy(header->name, name);
-        close(shmfd);
     }
 
+    if (shmfd >= 0) close(shmfd);
     return header;
 }
 
-circular_buffer *circular_buffer_fcreate(int const shmfd,
+circular_buffer *circular_buffer_fcreate(int shmfd,
                                          size_t capacity,
                                          size_t private_size,
                                          int const flag) {
-    // 获取系统页大小
-    long const page_mask = sysconf(_SC_PAGESIZE) - 1;
+    if unlikely (!valid_flag(flag)) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // 日志模式需要普通文件
+    if unlikely ((flag & CIRCULAR_BUFFER_JOURNAL) && shmfd < 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // 大页内存无法匿名共享，以 memfd 代替
+    int owned_fd = -1;
+    if (shmfd < 0 && (flag & HUGETLB_FLAGS)) {
+        shmfd = owned_fd = open_memfd(NULL, flag);
+        if (shmfd < 0) return NULL;
+    }
 
-    // 计算对齐到系统页大小的容量
+    // 获取对齐粒度，使用大页时为大页大小
+    long const page_mask = (long)mapping_alignment(flag) - 1;
+
+    // 计算对齐后的容量
     capacity = (capacity + page_mask) & (~page_mask);
 
-    // 计算对齐到系统页大小的头部大小
+    // 多生产者模式的记录长度为 32 位
+    if unlikely ((flag & CIRCULAR_BUFFER_MPSC) && capacity > INT32_MAX) {
+        if (owned_fd >= 0) close(owned_fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // 计算对齐后的头部大小
     size_t const aligned_head_size = aligned_header_size(private_size, page_mask);
 
-    // 设置共享内存大小
-    if unlikely (shmfd >= 0 && ftruncate(shmfd, capacity + aligned_head_size) < 0) {
-        return NULL;
+    // 设置共享内存大小，映射共享内存
+    struct circular_buffer_header *header = NULL;
+    if likely (shmfd < 0 || ftruncate(shmfd, capacity + aligned_head_size) == 0) {
+        header = shared_memory_map_mirrored(shmfd, aligned_head_size, capacity, page_mask + 1,
+                                            flag & CIRCULAR_BUFFER_THP);
     }
 
-    // 映射共享内存
-    struct circular_buffer_header *header = map_shared_memory(shmfd, aligned_head_size, capacity);
+    if (owned_fd >= 0) close(owned_fd);
     if unlikely (!header) return NULL;
 
+    // 在初始化头部之前绑定节点并预分配，避免首次触碰的页落在当前节点
+    int const node = CIRCULAR_BUFFER_GET_NUMA_NODE(flag);
+    if (node >= 0) {
+        size_t const total = aligned_head_size + capacity;
+        if unlikely (bind_numa_node(header, total, node) != 0) {
+            int const err = errno;
+            munmap(header, total + capacity);
+            errno = err;
+            return NULL;
+        }
+        prefault((char *)header, total, 1);
+    }
+
+    if unlikely (populate_mapping(header, aligned_head_size + capacity + capacity, flag, 1) != 0)
+        return NULL;
+
     // 初始共享内存队列头
-    header->r.value = 0;
-    header->w.value = 0;
+    atomic_init(&header->r.value, 0);
+    header->r.cache = 0;
+    atomic_init(&header->r.futex, 0);
+    atomic_init(&header->w.value, 0);
+    header->w.cache = 0;
+    atomic_init(&header->w.futex, 0);
+    header->w.reserved = 0;
+    header->w.committed = 0;
+    header->w.records = 0;
     header->name[0] = 0;
+    atomic_init(&header->journal.synced, 0);
+    atomic_init(&header->journal.last_sync, monotonic_ns());
+    atomic_init(&header->journal.sync_bytes, 0);
+    atomic_init(&header->journal.sync_ns, 0);
+    atomic_init(&header->journal.syncing, 0);
+    atomic_init(&header->journal.sync_started, 0);
+    atomic_init(&header->journal.sync_done, 0);
     header->capacity = capacity;
     header->private_size = private_size;
     header->page_mask = page_mask;
@@ -195,11 +596,19 @@ circular_buffer *circular_buffer_fattach(int const shmfd) {
 
     // 从共享内存对象文件中读出 header 的副本
     struct circular_buffer_header header;
-    ssize_t const nread = read(shmfd, &header, sizeof header);
+    ssize_t const nread = pread(shmfd, &header, sizeof header, 0);
     if likely (nread == sizeof header) {
-        lseek(shmfd, 0, SEEK_SET);
         size_t head_size = aligned_header_size(header.private_size, header.page_mask);
-        return map_shared_memory(shmfd, head_size, header.capacity);
+        void *const addr =
+            shared_memory_map_mirrored(shmfd, head_size, header.capacity, header.page_mask + 1,
+                                       header.flag & CIRCULAR_BUFFER_THP);
+        if unlikely (!addr) return NULL;
+
+        // 其他进程可能正在读写，不能以写回的方式触碰
+        if unlikely (populate_mapping(addr, head_size + header.capacity + header.capacity,
+                                      header.flag, 0) != 0)
+            return NULL;
+        return addr;
     }
 
     return NULL;
@@ -212,43 +621,389 @@ void *circular_buffer_get_private_data(circular_buffer *cb) {
 }
 
 struct buffer_piece circular_buffer_get_writable(circular_buffer *cb) {
+    return circular_buffer_get_writable_min(cb, 1);
+}
+
+struct buffer_piece circular_buffer_get_readable(circular_buffer *cb) {
+    return circular_buffer_get_readable_min(cb, 1);
+}
+
+struct buffer_piece circular_buffer_get_writable_min(circular_buffer *cb, size_t size) {
     assert(cb);
     struct buffer_piece ret = {};
     struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
-    ret.size = writable_size(header);
-    size_t const aligned_head_size = aligned_header_size(header->private_size, header->page_mask);
-    ret.data = buffer_pos(header, header->w.value);
+    assert(!(header->flag & (CIRCULAR_BUFFER_MPSC | CIRCULAR_BUFFER_JOURNAL)));
+    ret.size = writable_size(header, size);
+    ret.data = buffer_pos(header, load_own(&header->w));
     return ret;
 }
 
-struct buffer_piece circular_buffer_get_readable(circular_buffer *cb) {
+struct buffer_piece circular_buffer_get_readable_min(circular_buffer *cb, size_t size) {
     assert(cb);
     struct buffer_piece ret = {};
     struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
-    ret.size = readable_size(header);
-    size_t const aligned_head_size = aligned_header_size(header->private_size, header->page_mask);
-    ret.data = buffer_pos(header, header->r.value);
+    assert(!(header->flag & (CIRCULAR_BUFFER_MPSC | CIRCULAR_BUFFER_JOURNAL)));
+    ret.size = readable_size(header, size);
+    ret.data = buffer_pos(header, load_own(&header->r));
     return ret;
 }
 
 size_t circular_buffer_pop_data(circular_buffer *cb, size_t size) {
     assert(cb);
     struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
-    size_t const tmp = readable_size(header);
+    assert(!(header->flag & (CIRCULAR_BUFFER_MPSC | CIRCULAR_BUFFER_JOURNAL)));
+    size_t const tmp = readable_size(header, size);
     if (size > tmp) size = tmp;
-    header->r.value += size;
+    store_own(&header->r, load_own(&header->r) + size);
+    notify(&header->r);
     return size;
 }
 
 size_t circular_buffer_push_data(circular_buffer *cb, size_t size) {
     assert(cb);
     struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
-    size_t const tmp = writable_size(header);
+    assert(!(header->flag & (CIRCULAR_BUFFER_MPSC | CIRCULAR_BUFFER_JOURNAL)));
+    size_t const tmp = writable_size(header, size);
     if (size > tmp) size = tmp;
-    header->w.value += size;
+    if unlikely (header->w.records) header->w.records = 0;
+    store_own(&header->w, load_own(&header->w) + size);
+    notify(&header->w);
     return size;
 }
 
+// 单生产者预订，只推进生产者私有的预订位置
+static void *spsc_reserve(struct circular_buffer_header *cb, size_t length, size_t aligned) {
+    // 没有未提交的预订时与字节接口的写索引同步
+    if (cb->w.reserved == cb->w.committed) {
+        cb->w.reserved = cb->w.committed = load_own(&cb->w);
+    }
+
+    size_t const reserved = cb->w.reserved;
+    if (reserved + aligned - cb->w.cache > cb->capacity) {
+        cb->w.cache = load_peer(&cb->r);
+        if (reserved + aligned - cb->w.cache > cb->capacity) return NULL;
+    }
+
+    struct circular_buffer_record *record = record_at(cb, reserved);
+    atomic_store_explicit(&record->length, (int32_t)length, memory_order_relaxed);
+    cb->w.reserved = reserved + aligned;
+    cb->w.records = 1;
+    return record + 1;
+}
+
+// 单生产者提交，按预订顺序提交，全部预订都提交后一次推进写索引
+static void spsc_commit(struct circular_buffer_header *cb, struct circular_buffer_record *record) {
+    int32_t const length = atomic_load_explicit(&record->length, memory_order_relaxed);
+    assert(length > 0);
+    assert((char *)record == buffer_pos(cb, cb->w.committed) ||
+           (char *)record == buffer_pos(cb, cb->w.committed) + cb->capacity);
+    cb->w.committed += record_aligned(length);
+    if (cb->w.committed == cb->w.reserved) {
+        store_own(&cb->w, cb->w.committed);
+        notify(&cb->w);
+    }
+}
+
+void *circular_buffer_reserve(circular_buffer *cb, size_t size) {
+    assert(cb);
+    struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
+
+    size_t const length = record_length(header, size);
+    size_t const aligned = record_aligned(length);
+    if unlikely (aligned > header->capacity || length > INT32_MAX) return NULL;
+
+    if (!(header->flag & CIRCULAR_BUFFER_MPSC)) return spsc_reserve(header, length, aligned);
+
+    // 原子地推进写索引，读索引只会增大，以旧的读索引判断空间是保守的
+    size_t w = load_own(&header->w);
+    do {
+        if (w + aligned - load_peer(&header->r) > header->capacity) return NULL;
+    } while (!atomic_compare_exchange_weak_explicit(
+        &header->w.value, &w, w + aligned, memory_order_relaxed, memory_order_relaxed));
+
+    // 立即写入负的长度，消费者与 circular_buffer_unblock 据此得知记录的范围
+    struct circular_buffer_record *record = record_at(header, w);
+    // 记录头须先于数据可见，circular_buffer_unblock 才不会把数据误认为记录头
+    atomic_store_explicit(&record->length, -(int32_t)length, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    return record + 1;
+}
+
+void circular_buffer_commit(circular_buffer *cb, void *data, int type) {
+    assert(cb);
+    assert(data);
+    assert(type != CIRCULAR_BUFFER_PADDING);
+    struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
+    struct circular_buffer_record *record = (struct circular_buffer_record *)data - 1;
+    int const journal = header->flag & CIRCULAR_BUFFER_JOURNAL;
+    if (!(header->flag & CIRCULAR_BUFFER_MPSC)) {
+        record->type = type;
+        if (journal) seal_record(record, atomic_load_explicit(&record->length, memory_order_relaxed));
+        spsc_commit(header, record);
+        if (journal) journal_commit(header, header->w.committed);
+        return;
+    }
+
+    int32_t const length = atomic_load_explicit(&record->length, memory_order_relaxed);
+    assert(length < 0);
+    record->type = type;
+    if (journal) seal_record(record, -length);
+    atomic_store_explicit(&record->length, -length, memory_order_release);
+    notify(&header->w);
+    if (journal) journal_commit(header, record_end(header, record, -length));
+}
+
+size_t circular_buffer_read_records(circular_buffer *cb,
+                                    circular_buffer_record_handler handler,
+                                    void *arg,
+                                    size_t limit) {
+    assert(cb);
+    assert(handler);
+    struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
+    int const mpsc = header->flag & CIRCULAR_BUFFER_MPSC;
+
+    // 写索引之后的空间可能是整圈之前的记录，不能越过写索引
+    // 单生产者模式下写索引之前的记录都已提交，使用缓存的写索引，用尽时才刷新
+    size_t const r = load_own(&header->r);
+    size_t const w = mpsc ? load_peer(&header->w) : r + readable_size(header, 1);
+    size_t pos = r;
+    size_t count = 0;
+    while (count < limit && pos != w) {
+        struct circular_buffer_record *record = record_at(header, pos);
+        int32_t const length = atomic_load_explicit(
+            &record->length, mpsc ? memory_order_acquire : memory_order_relaxed);
+        if (length <= 0) break;
+
+        if (record->type != CIRCULAR_BUFFER_PADDING) {
+            handler(record->type, record + 1, length - sizeof *record - checksum_size(header), arg);
+            ++count;
+        }
+
+        pos += record_aligned(length);
+    }
+
+    // 一批记录只推进一次读索引
+    // 多生产者模式下清零后再归还，生产者以 acquire 语义读取读索引后才会写入
+    if (pos != r) {
+        if (mpsc) memset(buffer_pos(header, r), 0, pos - r);
+        store_own(&header->r, pos);
+        notify(&header->r);
+    }
+
+    return count;
+}
+
+int circular_buffer_unblock(circular_buffer *cb) {
+    assert(cb);
+    struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
+    assert(header->flag & CIRCULAR_BUFFER_MPSC);
+
+    size_t const r = load_own(&header->r);
+    size_t const w = load_peer(&header->w);
+    if (r == w) return 0;
+
+    struct circular_buffer_record *record = record_at(header, r);
+    int32_t const length = atomic_load_explicit(&record->length, memory_order_acquire);
+    if (length > 0) return 0;
+
+    // 生产者在写入数据时停止，记录范围已知
+    if (length < 0) {
+        record->type = CIRCULAR_BUFFER_PADDING;
+        atomic_store_explicit(&record->length, -length, memory_order_release);
+        return 1;
+    }
+
+    // 生产者在预订后、写入记录头前停止，其空间仍全为 0，下一个非 0 的记录头即是其结束位置
+    for (size_t pos = r + RECORD_ALIGNMENT; pos < w; pos += RECORD_ALIGNMENT) {
+        if (atomic_load_explicit(&record_at(header, pos)->length, memory_order_acquire) == 0) {
+            continue;
+        }
+
+        // 再次确认中间的空间没有被写入
+        for (size_t i = r; i < pos; i += RECORD_ALIGNMENT) {
+            if (atomic_load_explicit(&record_at(header, i)->length, memory_order_acquire) != 0) {
+                return 0;
+            }
+        }
+
+        record->type = CIRCULAR_BUFFER_PADDING;
+        atomic_store_explicit(&record->length, (int32_t)(pos - r), memory_order_release);
+        return 1;
+    }
+
+    // 之后的生产者也尚未写入记录头，无法确定范围
+    return 0;
+}
+
+// 单生产者单消费者模式下消费者可读的长度
+static size_t spsc_readable(struct circular_buffer_header *cb) { return readable_size(cb, SIZE_MAX); }
+
+// 单生产者单消费者模式下生产者可写的长度
+static size_t spsc_writable(struct circular_buffer_header *cb) { return writable_size(cb, SIZE_MAX); }
+
+// 多生产者模式下读索引处已提交记录的长度
+static size_t mpsc_readable(struct circular_buffer_header *cb) {
+    size_t const r = load_own(&cb->r);
+    if (r == load_peer(&cb->w)) return 0;
+    int32_t const length = atomic_load_explicit(&record_at(cb, r)->length, memory_order_acquire);
+    return length > 0 ? (size_t)length : 0;
+}
+
+// 多生产者模式下的空闲空间，生产者之间不共享缓存
+static size_t mpsc_writable(struct circular_buffer_header *cb) {
+    return cb->capacity - (load_own(&cb->w) - load_peer(&cb->r));
+}
+
+size_t circular_buffer_wait_readable(circular_buffer *cb, size_t size, int timeout) {
+    assert(cb);
+    struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
+    if (header->flag & CIRCULAR_BUFFER_MPSC) {
+        return wait_for(header, &header->w, mpsc_readable, 1, timeout);
+    }
+
+    return wait_for(header, &header->w, spsc_readable, size ? size : 1, timeout);
+}
+
+size_t circular_buffer_wait_writable(circular_buffer *cb, size_t size, int timeout) {
+    assert(cb);
+    struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
+    if (header->flag & CIRCULAR_BUFFER_MPSC) {
+        size = record_aligned(record_length(header, size));
+        return wait_for(header, &header->r, mpsc_writable, size, timeout);
+    }
+
+    // 单生产者使用记录接口时同样换算为记录长度，并计入尚未提交的预订
+    if ((header->flag & CIRCULAR_BUFFER_JOURNAL) || header->w.records) {
+        size = record_aligned(record_length(header, size));
+        if (header->w.reserved != header->w.committed)
+            size += header->w.reserved - load_own(&header->w);
+    }
+
+    return wait_for(header, &header->r, spsc_writable, size ? size : 1, timeout);
+}
+
+void circular_buffer_set_sync_interval(circular_buffer *cb, size_t bytes, int timeout) {
+    assert(cb);
+    struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
+    assert(header->flag & CIRCULAR_BUFFER_JOURNAL);
+    atomic_store_explicit(&header->journal.sync_bytes, bytes, memory_order_relaxed);
+    atomic_store_explicit(&header->journal.sync_ns, timeout > 0 ? (uint64_t)timeout * 1000000 : 0,
+                          memory_order_relaxed);
+}
+
+int circular_buffer_sync(circular_buffer *cb) {
+    assert(cb);
+    struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
+    assert(header->flag & CIRCULAR_BUFFER_JOURNAL);
+
+    // 正在进行的持久化可能在本次调用前的提交之前就读取了写索引与记录，
+    // 因此重试直到自己完成一次持久化，或之后开始的一次持久化已完成。
+    // 与 journal_sync 中递增序号的操作均为 seq_cst，之后开始的持久化一定能看到之前的提交
+    atomic_thread_fence(memory_order_seq_cst);
+    uint64_t const target = atomic_load(&header->journal.sync_started) + 1;
+    for (;;) {
+        int const ret = journal_sync(header);
+        if (ret <= 0) return ret;
+        if (atomic_load_explicit(&header->journal.sync_done, memory_order_acquire) >= target)
+            return 0;
+        sched_yield();
+    }
+}
+
+size_t circular_buffer_get_synced(circular_buffer *cb) {
+    assert(cb);
+    struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
+    assert(header->flag & CIRCULAR_BUFFER_JOURNAL);
+    return atomic_load_explicit(&header->journal.synced, memory_order_acquire);
+}
+
+size_t circular_buffer_recover(circular_buffer *cb) {
+    assert(cb);
+    struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
+    assert(header->flag & CIRCULAR_BUFFER_JOURNAL);
+    int const mpsc = header->flag & CIRCULAR_BUFFER_MPSC;
+
+    // 索引本身也可能损坏，此时丢弃全部数据
+    size_t const r = load_own(&header->r);
+    size_t w = load_own(&header->w);
+    if (w - r > header->capacity) w = r;
+
+    // 从读索引开始校验，遇到第一条不完整的记录即停止
+    size_t pos = r;
+    size_t count = 0;
+    while (pos != w) {
+        struct circular_buffer_record *record = record_at(header, pos);
+        int32_t length = atomic_load_explicit(&record->length, memory_order_relaxed);
+
+        // 多生产者模式下提交前崩溃的记录范围已知，改为填充记录
+        if (mpsc && length < 0) {
+            length = -length;
+            if (length < (int32_t)sizeof *record || record_aligned(length) > w - pos) break;
+            record->type = CIRCULAR_BUFFER_PADDING;
+            atomic_store_explicit(&record->length, length, memory_order_relaxed);
+            pos += record_aligned(length);
+            continue;
+        }
+
+        if (length < (int32_t)(sizeof *record) || record_aligned(length) > w - pos) break;
+        if (record->type != CIRCULAR_BUFFER_PADDING) {
+            if (length < (int32_t)(sizeof *record + RECORD_CHECKSUM_SIZE) ||
+                !verify_record(record, length)) {
+                break;
+            }
+            ++count;
+        }
+
+        pos += record_aligned(length);
+    }
+
+    // 截断不完整的记录，多生产者模式下清零以恢复“长度为 0 表示尚未写入”的约定
+    if (mpsc && pos != w) memset(buffer_pos(header, pos), 0, w - pos);
+
+    // 重置进程内的状态
+    atomic_store_explicit(&header->w.value, pos, memory_order_relaxed);
+    header->r.cache = pos;
+    atomic_store_explicit(&header->r.futex, 0, memory_order_relaxed);
+    header->w.cache = r;
+    header->w.reserved = header->w.committed = pos;
+    atomic_store_explicit(&header->w.futex, 0, memory_order_relaxed);
+    atomic_store_explicit(&header->journal.synced, pos, memory_order_relaxed);
+    atomic_store_explicit(&header->journal.syncing, 0, memory_order_release);
+    return count;
+}
+
+int circular_buffer_get_numa_node(circular_buffer *cb) {
+    assert(cb);
+    struct circular_buffer_header *header = (struct circular_buffer_header *)cb;
+
+    // 在数据区均匀抽取若干页查询所在节点，返回多数页所在的节点
+    enum { SAMPLES = 64 };
+    size_t const page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t const pages = header->capacity / page_size;
+    size_t const count = pages < SAMPLES ? pages : SAMPLES;
+    void *addrs[SAMPLES];
+    int status[SAMPLES];
+    for (size_t i = 0; i < count; ++i) {
+        addrs[i] = buffer_start(header) + i * (pages / count) * page_size;
+    }
+
+    if (syscall(SYS_move_pages, 0, count, addrs, NULL, status, 0) != 0) return -1;
+
+    int best = -1;
+    size_t best_votes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (status[i] < 0) continue;
+        size_t votes = 0;
+        for (size_t j = 0; j < count; ++j) votes += status[j] == status[i];
+        if (votes > best_votes) {
+            best = status[i];
+            best_votes = votes;
+        }
+    }
+
+    return best;
+}
+
 void circular_buffer_detach(circular_buffer *cb) {
     assert(cb);
     // 计算共享内存大小
@@ -8,12 +8,104 @@ extern "C" {
 
 /**
  * \brief 环形缓冲区
- *        生产者与消费者同时访问缓冲区时无须加锁
- *        多个生产者访问同一个缓冲区时，生产者之间需要加锁
+ *        生产者与消费者同时访问缓冲区时无须加锁，读写索引以 acquire/release 语义同步，
+ *        可跨线程、跨进程使用
+ *        默认为单生产者单消费者；多个生产者访问同一个缓冲区时，以 CIRCULAR_BUFFER_MPSC 创建，
+ *        生产者之间无须加锁
  *        多个消费者访问同一个缓冲区时，消费者之间需要加锁
+ *        两方各自缓存对端索引，缓存的长度不够本次所需时才读取对端索引，
+ *        因此 get_readable/get_writable 返回的长度可能小于实际可用长度；
+ *        需要一定长度时使用 get_readable_min/get_writable_min
  */
 typedef void circular_buffer;
 
+/**
+ * \brief 多生产者单消费者模式
+ *        生产者通过 circular_buffer_reserve 原子地预订空间，各自并行写入，
+ *        通过 circular_buffer_commit 乱序提交；消费者通过 circular_buffer_read_records
+ *        只读取从读索引开始连续已提交的记录。
+ *        此模式下不可使用 get_readable/get_writable/pop_data/push_data 接口，
+ *        容量不能超过 2GB
+ */
+#define CIRCULAR_BUFFER_MPSC 0x1
+
+/**
+ * \brief 以 memfd_create 代替 shm_open 创建共享内存，不依赖 /dev/shm 命名空间
+ *        此时 name 仅用于调试，缓冲区无法通过名称附着，可通过 fork 共享，
+ *        或自行创建 memfd 后调用 circular_buffer_fcreate，再通过 Unix 域套接字传递文件描述符
+ */
+#define CIRCULAR_BUFFER_MEMFD 0x2
+
+/**
+ * \brief 使用 2MB 大页（MFD_HUGETLB），隐含 CIRCULAR_BUFFER_MEMFD
+ *        容量与头部都对齐到 2MB，系统预留的大页不足时创建失败
+ */
+#define CIRCULAR_BUFFER_HUGE_2MB 0x4
+
+/**
+ * \brief 使用 1GB 大页（MFD_HUGETLB），隐含 CIRCULAR_BUFFER_MEMFD，不能与 CIRCULAR_BUFFER_HUGE_2MB 同时使用
+ *        容量与头部都对齐到 1GB，系统预留的大页不足时创建失败
+ */
+#define CIRCULAR_BUFFER_HUGE_1GB 0x8
+
+/**
+ * \brief 对映射调用 madvise(MADV_HUGEPAGE) 建议内核使用透明大页
+ *        容量与头部都对齐到 2MB，是否生效取决于 /sys/kernel/mm/transparent_hugepage/shmem_enabled
+ */
+#define CIRCULAR_BUFFER_THP 0x10
+
+/**
+ * \brief 日志模式，缓冲区建立在普通文件上，进程崩溃后内容与读写索引仍保留在文件中，可以恢复后重放
+ *        只能通过 circular_buffer_fcreate 在普通文件的描述符上创建，重启后通过 circular_buffer_fattach
+ *        附着并调用 circular_buffer_recover。只能使用记录接口，每条记录附加 CRC32C 校验和。
+ *        持久化由 circular_buffer_sync 或 circular_buffer_set_sync_interval 设置的组提交策略触发；
+ *        读索引与数据一同持久化，掉电后可能重放已消费的记录，即至少一次语义
+ */
+#define CIRCULAR_BUFFER_JOURNAL 0x20
+
+/**
+ * \brief 创建与附着时预分配整个映射（包括镜像）的物理页与页表，消除首次触碰时的缺页延迟
+ *        页表属于各个进程，附着的进程同样按创建时的标志预分配
+ */
+#define CIRCULAR_BUFFER_PREFAULT 0x40
+
+/**
+ * \brief 以 mlock 锁定整个映射，防止被换出，隐含 CIRCULAR_BUFFER_PREFAULT
+ *        受 RLIMIT_MEMLOCK 限制，锁定失败时创建或附着失败，errno 为 mlock 的错误码
+ */
+#define CIRCULAR_BUFFER_MLOCK 0x80
+
+/**
+ * \brief 将缓冲区绑定到指定 NUMA 节点，创建时以 mbind(MPOL_BIND) 绑定并预分配全部内存，
+ *        使内存不再落在首次触碰它的线程所在的节点。节点编号不能超过 CIRCULAR_BUFFER_MAX_NUMA_NODE
+ */
+#define CIRCULAR_BUFFER_NUMA_NODE(node) ((((node) + 1) & 0xff) << 8)
+
+/**
+ * \brief 从标志中取出 NUMA 节点编号，未指定时为 -1
+ */
+#define CIRCULAR_BUFFER_GET_NUMA_NODE(flag) ((((flag) >> 8) & 0xff) - 1)
+
+/**
+ * \brief 可绑定的最大 NUMA 节点编号
+ */
+#define CIRCULAR_BUFFER_MAX_NUMA_NODE 254
+
+/**
+ * \brief 填充记录类型，由 circular_buffer_unblock 产生，消费者读取时自动跳过
+ */
+#define CIRCULAR_BUFFER_PADDING (-1)
+
+/**
+ * \brief 记录处理函数
+ *
+ * \param type 记录类型
+ * \param data 记录数据
+ * \param size 记录数据长度
+ * \param arg  circular_buffer_read_records 传入的参数
+ */
+typedef void (*circular_buffer_record_handler)(int type, const void* data, size_t size, void* arg);
+
 struct buffer_piece {
     void* data;
     size_t size;
@@ -25,9 +117,9 @@ struct buffer_piece {
  * \param name         共享内存对象名称。如为空指针则创建无法附着的匿名缓冲区。
  *                     匿名缓冲区不创建共享内存对象，只能通过 fork 跨进程共享，无法通过 exec 跨进程共享。
  *                     命名缓冲区可以通过 fork、exec 跨进程共享。
- * \param capacity     缓冲区容量，实际分配的容量会向上对齐到 4KB
+ * \param capacity     缓冲区容量，实际分配的容量会向上对齐到页大小，使用大页时对齐到大页大小
  * \param private_size 私有数据区大小，用于存储私有数据
- * \param flag         创建缓冲区时使用的标志，暂时未使用
+ * \param flag         创建缓冲区时使用的标志，CIRCULAR_BUFFER_* 按位或，0 表示单生产者单消费者
  *
  * \return 成功时返回环形缓冲区对象指针，失败时返回空指针
  */
@@ -37,10 +129,11 @@ circular_buffer* circular_buffer_create(
 /**
  * \brief 创建环形缓冲区
  *
- * \param shmfd        共享内存对象文件描述符，需要以 O_RDWR 方式打开；当 shmfd 值为 -1 时创建匿名缓冲区
- * \param capacity     缓冲区容量，实际分配的容量会向上对齐到 4KB
+ * \param shmfd        共享内存对象文件描述符，需要以 O_RDWR 方式打开；当 shmfd 值为 -1 时创建匿名缓冲区，
+ *                     使用大页时以 memfd 代替；使用大页时 shmfd 须以相应的 MFD_HUGETLB 标志创建
+ * \param capacity     缓冲区容量，实际分配的容量会向上对齐到页大小，使用大页时对齐到大页大小
  * \param private_size 私有数据区大小，用于存储私有数据
- * \param flag         创建缓冲区时使用的标志，暂时未使用
+ * \param flag         创建缓冲区时使用的标志，CIRCULAR_BUFFER_* 按位或，0 表示单生产者单消费者
  *
  * \return 成功时返回环形缓冲区对象指针，失败时返回空指针
  */
@@ -79,7 +172,8 @@ void * circular_buffer_get_private_data(circular_buffer* cb);
  *
  * \param cb 环形缓冲区对象指针，不可为空指针
  *
- * \return 返回 buffer_piece 结构，其中 data 字段总是不为空，通过检测 size 字段长判断可读空间的大小
+ * \return 返回 buffer_piece 结构，其中 data 字段总是不为空，通过检测 size 字段长判断可读空间的大小；
+ *         缓存的写索引用尽时才重新读取，长度可能小于实际可读长度
  */
 struct buffer_piece circular_buffer_get_readable(circular_buffer* cb);
 
@@ -88,10 +182,33 @@ struct buffer_piece circular_buffer_get_readable(circular_buffer* cb);
  *
  * \param cb 环形缓冲区对象指针，不可为空指针
  *
- * \return 返回 buffer_piece 结构，其中 data 字段总是不为空，通过检测 size 字段长判断可写空间的大小
+ * \return 返回 buffer_piece 结构，其中 data 字段总是不为空，通过检测 size 字段长判断可写空间的大小；
+ *         缓存的读索引用尽时才重新读取，长度可能小于实际可写长度
  */
 struct buffer_piece circular_buffer_get_writable(circular_buffer* cb);
 
+/**
+ * \brief 消费者接口，获取可读的 buffer，缓存的长度不足 size 时重新读取写索引
+ *        实际可读长度不少于 size 时返回的长度也不少于 size；size 为 SIZE_MAX 时返回调用时实际可读的长度
+ *
+ * \param cb   环形缓冲区对象指针，不可为空指针
+ * \param size 需要的可读长度
+ *
+ * \return 返回 buffer_piece 结构，含义同 circular_buffer_get_readable
+ */
+struct buffer_piece circular_buffer_get_readable_min(circular_buffer* cb, size_t size);
+
+/**
+ * \brief 生产者接口，获取可写的 buffer，缓存的长度不足 size 时重新读取读索引
+ *        实际可写长度不少于 size 时返回的长度也不少于 size；size 为 SIZE_MAX 时返回调用时实际可写的长度
+ *
+ * \param cb   环形缓冲区对象指针，不可为空指针
+ * \param size 需要的可写长度
+ *
+ * \return 返回 buffer_piece 结构，含义同 circular_buffer_get_writable
+ */
+struct buffer_piece circular_buffer_get_writable_min(circular_buffer* cb, size_t size);
+
 /**
  * \brief 消费者接口，丢弃已读数据，调用此接口来通知缓冲区对象来移动读索引
  *
@@ -112,6 +229,137 @@ size_t circular_buffer_pop_data(circular_buffer* cb, size_t size);
  */
 size_t circular_buffer_push_data(circular_buffer* cb, size_t size);
 
+/**
+ * \brief 记录接口：生产者预订一段连续空间写入一条记录后提交，消费者按条读取，无须自行分帧。
+ *        每条记录带有 8 字节的记录头（长度与类型），按 8 字节对齐；镜像内存区保证记录总是连续的。
+ *        单生产者单消费者模式下，生产者可以连续预订多条记录，按预订顺序提交，
+ *        全部提交后写索引只推进一次；消费者一次读取多条记录后读索引也只推进一次。
+ *        单生产者模式下不要在两次提交之间混用 push_data
+ */
+
+/**
+ * \brief 生产者接口，预订一条记录的空间
+ *        多生产者模式下多个生产者可以同时调用
+ *
+ * \param cb   环形缓冲区对象指针，不可为空指针
+ * \param size 记录数据长度
+ *
+ * \return 成功时返回记录数据的写入位置，空间不足时返回空指针
+ */
+void* circular_buffer_reserve(circular_buffer* cb, size_t size);
+
+/**
+ * \brief 生产者接口，提交已写入的记录
+ *        多生产者模式下提交顺序可以与预订顺序不同；
+ *        单生产者模式下须按预订顺序提交，提交最后一条已预订的记录时记录才对消费者可见
+ *
+ * \param cb   环形缓冲区对象指针，不可为空指针
+ * \param data circular_buffer_reserve 返回的写入位置
+ * \param type 记录类型，不能为 CIRCULAR_BUFFER_PADDING
+ */
+void circular_buffer_commit(circular_buffer* cb, void* data, int type);
+
+/**
+ * \brief 消费者接口，按预订顺序读取连续已提交的记录，跳过填充记录，遇到未提交的记录即停止
+ *        记录数据在处理函数返回前有效，读取结束后读索引推进一次。
+ *        多生产者模式下已读取的空间会被清零后归还给生产者
+ *
+ * \param cb      环形缓冲区对象指针，不可为空指针
+ * \param handler 记录处理函数
+ * \param arg     传给记录处理函数的参数
+ * \param limit   最多读取的记录数
+ *
+ * \return 返回读取的记录数，不含填充记录
+ */
+size_t circular_buffer_read_records(
+    circular_buffer* cb, circular_buffer_record_handler handler, void* arg, size_t limit);
+
+/**
+ * \brief 消费者接口，跳过读索引处迟迟未提交的记录
+ *        用于生产者在预订后、提交前崩溃的情况，将该记录改为填充记录，避免缓冲区永久阻塞。
+ *        只应在读索引长时间没有推进、确认对应生产者已不会提交时调用，
+ *        对仍在写入的生产者调用会导致其记录丢失
+ *
+ * \param cb 以 CIRCULAR_BUFFER_MPSC 创建的环形缓冲区对象指针，不可为空指针
+ *
+ * \return 跳过了记录时返回 1，否则返回 0
+ */
+int circular_buffer_unblock(circular_buffer* cb);
+
+/**
+ * \brief 消费者接口，阻塞等待直到可读数据不少于 size 或超时
+ *        等待方在缓冲区头部的 futex 字上设置等待标志后休眠，生产者只在看到等待标志时才唤醒，
+ *        无人等待时生产者不进行系统调用。可跨进程使用
+ *
+ * \param cb      环形缓冲区对象指针，不可为空指针
+ * \param size    期望的可读长度；多生产者模式下忽略，等待读索引处的记录提交
+ * \param timeout 超时时间，单位毫秒，负数表示一直等待
+ *
+ * \return 返回当前可读长度，多生产者模式下为读索引处记录的长度，超时时可能小于 size
+ */
+size_t circular_buffer_wait_readable(circular_buffer* cb, size_t size, int timeout);
+
+/**
+ * \brief 生产者接口，阻塞等待直到可写空间不少于 size 或超时
+ *
+ * \param cb      环形缓冲区对象指针，不可为空指针
+ * \param size    期望的可写长度；多生产者模式、日志模式或单生产者最近使用记录接口时为记录数据长度，
+ *                换算为含记录头、校验和与对齐的记录长度，单生产者还计入尚未提交的预订
+ * \param timeout 超时时间，单位毫秒，负数表示一直等待
+ *
+ * \return 返回当前可写长度，按记录长度等待时为空闲空间长度，超时时可能小于期望长度
+ */
+size_t circular_buffer_wait_writable(circular_buffer* cb, size_t size, int timeout);
+
+/**
+ * \brief 日志模式，设置组提交策略，生产者提交记录时检查是否需要持久化
+ *        多个生产者同时触发时只有一个执行持久化，其余直接返回
+ *
+ * \param cb      以 CIRCULAR_BUFFER_JOURNAL 创建的环形缓冲区对象指针，不可为空指针
+ * \param bytes   未持久化的数据达到此长度时持久化，0 表示不按长度
+ * \param timeout 距上次持久化达到此时长时持久化，单位毫秒，0 表示不按时间
+ */
+void circular_buffer_set_sync_interval(circular_buffer* cb, size_t bytes, int timeout);
+
+/**
+ * \brief 日志模式，以 msync 持久化已提交的记录，再持久化头部中的读写索引
+ *
+ * \param cb 以 CIRCULAR_BUFFER_JOURNAL 创建的环形缓冲区对象指针，不可为空指针
+ *
+ * \return 成功时返回 0，失败时返回 -1 并设置 errno
+ */
+int circular_buffer_sync(circular_buffer* cb);
+
+/**
+ * \brief 日志模式，查询已持久化到的写位置，之前的记录都已提交并持久化
+ *        多生产者模式下只推进到第一条尚未提交的记录，可用于监控持久化的滞后
+ *
+ * \param cb 以 CIRCULAR_BUFFER_JOURNAL 创建的环形缓冲区对象指针，不可为空指针
+ *
+ * \return 返回已持久化到的写位置，与读写索引一样单调递增
+ */
+size_t circular_buffer_get_synced(circular_buffer* cb);
+
+/**
+ * \brief 日志模式，重启后附着时调用，此时不能有其他生产者与消费者
+ *        从读索引开始校验未消费的记录，截断第一条长度或校验和不正确的记录及其之后的数据，
+ *        多生产者模式下提交前崩溃的记录改为填充记录。之后通过 circular_buffer_read_records 重放
+ *
+ * \param cb 以 CIRCULAR_BUFFER_JOURNAL 创建的环形缓冲区对象指针，不可为空指针
+ *
+ * \return 返回可重放的记录数
+ */
+size_t circular_buffer_recover(circular_buffer* cb);
+
+/**
+ * \brief 查询缓冲区数据实际所在的 NUMA 节点，用于将读写线程绑定到数据所在的节点
+ *
+ * \param cb 环形缓冲区对象指针，不可为空指针
+ *
+ * \return 返回抽样页中多数页所在的节点，内存尚未分配或系统不支持时返回 -1
+ */
+int circular_buffer_get_numa_node(circular_buffer* cb);
+
 /**
  * \brief 解除附着，释放内存，共享内存对象不会销毁
  *
@@ -123,7 +123,7 @@ class circular_queue {
    protected:
     pointer at(size_t const idx) const {
         assert(buffer_);
-        return static_cast<pointer *>(buffer_)[idx & mask_];
+        return static_cast<pointer>(buffer_) + (idx & mask_);
     }
 
    private:
@@ -0,0 +1,182 @@
+#include "cpu_topology.h"
+
+#include <sched.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <utility>
+
+#include "utility.h"
+
+namespace flyzero {
+
+// 读取 sysfs 文件的第一行，失败时返回空串
+static std::string read_line(const std::string &path) {
+    std::ifstream in{path};
+    std::string   line;
+    std::getline(in, line);
+    return line;
+}
+
+// 解析非负整数，失败时返回 false
+static bool parse_uint(std::string_view str, unsigned &value) {
+    if (str.empty()) return false;
+    value = 0;
+    for (auto const c : str) {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + static_cast<unsigned>(c - '0');
+    }
+    return true;
+}
+
+std::vector<unsigned> cpu_topology::parse_list(std::string_view list) {
+    std::vector<unsigned> cpus;
+    while (!list.empty()) {
+        auto const [item, rest]  = utility::split(list, ',');
+        auto const [first, last] = utility::split(item, '-');
+
+        unsigned lo, hi;
+        if (!parse_uint(first, lo)) break;
+        if (last.empty()) {
+            hi = lo;
+        } else if (!parse_uint(last, hi) || hi < lo) {
+            break;
+        }
+
+        for (auto i = lo; i <= hi; ++i) cpus.push_back(i);
+        list = rest;
+    }
+
+    return cpus;
+}
+
+cpu_topology::cpu_topology(std::string_view root) {
+    std::string const base{root};
+
+    for (auto const id : parse_list(read_line(base + "/cpu/online"))) {
+        auto const dir = base + "/cpu/cpu" + std::to_string(id) + "/topology/";
+        cpu        c{id, 0, id, 0};
+
+        // 缺少拓扑信息时视为独占一个物理核心
+        unsigned v;
+        if (parse_uint(read_line(dir + "physical_package_id"), v)) c.package = v;
+        if (parse_uint(read_line(dir + "core_id"), v)) c.core = v;
+        cpus_.push_back(c);
+    }
+
+    if (cpus_.empty()) {
+        auto const n = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned id = 0; id < n; ++id) cpus_.push_back({id, 0, id, 0});
+    }
+
+    // 节点的 cpulist 列出属于它的逻辑 CPU，没有 NUMA 信息时全部属于节点 0
+    for (auto const node : parse_list(read_line(base + "/node/online"))) {
+        auto const path = base + "/node/node" + std::to_string(node) + "/cpulist";
+        auto const list = parse_list(read_line(path));
+        for (auto &c : cpus_) {
+            if (std::find(list.begin(), list.end(), c.id) != list.end()) c.node = node;
+        }
+    }
+
+    std::set<std::pair<unsigned, unsigned>> cores;
+    std::set<unsigned>                      nodes;
+    for (auto const &c : cpus_) {
+        cores.emplace(c.package, c.core);
+        nodes.insert(c.node);
+    }
+    cores_ = cores.size();
+    nodes_ = nodes.size();
+}
+
+const cpu_topology &cpu_topology::current() {
+    static cpu_topology const topology;
+    return topology;
+}
+
+const std::vector<cpu_topology::cpu> &cpu_topology::cpus() const noexcept { return cpus_; }
+
+size_t cpu_topology::get_core_count() const noexcept { return cores_; }
+
+size_t cpu_topology::get_node_count() const noexcept { return nodes_; }
+
+std::vector<unsigned> cpu_topology::node_cpus(unsigned node) const {
+    std::vector<unsigned> ids;
+    for (auto const &c : cpus_) {
+        if (c.node == node) ids.push_back(c.id);
+    }
+    return ids;
+}
+
+std::vector<unsigned> cpu_topology::spread() const {
+    // 同一物理核心上的逻辑 CPU 依次分到第 0、1、... 轮
+    std::map<std::pair<unsigned, unsigned>, unsigned> seen;
+    std::vector<std::pair<unsigned, const cpu *>>     order;
+    for (auto const &c : cpus_) order.emplace_back(seen[{c.package, c.core}]++, &c);
+
+    std::stable_sort(order.begin(), order.end(), [](auto const &a, auto const &b) {
+        return a.first != b.first ? a.first < b.first : a.second->node < b.second->node;
+    });
+
+    std::vector<unsigned> ids;
+    for (auto const &[round, c] : order) ids.push_back(c->id);
+    return ids;
+}
+
+thread_placement thread_placement::pin(std::vector<unsigned> cpus) {
+    if (cpus.empty()) throw std::invalid_argument{"No CPU to pin to"};
+    return {policy::pin, std::move(cpus)};
+}
+
+thread_placement thread_placement::spread(const cpu_topology &topology) {
+    return {policy::spread, topology.spread()};
+}
+
+thread_placement thread_placement::numa(unsigned node, const cpu_topology &topology) {
+    auto cpus = topology.node_cpus(node);
+    if (cpus.empty()) throw std::invalid_argument{"NUMA node has no online CPU"};
+    return {policy::numa, std::move(cpus)};
+}
+
+thread_placement::policy thread_placement::get_policy() const noexcept { return policy_; }
+
+std::vector<unsigned> thread_placement::cpus_for(size_t index) const {
+    switch (policy_) {
+    case policy::pin:
+    case policy::spread:
+        return {cpus_[index % cpus_.size()]};
+    case policy::numa:
+        return cpus_;
+    default:
+        return {};
+    }
+}
+
+void thread_placement::apply(pthread_t thread, size_t index) const {
+    auto const cpus = cpus_for(index);
+    if (cpus.empty()) return;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto const id : cpus) {
+        if (id >= CPU_SETSIZE) throw std::invalid_argument{"CPU id exceeds CPU_SETSIZE"};
+        CPU_SET(id, &set);
+    }
+
+    auto const err = ::pthread_setaffinity_np(thread, sizeof set, &set);
+    if (err != 0) {
+        throw utility::system_error(
+            err, "pthread_setaffinity_np(%zu CPUs) failed: %s", cpus.size(), std::strerror(err));
+    }
+}
+
+void thread_placement::apply(std::thread &thread, size_t index) const {
+    apply(thread.native_handle(), index);
+}
+
+void thread_placement::apply_current(size_t index) const { apply(::pthread_self(), index); }
+
+}  // namespace flyzero
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <pthread.h>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace flyzero {
+
+/**
+ * @brief CPU 拓扑，从 /sys/devices/system 读取在线的逻辑 CPU 及其所属物理核心与 NUMA 节点
+ *
+ * 读取失败时退化为 std::thread::hardware_concurrency() 个逻辑 CPU，每个独占一个物理核心，同属节点 0。
+ */
+class cpu_topology {
+public:
+    /**
+     * @brief 逻辑 CPU
+     */
+    struct cpu {
+        unsigned id;       ///< 逻辑 CPU 编号
+        unsigned package;  ///< 物理封装编号
+        unsigned core;     ///< 封装内的物理核心编号
+        unsigned node;     ///< NUMA 节点编号
+    };
+
+    /**
+     * @brief 读取拓扑
+     *
+     * @param root sysfs 中 system 目录的路径，测试时可指向伪造的目录
+     */
+    explicit cpu_topology(std::string_view root = "/sys/devices/system");
+
+    /**
+     * @brief 本机拓扑，首次调用时读取并缓存
+     */
+    static const cpu_topology &current();
+
+    /**
+     * @brief 全部在线逻辑 CPU，按编号升序
+     */
+    const std::vector<cpu> &cpus() const noexcept;
+
+    /**
+     * @brief 物理核心数
+     */
+    size_t get_core_count() const noexcept;
+
+    /**
+     * @brief NUMA 节点数
+     */
+    size_t get_node_count() const noexcept;
+
+    /**
+     * @brief 指定 NUMA 节点的逻辑 CPU 编号
+     */
+    std::vector<unsigned> node_cpus(unsigned node) const;
+
+    /**
+     * @brief 分散排列的逻辑 CPU 编号
+     *
+     * 先按节点依次取每个物理核心的第一个逻辑 CPU，再取超线程兄弟，
+     * 前 get_core_count() 个线程各占一个物理核心。
+     */
+    std::vector<unsigned> spread() const;
+
+    /**
+     * @brief 解析 "0-3,8,10-11" 形式的 CPU 列表，格式错误时返回已解析的部分
+     */
+    static std::vector<unsigned> parse_list(std::string_view list);
+
+private:
+    std::vector<cpu> cpus_;   ///< 在线逻辑 CPU
+    size_t           cores_;  ///< 物理核心数
+    size_t           nodes_;  ///< NUMA 节点数
+};
+
+/**
+ * @brief 线程放置策略
+ *
+ * 一组线程按各自的序号放置：pin 与 spread 把第 i 个线程绑定到一个逻辑 CPU，
+ * 线程数多于 CPU 时循环使用；numa 把线程限制在节点的全部 CPU 上，由调度器在节点内迁移。
+ */
+class thread_placement {
+public:
+    enum class policy {
+        none,    ///< 不限制，由调度器决定
+        pin,     ///< 绑定到指定的逻辑 CPU
+        spread,  ///< 分散到不同的物理核心
+        numa,    ///< 限制在一个 NUMA 节点
+    };
+
+    /**
+     * @brief 不限制
+     */
+    thread_placement() = default;
+
+    /**
+     * @brief 依次绑定到 cpus 中的逻辑 CPU
+     */
+    static thread_placement pin(std::vector<unsigned> cpus);
+
+    /**
+     * @brief 依次绑定到 topology.spread() 中的逻辑 CPU
+     */
+    static thread_placement spread(const cpu_topology &topology = cpu_topology::current());
+
+    /**
+     * @brief 限制在 NUMA 节点 node
+     */
+    static thread_placement numa(unsigned            node,
+                                 const cpu_topology &topology = cpu_topology::current());
+
+    /**
+     * @brief 策略
+     */
+    policy get_policy() const noexcept;
+
+    /**
+     * @brief 第 index 个线程允许运行的逻辑 CPU，不限制时为空
+     */
+    std::vector<unsigned> cpus_for(size_t index) const;
+
+    /**
+     * @brief 放置线程，失败时抛出 std::system_error
+     */
+    void apply(pthread_t thread, size_t index) const;
+
+    /**
+     * @brief 放置线程，task_queue_thread 等派生类同样适用
+     */
+    void apply(std::thread &thread, size_t index = 0) const;
+
+    /**
+     * @brief 放置调用线程，例如在运行 event_dispatch 的线程中调用
+     */
+    void apply_current(size_t index = 0) const;
+
+private:
+    thread_placement(policy p, std::vector<unsigned> cpus) : policy_{p}, cpus_{std::move(cpus)} {}
+
+    policy                policy_{policy::none};  ///< 策略
+    std::vector<unsigned> cpus_;                  ///< 候选逻辑 CPU
+};
+
+}  // namespace flyzero
@@ -67,6 +67,10 @@ void event_dispatch::run_once(std::chrono::milliseconds timeout) {
     // 处理 IO 事件
     for (int i = 0; i < n; ++i) {
         auto const listener = static_cast<io_listener *>(events[i].data.ptr);
+        if (events[i].events & EPOLLERR) {
+            listener->on_error();
+        }
+
         if (events[i].events & EPOLLIN) {
             listener->on_read();
         }
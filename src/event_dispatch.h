@@ -10,6 +10,7 @@
 #include <system_error>
 #include <vector>
 
+#include "cpu_topology.h"
 #include "file_descriptor.h"
 
 namespace flyzero {
@@ -111,6 +112,16 @@ public:
      */
     void run_loop(std::chrono::milliseconds timeout);
 
+    /**
+     * @brief 按放置策略放置调用线程后运行事件循环
+     * @param timeout 超时时间
+     * @param placement 放置策略
+     * @param index 调用线程在一组事件循环线程中的序号
+     */
+    void run_loop(std::chrono::milliseconds timeout,
+                  const thread_placement   &placement,
+                  size_t                    index = 0);
+
     /**
      * @brief 运行一次事件循环
      * @param timeout 超时时间
@@ -150,6 +161,11 @@ public:
 
     virtual void on_write() = 0;
 
+    /**
+     * @brief 处理 EPOLLERR，例如读取套接字错误队列，默认忽略
+     */
+    virtual void on_error() {}
+
 private:
     file_descriptor fd_;  ///< 监听的文件描述符
 };
@@ -203,6 +219,13 @@ inline void event_dispatch::run_loop(std::chrono::milliseconds timeout) {
     }
 }
 
+inline void event_dispatch::run_loop(std::chrono::milliseconds timeout,
+                                     const thread_placement   &placement,
+                                     size_t                    index) {
+    placement.apply_current(index);
+    run_loop(timeout);
+}
+
 inline void event_dispatch::on_loop() {
     for (auto const listener : loop_listeners_) {
         listener->on_loop();
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace flyzero {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "std::atomic<uint32_t> must be usable as a futex word");
+
+namespace futex {
+
+/**
+ * @brief 若 word 仍等于 expected 则休眠，直到被唤醒、被信号中断或超时，可能虚假唤醒
+ *
+ * @param word 进程内的 futex 字
+ * @param expected 期望值
+ * @param timeout 超时时间，为负时不超时
+ * @return 超时时返回 false
+ */
+inline bool wait(std::atomic<uint32_t>   &word,
+                 uint32_t                 expected,
+                 std::chrono::nanoseconds timeout = std::chrono::nanoseconds{-1}) noexcept {
+    timespec  ts{};
+    timespec *pts = nullptr;
+    if (timeout.count() >= 0) {
+        ts.tv_sec  = static_cast<time_t>(timeout.count() / 1000000000);
+        ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+        pts        = &ts;
+    }
+
+    // FUTEX_WAIT 的超时时间是相对 CLOCK_MONOTONIC 的
+    auto const ret = ::syscall(SYS_futex, &word, FUTEX_WAIT_PRIVATE, expected, pts, nullptr, 0);
+    return ret == 0 || errno != ETIMEDOUT;
+}
+
+/**
+ * @brief 唤醒在 word 上休眠的至多 count 个线程
+ */
+inline void wake(std::atomic<uint32_t> &word, int count = INT_MAX) noexcept {
+    ::syscall(SYS_futex, &word, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+}  // namespace futex
+
+/**
+ * @brief 单写者自增，其他线程可以随时读取
+ */
+template <typename T>
+inline void increase(std::atomic<T> &counter, std::type_identity_t<T> n = 1) noexcept {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+/**
+ * @brief 自旋等待时提示 CPU 降低功耗并让出流水线给超线程
+ */
+inline void cpu_relax() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+/**
+ * @brief 事件计数，让等待条件成立的线程休眠在 futex 上，通知方只在确有线程等待时才进入内核
+ *
+ * 等待方：
+ *     auto const key = ec.prepare_wait();
+ *     if (条件成立) ec.cancel_wait(); else ec.wait(key);
+ * 通知方先使条件成立，再调用 notify_one 或 notify_all。
+ */
+class event_count {
+public:
+    /**
+     * @brief 登记为等待者，返回的键用于 wait，登记后必须再检查一次条件
+     */
+    uint32_t prepare_wait() noexcept;
+
+    /**
+     * @brief 条件已成立，取消登记
+     */
+    void cancel_wait() noexcept;
+
+    /**
+     * @brief 休眠直到被通知或超时，返回时已取消登记
+     *
+     * @param key prepare_wait 返回的键，此后有过通知时立即返回
+     * @param timeout 超时时间，为负时不超时
+     * @return 超时时返回 false
+     */
+    bool wait(uint32_t key, std::chrono::nanoseconds timeout = std::chrono::nanoseconds{-1}) noexcept;
+
+    /**
+     * @brief 唤醒一个等待者
+     */
+    void notify_one() noexcept;
+
+    /**
+     * @brief 唤醒全部等待者
+     */
+    void notify_all() noexcept;
+
+    /**
+     * @brief 是否有登记的等待者
+     */
+    bool has_waiters() const noexcept;
+
+private:
+    /**
+     * @brief 有等待者时推进纪元并唤醒至多 count 个线程
+     */
+    void notify(int count) noexcept;
+
+    std::atomic<uint32_t> epoch_{0};    ///< 通知纪元，作为 futex 字
+    std::atomic<uint32_t> waiters_{0};  ///< 登记的等待者数
+};
+
+inline uint32_t event_count::prepare_wait() noexcept {
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    return epoch_.load(std::memory_order_seq_cst);
+}
+
+inline void event_count::cancel_wait() noexcept {
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+inline bool event_count::wait(uint32_t key, std::chrono::nanoseconds timeout) noexcept {
+    auto notified = true;
+    if (epoch_.load(std::memory_order_acquire) == key) notified = futex::wait(epoch_, key, timeout);
+    cancel_wait();
+    return notified || epoch_.load(std::memory_order_acquire) != key;
+}
+
+inline void event_count::notify_one() noexcept { notify(1); }
+
+inline void event_count::notify_all() noexcept { notify(INT_MAX); }
+
+inline bool event_count::has_waiters() const noexcept {
+    return waiters_.load(std::memory_order_relaxed) != 0;
+}
+
+inline void event_count::notify(int count) noexcept {
+    // 与等待方的 prepare_wait 配对：要么通知方看到等待者，要么等待方看到条件成立
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) return;
+
+    epoch_.fetch_add(1, std::memory_order_acq_rel);
+    futex::wake(epoch_, count);
+}
+
+/**
+ * @brief 等待 poll 取到结果：先自旋 spin_count 次，再让出 CPU yield_count 次，仍为空则登记到 ec 上休眠
+ *
+ * 单核时自旋和让出都只会推迟生产者（刚让出过 CPU 的线程被唤醒后不会抢占生产者），直接休眠。
+ * 生产者使条件成立后调用 ec.notify_one。
+ *
+ * @param ec 事件计数
+ * @param poll 取结果的函数，返回值可按 bool 判断是否为空
+ * @param on_park 每次休眠前调用，可用于统计休眠次数
+ * @return poll 取到的非空结果
+ */
+template <typename Poll, typename OnPark>
+auto spin_then_park(event_count &ec, Poll &&poll, OnPark &&on_park, int spin_count = 256, int yield_count = 16)
+    -> decltype(poll()) {
+    static bool const multi_core = std::thread::hardware_concurrency() > 1;
+    auto const        spins      = multi_core ? spin_count : 0;
+    auto const        yields     = multi_core ? yield_count : 0;
+
+    for (;;) {
+        auto r = poll();
+        for (int i = 0; !r && i < spins; ++i) {
+            cpu_relax();
+            r = poll();
+        }
+
+        for (int i = 0; !r && i < yields; ++i) {
+            std::this_thread::yield();
+            r = poll();
+        }
+
+        if (r) return r;
+
+        // 登记后再检查一次，生产者要么看到登记并唤醒，要么结果在此被取到
+        auto const key = ec.prepare_wait();
+        r              = poll();
+        if (r) {
+            ec.cancel_wait();
+            return r;
+        }
+
+        on_park();
+        ec.wait(key);
+    }
+}
+
+/**
+ * @brief 同上，休眠时不做统计
+ */
+template <typename Poll>
+auto spin_then_park(event_count &ec, Poll &&poll) -> decltype(poll()) {
+    return spin_then_park(ec, std::forward<Poll>(poll), [] {});
+}
+
+}  // namespace flyzero
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "futex.h"
+
+namespace flyzero {
+
+/**
+ * @brief 对数分桶直方图
+ *
+ * 每个 2 的幂区间再等分为 2^sub_bits 个子桶，相对误差不超过 1/2^sub_bits。
+ * 只允许一个线程写入，其他线程可以随时读取或合并快照；多个写者应各自持有直方图再合并。
+ */
+class histogram {
+public:
+    static constexpr unsigned const sub_bits     = 3;                                ///< 子桶位数
+    static constexpr unsigned const sub_count    = 1u << sub_bits;                   ///< 子桶数
+    static constexpr size_t const   bucket_count = (64 - sub_bits + 1) * sub_count;  ///< 桶数
+
+    /**
+     * @brief 记录一个值
+     */
+    void record(uint64_t value) noexcept;
+
+    /**
+     * @brief 合并另一个直方图
+     */
+    void merge(const histogram &other) noexcept;
+
+    /**
+     * @brief 清空
+     */
+    void reset() noexcept;
+
+    /**
+     * @brief 记录的值的个数
+     */
+    uint64_t count() const noexcept;
+
+    /**
+     * @brief 最小值，没有记录时返回 0
+     */
+    uint64_t min() const noexcept;
+
+    /**
+     * @brief 最大值
+     */
+    uint64_t max() const noexcept;
+
+    /**
+     * @brief 平均值
+     */
+    double mean() const noexcept;
+
+    /**
+     * @brief 百分位数
+     * @param p 百分位，取值范围 [0, 100]
+     * @return 所在桶的上界，不超过最大值
+     */
+    uint64_t percentile(double p) const noexcept;
+
+private:
+    /**
+     * @brief 计算值所在的桶
+     */
+    static size_t bucket_index(uint64_t value) noexcept;
+
+    /**
+     * @brief 计算桶的上界
+     */
+    static uint64_t bucket_upper(size_t index) noexcept;
+
+    std::array<std::atomic<uint64_t>, bucket_count> buckets_{};          ///< 桶
+    std::atomic<uint64_t>                           count_{0};           ///< 个数
+    std::atomic<uint64_t>                           sum_{0};             ///< 总和
+    std::atomic<uint64_t>                           min_{~uint64_t{0}};  ///< 最小值
+    std::atomic<uint64_t>                           max_{0};             ///< 最大值
+};
+
+inline void histogram::record(uint64_t value) noexcept {
+    increase(buckets_[bucket_index(value)]);
+    increase(count_);
+    increase(sum_, value);
+    if (value < min_.load(std::memory_order_relaxed)) min_.store(value, std::memory_order_relaxed);
+    if (value > max_.load(std::memory_order_relaxed)) max_.store(value, std::memory_order_relaxed);
+}
+
+inline void histogram::merge(const histogram &other) noexcept {
+    for (size_t i = 0; i < bucket_count; ++i) {
+        increase(buckets_[i], other.buckets_[i].load(std::memory_order_relaxed));
+    }
+    increase(count_, other.count_.load(std::memory_order_relaxed));
+    increase(sum_, other.sum_.load(std::memory_order_relaxed));
+
+    auto const min = other.min_.load(std::memory_order_relaxed);
+    if (min < min_.load(std::memory_order_relaxed)) min_.store(min, std::memory_order_relaxed);
+
+    auto const max = other.max_.load(std::memory_order_relaxed);
+    if (max > max_.load(std::memory_order_relaxed)) max_.store(max, std::memory_order_relaxed);
+}
+
+inline void histogram::reset() noexcept {
+    for (auto &bucket : buckets_) bucket.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(~uint64_t{0}, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+inline uint64_t histogram::count() const noexcept { return count_.load(std::memory_order_relaxed); }
+
+inline uint64_t histogram::min() const noexcept {
+    return count() == 0 ? 0 : min_.load(std::memory_order_relaxed);
+}
+
+inline uint64_t histogram::max() const noexcept { return max_.load(std::memory_order_relaxed); }
+
+inline double histogram::mean() const noexcept {
+    auto const n = count();
+    return n == 0 ? 0.0 : static_cast<double>(sum_.load(std::memory_order_relaxed)) / n;
+}
+
+inline uint64_t histogram::percentile(double p) const noexcept {
+    auto const n = count();
+    if (n == 0) return 0;
+
+    // 第 rank 个值所在的桶
+    auto const rank = std::max<uint64_t>(1, static_cast<uint64_t>(p / 100.0 * n + 0.5));
+    uint64_t   seen = 0;
+    for (size_t i = 0; i < bucket_count; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return std::min(bucket_upper(i), max());
+    }
+
+    return max();
+}
+
+inline size_t histogram::bucket_index(uint64_t value) noexcept {
+    // 小于子桶数的值精确记录
+    if (value < sub_count) return value;
+
+    // 最高位决定区间，其后 sub_bits 位决定子桶
+    auto const msb   = 63u - __builtin_clzll(value);
+    auto const shift = msb - sub_bits;
+    auto const sub   = (value >> shift) & (sub_count - 1);
+    return (shift + 1) * sub_count + sub;
+}
+
+inline uint64_t histogram::bucket_upper(size_t index) noexcept {
+    if (index < sub_count) return index;
+
+    auto const shift = index / sub_count - 1;
+    auto const sub   = index % sub_count;
+    auto const lower = (uint64_t{sub_count} + sub) << shift;
+    return lower + ((uint64_t{1} << shift) - 1);
+}
+
+}  // namespace flyzero
@@ -0,0 +1,247 @@
+#include "hot_restart.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include "utility.h"
+
+namespace flyzero {
+
+namespace {
+
+/**
+ * @brief 设置阻塞模式与收发超时
+ */
+bool set_blocking(int sock, std::chrono::milliseconds timeout) {
+    auto const flags = ::fcntl(sock, F_GETFL);
+    if (flags < 0 || ::fcntl(sock, F_SETFL, flags & ~O_NONBLOCK) != 0) return false;
+
+    timeval tv{};
+    tv.tv_sec  = timeout.count() / 1000;
+    tv.tv_usec = timeout.count() % 1000 * 1000;
+    return ::setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv) == 0 &&
+           ::setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv) == 0;
+}
+
+/**
+ * @brief 阻塞发送全部数据
+ */
+bool send_all(int sock, const void *data, size_t size) {
+    auto p = static_cast<const char *>(data);
+    while (size > 0) {
+        auto const n = ::send(sock, p, size, MSG_NOSIGNAL);
+        if (n > 0) {
+            p += n;
+            size -= n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 阻塞接收全部数据
+ */
+bool recv_all(int sock, void *data, size_t size) {
+    auto p = static_cast<char *>(data);
+    while (size > 0) {
+        auto const n = ::recv(sock, p, size, 0);
+        if (n > 0) {
+            p += n;
+            size -= n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else {
+            if (n == 0) errno = ECONNRESET;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief 控制消息缓冲区，足以容纳 max_fds 个文件描述符
+ */
+union fd_control_buffer {
+    char    data[CMSG_SPACE(sizeof(int) * hot_restart::max_fds)];
+    cmsghdr align;
+};
+
+}  // namespace
+
+bool hot_restart_server::state_writer::write(const void *data, uint32_t size) {
+    assert(size > 0);
+    return send_all(sock_, &size, sizeof size) && send_all(sock_, data, size);
+}
+
+hot_restart_server::hot_restart_server(const char               *unix_path,
+                                       std::vector<int>          listeners,
+                                       std::chrono::milliseconds timeout)
+    : tcp_server{tcp_server::listen(unix_path)},
+      listeners_{std::move(listeners)},
+      timeout_{timeout} {
+    if (fd() < 0) {
+        throw utility::system_error(
+            errno, "listen(%s) failed: %s", unix_path, std::strerror(errno));
+    }
+
+    if (listeners_.size() > hot_restart::max_fds) {
+        throw std::runtime_error{"Too many listeners for hot restart"};
+    }
+}
+
+void hot_restart_server::on_accept(file_descriptor &&sock, const sockaddr_storage &, socklen_t) {
+    // 只接受同一用户的进程接管
+    ucred     cred{};
+    socklen_t len = sizeof cred;
+    if (::getsockopt(sock.get(), SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0 ||
+        cred.uid != ::geteuid()) {
+        return;
+    }
+
+    // 交接期间使用阻塞模式，超时后放弃本次交接
+    if (!set_blocking(sock.get(), timeout_)) return;
+
+    // 发送握手消息，通过 SCM_RIGHTS 携带监听套接字
+    hot_restart::handshake hs{
+        hot_restart::magic, hot_restart::version, static_cast<uint16_t>(listeners_.size())};
+    iovec  iov{&hs, sizeof hs};
+    msghdr msg{};
+    msg.msg_iov    = &iov;
+    msg.msg_iovlen = 1;
+
+    fd_control_buffer ctrl;
+    if (!listeners_.empty()) {
+        auto const fds_size = sizeof(int) * listeners_.size();
+        msg.msg_control     = ctrl.data;
+        msg.msg_controllen  = CMSG_SPACE(fds_size);
+        auto const cmsg     = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level    = SOL_SOCKET;
+        cmsg->cmsg_type     = SCM_RIGHTS;
+        cmsg->cmsg_len      = CMSG_LEN(fds_size);
+        std::memcpy(CMSG_DATA(cmsg), listeners_.data(), fds_size);
+    }
+
+    if (::sendmsg(sock.get(), &msg, MSG_NOSIGNAL) != sizeof hs) return;
+
+    // 导出状态，以长度为 0 的块结束
+    state_writer writer{sock.get()};
+    on_export_state(writer);
+    uint32_t const end = 0;
+    if (!send_all(sock.get(), &end, sizeof end)) return;
+
+    // 等待新进程确认接管
+    char ack;
+    if (!recv_all(sock.get(), &ack, sizeof ack) || ack != hot_restart::ack) return;
+
+    on_handoff_complete();
+}
+
+hot_restart_client::hot_restart_client(const char *unix_path, std::chrono::milliseconds timeout)
+    : sock_{::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)} {
+    if (!sock_) {
+        throw utility::system_error(
+            errno, "socket(AF_UNIX, SOCK_STREAM) failed: %s", std::strerror(errno));
+    }
+
+    if (!set_blocking(sock_.get(), timeout)) {
+        throw utility::system_error(
+            errno, "set_blocking(%d) failed: %s", sock_.get(), std::strerror(errno));
+    }
+
+    // 连接旧进程
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, unix_path, sizeof addr.sun_path - 1);
+    if (::connect(sock_.get(), reinterpret_cast<sockaddr *>(&addr), sizeof addr) != 0) {
+        throw utility::system_error(
+            errno, "connect(%d, %s) failed: %s", sock_.get(), unix_path, std::strerror(errno));
+    }
+
+    // 接收握手消息与监听套接字
+    hot_restart::handshake hs{};
+    iovec                  iov{&hs, sizeof hs};
+    fd_control_buffer      ctrl;
+    msghdr                 msg{};
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctrl.data;
+    msg.msg_controllen = sizeof ctrl.data;
+
+    ssize_t n;
+    do {
+        n = ::recvmsg(sock_.get(), &msg, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        throw utility::system_error(
+            errno, "recvmsg(%d) failed: %s", sock_.get(), std::strerror(errno));
+    }
+
+    // 先接管收到的文件描述符，确保出错时也能关闭
+    for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            auto const count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < count; ++i) {
+                int fd;
+                std::memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof fd);
+                listeners_.emplace_back(fd);
+            }
+        }
+    }
+
+    if (n != sizeof hs || hs.magic != hot_restart::magic || hs.version != hot_restart::version) {
+        throw std::runtime_error{"Invalid hot restart handshake"};
+    }
+
+    if ((msg.msg_flags & MSG_CTRUNC) || listeners_.size() != hs.fd_count) {
+        throw std::runtime_error{"Hot restart listeners truncated"};
+    }
+}
+
+bool hot_restart_client::read_state(std::vector<char> &chunk) {
+    if (eof_) return false;
+
+    uint32_t size;
+    if (!recv_all(sock_.get(), &size, sizeof size)) {
+        throw utility::system_error(
+            errno, "recv(%d) failed: %s", sock_.get(), std::strerror(errno));
+    }
+
+    if (size == 0) {
+        eof_ = true;
+        return false;
+    }
+
+    chunk.resize(size);
+    if (!recv_all(sock_.get(), chunk.data(), size)) {
+        throw utility::system_error(
+            errno, "recv(%d) failed: %s", sock_.get(), std::strerror(errno));
+    }
+
+    return true;
+}
+
+void hot_restart_client::complete() {
+    // 丢弃未读取的状态
+    std::vector<char> chunk;
+    while (read_state(chunk)) {
+    }
+
+    if (!send_all(sock_.get(), &hot_restart::ack, sizeof hot_restart::ack)) {
+        throw utility::system_error(
+            errno, "send(%d) failed: %s", sock_.get(), std::strerror(errno));
+    }
+
+    sock_.close();
+}
+
+}  // namespace flyzero
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "file_descriptor.h"
+#include "tcp_server.h"
+
+namespace flyzero {
+
+/**
+ * @brief 热重启交接协议，新旧进程通过 Unix 域套接字交接监听套接字与运行状态
+ *
+ * 1. 旧进程 -> 新进程：握手消息，通过 SCM_RIGHTS 携带全部监听套接字
+ * 2. 旧进程 -> 新进程：若干状态块，每块以 4 字节长度开头，长度为 0 的块表示结束
+ * 3. 新进程 -> 旧进程：1 字节确认，表示新进程已开始 accept
+ *
+ * 交接期间监听套接字在两个进程中同时打开，内核中的 accept 队列始终存在，
+ * 旧进程收到确认后再关闭监听套接字，不会丢弃 SYN。
+ *
+ * 旧进程在 on_accept 中以阻塞方式完成上述收发，单次收发最长等待 timeout（默认 10 秒），
+ * 期间所在的事件循环停顿，不会 accept 新连接，也不会处理同一循环上的其他事件；
+ * 新到的连接停留在 accept 队列中，由新进程接管后处理。需要在交接期间继续服务时，
+ * 应将 hot_restart_server 注册到单独线程的事件循环上。
+ */
+namespace hot_restart {
+
+/**
+ * @brief 握手消息
+ */
+struct handshake {
+    uint32_t magic;     ///< 魔数
+    uint16_t version;   ///< 协议版本
+    uint16_t fd_count;  ///< 监听套接字数量
+};
+
+constexpr uint32_t const magic   = 0x48525354;  ///< 'HRST'
+constexpr uint16_t const version = 1;           ///< 协议版本
+constexpr size_t const   max_fds = 64;          ///< 单次交接的最大监听套接字数量
+constexpr char const     ack     = 'A';         ///< 确认字节
+
+}  // namespace hot_restart
+
+/**
+ * @brief 旧进程一侧，监听交接路径，将监听套接字与状态交给连接上来的新进程
+ */
+class hot_restart_server : public tcp_server {
+public:
+    /**
+     * @brief 状态写入器，以阻塞方式将状态块写入新进程
+     */
+    class state_writer {
+    public:
+        explicit state_writer(int sock) noexcept;
+
+        /**
+         * @brief 写入一个状态块
+         * @param data 数据
+         * @param size 数据长度，不能为 0
+         * @return 成功时返回 true，新进程断开或超时时返回 false
+         */
+        bool write(const void *data, uint32_t size);
+
+    private:
+        int sock_;  ///< 交接连接
+    };
+
+    /**
+     * @brief 构造函数
+     *
+     * @param unix_path 交接路径，通过 tcp_server::listen(const char *) 监听
+     * @param listeners 需要交接的监听套接字，所有权仍归调用者
+     * @param timeout 单次收发的超时时间，也是交接期间事件循环单次停顿的上限
+     */
+    hot_restart_server(const char               *unix_path,
+                       std::vector<int>          listeners,
+                       std::chrono::milliseconds timeout = std::chrono::seconds{10});
+
+protected:
+    /**
+     * @brief 导出状态，在交接连接上依次写入状态块
+     */
+    virtual void on_export_state(state_writer &writer) = 0;
+
+    /**
+     * @brief 新进程已确认接管，旧进程应停止 accept 并退出
+     */
+    virtual void on_handoff_complete() = 0;
+
+private:
+    /**
+     * @brief 处理新进程的交接请求，阻塞直到收到确认、新进程断开或超时
+     */
+    void on_accept(file_descriptor        &&sock,
+                   const sockaddr_storage &addr,
+                   socklen_t               addrlen) override final;
+
+    std::vector<int>          listeners_;  ///< 需要交接的监听套接字
+    std::chrono::milliseconds timeout_;    ///< 单次收发的超时时间
+};
+
+/**
+ * @brief 新进程一侧，连接交接路径，接收监听套接字与状态
+ */
+class hot_restart_client {
+public:
+    /**
+     * @brief 连接旧进程并接收监听套接字，失败时抛出 std::system_error 或 std::runtime_error
+     *
+     * @param unix_path 交接路径
+     * @param timeout 单次收发的超时时间
+     */
+    explicit hot_restart_client(const char               *unix_path,
+                                std::chrono::milliseconds timeout = std::chrono::seconds{10});
+
+    /**
+     * @brief 接收到的监听套接字，顺序与旧进程构造 hot_restart_server 时一致
+     */
+    std::vector<file_descriptor> &listeners() noexcept;
+
+    /**
+     * @brief 读取下一个状态块
+     * @param chunk 状态块数据
+     * @return 读到状态块时返回 true，状态已全部读完时返回 false
+     */
+    bool read_state(std::vector<char> &chunk);
+
+    /**
+     * @brief 通知旧进程已开始 accept，旧进程随后关闭监听套接字
+     */
+    void complete();
+
+private:
+    file_descriptor              sock_;        ///< 交接连接
+    std::vector<file_descriptor> listeners_;   ///< 接收到的监听套接字
+    bool                         eof_{false};  ///< 状态是否已读完
+};
+
+inline hot_restart_server::state_writer::state_writer(int sock) noexcept : sock_{sock} {}
+
+inline std::vector<file_descriptor> &hot_restart_client::listeners() noexcept {
+    return listeners_;
+}
+
+}  // namespace flyzero
@@ -0,0 +1,89 @@
+#include "loop_bridge.h"
+
+#include <sys/eventfd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#include "utility.h"
+
+namespace flyzero {
+
+static int create_eventfd() {
+    auto const fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        throw utility::system_error(
+            errno, "eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC) failed: %s", std::strerror(errno));
+    }
+
+    return fd;
+}
+
+loop_bridge::loop_bridge(event_dispatch &dispatch)
+    : io_listener{create_eventfd()}, dispatch_{dispatch} {
+    dispatch_.register_io_listener(*this, event_dispatch::event::read);
+}
+
+loop_bridge::~loop_bridge() {
+    // 关闭 eventfd 时自动从 epoll 中移除
+    for (auto c = take_all(); c;) {
+        auto const next = c->next_;
+        c->discard();
+        c = next;
+    }
+}
+
+void loop_bridge::post(completion *c) noexcept {
+    auto head = head_.load(std::memory_order_relaxed);
+    do {
+        c->next_ = head;
+    } while (!head_.compare_exchange_weak(
+        head, c, std::memory_order_release, std::memory_order_relaxed));
+
+    // 链表原本非空时事件循环已被唤醒或即将取走整条链表，不必再写
+    if (head == nullptr) {
+        uint64_t const one = 1;
+        while (::write(fd(), &one, sizeof one) < 0 && errno == EINTR) {
+        }
+    }
+}
+
+size_t loop_bridge::get_wakeup_num() const noexcept { return wakeups_; }
+
+size_t loop_bridge::get_completed_num() const noexcept { return completed_; }
+
+void loop_bridge::on_read() {
+    // 先清零计数再取链表，之后的投递会看到空链表并重新写 eventfd
+    uint64_t value;
+    while (::read(fd(), &value, sizeof value) < 0 && errno == EINTR) {
+    }
+
+    auto c = take_all();
+    if (!c) return;
+
+    ++wakeups_;
+    while (c) {
+        auto const next = c->next_;
+        c->complete();
+        ++completed_;
+        c = next;
+    }
+}
+
+loop_bridge::completion *loop_bridge::take_all() noexcept {
+    auto c = head_.exchange(nullptr, std::memory_order_acquire);
+
+    // 链表中后投递的在前，反转为投递顺序
+    completion *prev = nullptr;
+    while (c) {
+        auto const next = c->next_;
+        c->next_        = prev;
+        prev            = c;
+        c               = next;
+    }
+
+    return prev;
+}
+
+}  // namespace flyzero
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "event_dispatch.h"
+#include "thread_pool.h"
+
+namespace flyzero {
+
+template <typename T>
+class future;
+
+/**
+ * @brief 把其他线程的完成通知送回 event_dispatch 所在线程
+ *
+ * 任意线程都可以投递完成通知，通知压入无锁链表；只有链表由空变为非空的那次投递写 eventfd，
+ * 事件循环被唤醒后一次取走整条链表按投递顺序处理，多个工作线程的完成只需一次唤醒。
+ * 构造时注册到 event_dispatch，之后只能在事件循环线程中使用，post 除外。
+ * 线程池须先于 loop_bridge 销毁。
+ */
+class loop_bridge : public event_dispatch::io_listener {
+public:
+    /**
+     * @brief 完成通知，由投递方分配
+     */
+    class completion {
+    public:
+        virtual ~completion() = default;
+
+        /**
+         * @brief 在事件循环线程中处理，处理后由实现自行释放
+         */
+        virtual void complete() noexcept = 0;
+
+        /**
+         * @brief loop_bridge 析构时仍未处理的通知以此释放
+         */
+        virtual void discard() noexcept = 0;
+
+    private:
+        friend class loop_bridge;
+
+        completion *next_{nullptr};  ///< 链表中的下一个通知
+    };
+
+    /**
+     * @brief 构造函数，创建 eventfd 并注册到事件循环
+     */
+    explicit loop_bridge(event_dispatch &dispatch);
+
+    /**
+     * @brief 禁止拷贝
+     */
+    loop_bridge(const loop_bridge &) = delete;
+
+    /**
+     * @brief 禁止拷贝
+     */
+    loop_bridge &operator=(const loop_bridge &) = delete;
+
+    /**
+     * @brief 析构函数，丢弃尚未处理的通知
+     */
+    ~loop_bridge() override;
+
+    /**
+     * @brief 投递完成通知，可在任意线程调用
+     */
+    void post(completion *c) noexcept;
+
+    /**
+     * @brief 投递可调用对象，在事件循环线程中执行，可在任意线程调用
+     */
+    template <typename F>
+        requires std::is_invocable_v<std::decay_t<F> &>
+    void post(F &&f);
+
+    /**
+     * @brief 把 f 提交到线程池执行，结果通过 future 在事件循环线程中取得
+     *
+     * @param pool 线程池
+     * @param f 可调用对象，在工作线程中执行，抛出的异常保存在 future 中
+     * @return 线程池队列已满或已停止时返回无效的 future
+     */
+    template <typename F>
+    auto submit(thread_pool &pool, F &&f) -> future<std::invoke_result_t<std::decay_t<F> &>>;
+
+    /**
+     * @brief 事件循环被唤醒处理通知的次数
+     */
+    size_t get_wakeup_num() const noexcept;
+
+    /**
+     * @brief 已处理的通知数
+     */
+    size_t get_completed_num() const noexcept;
+
+    void on_read() override;
+
+    void on_write() override {}
+
+private:
+    /**
+     * @brief 取走全部通知，恢复为投递顺序
+     */
+    completion *take_all() noexcept;
+
+    template <typename F>
+    class function_completion;
+
+    template <typename T, typename F>
+    class submit_state;
+
+    event_dispatch          &dispatch_;        ///< 所属事件循环
+    std::atomic<completion *> head_{nullptr};  ///< 待处理的通知，后投递的在前
+    size_t                   wakeups_{0};      ///< 唤醒次数
+    size_t                   completed_{0};    ///< 已处理的通知数
+};
+
+/**
+ * @brief future 的共享状态，引用计数只在事件循环线程中修改
+ */
+template <typename T>
+class future_state : public loop_bridge::completion {
+public:
+    using value_type = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+    using callback   = std::function<void(future<T> &)>;
+
+    /**
+     * @brief 保存结果，在工作线程中调用，之后投递到事件循环
+     */
+    template <typename F>
+    void set(F &f) noexcept {
+        try {
+            if constexpr (std::is_void_v<T>) {
+                f();
+                value_.emplace();
+            } else {
+                value_.emplace(f());
+            }
+        } catch (...) {
+            error_ = std::current_exception();
+        }
+    }
+
+    void complete() noexcept override {
+        ready_ = true;
+        if (callback_) {
+            future<T> f{this};
+            callback_(f);
+            callback_ = nullptr;
+        }
+        release();
+    }
+
+    void discard() noexcept override { release(); }
+
+    void acquire() noexcept { ++refs_; }
+
+    void release() noexcept {
+        if (--refs_ == 0) delete this;
+    }
+
+protected:
+    template <typename U>
+    friend class future;
+
+    bool                      ready_{false};  ///< 结果是否已送达事件循环
+    int                       refs_{2};       ///< 由 future 与执行流程各持有一份
+    std::optional<value_type> value_;         ///< 结果
+    std::exception_ptr        error_;         ///< 异常
+    callback                  callback_;      ///< 结果送达后调用的回调
+};
+
+/**
+ * @brief loop_bridge::submit 返回的 future，只能在事件循环线程中使用
+ *
+ * 结果送达事件循环前 ready() 为 false；then 注册的回调在结果送达时于事件循环线程中执行，
+ * 已送达时立即执行。回调中可用 get() 取结果。
+ */
+template <typename T>
+class future {
+public:
+    using callback = typename future_state<T>::callback;
+
+    /**
+     * @brief 构造无效的 future
+     */
+    future() noexcept = default;
+
+    future(future &&other) noexcept : state_{std::exchange(other.state_, nullptr)} {}
+
+    future &operator=(future &&other) noexcept {
+        if (this != &other) {
+            reset();
+            state_ = std::exchange(other.state_, nullptr);
+        }
+        return *this;
+    }
+
+    future(const future &)            = delete;
+    future &operator=(const future &) = delete;
+
+    ~future() { reset(); }
+
+    /**
+     * @brief 是否有效
+     */
+    explicit operator bool() const noexcept { return state_ != nullptr; }
+
+    /**
+     * @brief 结果是否已送达事件循环
+     */
+    bool ready() const noexcept { return state_->ready_; }
+
+    /**
+     * @brief 取结果，结果须已送达；任务抛出异常时重新抛出，任务未执行即被线程池丢弃时抛出
+     * std::future_error(std::future_errc::broken_promise)
+     */
+    std::add_lvalue_reference_t<T> get() {
+        if (state_->error_) std::rethrow_exception(state_->error_);
+        if constexpr (!std::is_void_v<T>) return *state_->value_;
+    }
+
+    /**
+     * @brief 注册结果送达后的回调，替换之前注册的回调，回调不能抛出异常
+     */
+    void then(callback cb) {
+        if (state_->ready_) {
+            cb(*this);
+        } else {
+            state_->callback_ = std::move(cb);
+        }
+    }
+
+private:
+    friend class future_state<T>;
+    friend class loop_bridge;
+
+    explicit future(future_state<T> *state) noexcept : state_{state} { state_->acquire(); }
+
+    struct adopt_tag {};
+
+    future(future_state<T> *state, adopt_tag) noexcept : state_{state} {}
+
+    void reset() noexcept {
+        if (state_) std::exchange(state_, nullptr)->release();
+    }
+
+    future_state<T> *state_{nullptr};  ///< 共享状态
+};
+
+template <typename F>
+class loop_bridge::function_completion final : public completion {
+public:
+    explicit function_completion(F &&f) : f_{std::move(f)} {}
+
+    void complete() noexcept override {
+        f_();
+        delete this;
+    }
+
+    void discard() noexcept override { delete this; }
+
+private:
+    F f_;
+};
+
+/**
+ * @brief 提交到线程池的任务与 future 的共享状态合为一次分配
+ */
+template <typename T, typename F>
+class loop_bridge::submit_state final : public future_state<T>, public thread_pool::task {
+public:
+    submit_state(loop_bridge &bridge, F &&f) : bridge_{bridge}, f_{std::move(f)} {}
+
+    bool run(thread_pool &) override {
+        this->set(f_);
+        ran_ = true;
+        return true;
+    }
+
+    /**
+     * @brief 线程池的删除器，执行后或线程池析构时丢弃任务时调用，把结果投递回事件循环
+     */
+    static void finish(thread_pool::task *th) {
+        auto const s = static_cast<submit_state *>(th);
+        if (!s->ran_) {
+            s->error_ = std::make_exception_ptr(std::future_error{std::future_errc::broken_promise});
+        }
+        s->bridge_.post(s);
+    }
+
+private:
+    loop_bridge &bridge_;      ///< 结果送回的事件循环
+    F            f_;           ///< 任务
+    bool         ran_{false};  ///< 是否已执行
+};
+
+template <typename F>
+    requires std::is_invocable_v<std::decay_t<F> &>
+void loop_bridge::post(F &&f) {
+    post(new function_completion<std::decay_t<F>>{std::decay_t<F>(std::forward<F>(f))});
+}
+
+template <typename F>
+auto loop_bridge::submit(thread_pool &pool, F &&f)
+    -> future<std::invoke_result_t<std::decay_t<F> &>> {
+    using type   = std::decay_t<F>;
+    using result = std::invoke_result_t<type &>;
+    using state  = submit_state<result, type>;
+
+    auto const s = new state{*this, type(std::forward<F>(f))};
+    if (!pool.push(s, state::finish)) {
+        delete s;
+        return {};
+    }
+
+    return future<result>{s, typename future<result>::adopt_tag{}};
+}
+
+}  // namespace flyzero
@@ -156,11 +156,15 @@ private:
 public:
     /**
      * @brief 构造函数
+     * @param timeout 超时时间
+     * @param hash 哈希函数
+     * @param equal 比较函数
+     * @param alloc 分配器
      */
     explicit LruCache(Duration timeout,
-                      Hash const &hash = Hash(),
-                      Equal const &equal = Equal(),
-                      Allocator const &alloc = Allocator());
+                      H const &hash = H(),
+                      E const &equal = E(),
+                      A const &alloc = A());
 
     /**
      * @brief 析构函数
@@ -218,6 +222,21 @@ public:
      */
     bool empty() const { return list_.empty(); }
 
+    /**
+     * @brief 获取迭代器所指元素的键
+     */
+    static K const &key(ConstIterator it) { return static_cast<Node const &>(*it).key_; }
+
+    /**
+     * @brief 获取迭代器所指元素的值
+     */
+    static V &value(Iterator it) { return static_cast<Node &>(*it).value_; }
+
+    /**
+     * @brief 获取迭代器所指元素的值
+     */
+    static V const &value(ConstIterator it) { return static_cast<Node const &>(*it).value_; }
+
     /**
      * @brief 异构查找元素
      * @tparam U 异构键
@@ -338,10 +357,11 @@ bool LruCache<K, V, H, E, A>::Equal::operator()(const Node &lhs, const U &rhs) c
 
 template <typename K, typename V, typename H, typename E, typename A>
 LruCache<K, V, H, E, A>::LruCache(Duration timeout,
-                                  Hash const &hash,
-                                  Equal const &equal,
-                                  Allocator const &alloc)
-    : config_tuple_{hash, equal, alloc, timeout}, hash_{alloc_buckets(16)} {}
+                                  H const &hash,
+                                  E const &equal,
+                                  A const &alloc)
+    : config_tuple_{Hash{hash}, Equal{equal}, Allocator(alloc), timeout},
+      hash_{alloc_buckets(16), get_hash(), get_equal()} {}
 
 template <typename K, typename V, typename H, typename E, typename A>
 LruCache<K, V, H, E, A>::~LruCache() {
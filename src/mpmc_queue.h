@@ -0,0 +1,310 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "futex.h"
+#include "utility.h"
+
+namespace flyzero {
+
+/**
+ * @brief 有界多生产者多消费者无锁队列
+ *
+ * 每个槽位带一个序号，元素直接存放在槽位中，不为单个元素分配内存。
+ * 序号等于位置时槽位可写，等于位置加 1 时可读；生产者与消费者各自以一次 CAS 抢占位置，
+ * 之后只访问抢到的槽位，竞争只发生在 CAS 上。
+ * 阻塞操作先自旋，再休眠在 event_count 上；非阻塞操作只在有线程休眠时才进入内核唤醒。
+ */
+template <typename Type>
+class mpmc_queue {
+public:
+    using value_type       = Type;
+    using pointer          = value_type *;
+    using allocator_type   = std::function<void *(size_t)>;
+    using deallocator_type = std::function<void(void *)>;
+
+    static constexpr size_t const cache_line = 64;   ///< 缓存行大小
+    static constexpr int const    spin_count = 128;  ///< 阻塞操作休眠前的自旋次数
+
+    /**
+     * @brief 构造函数
+     *
+     * @param capacity 容量，向上取整为 2 的幂，至少为 2
+     * @param allocator 分配器
+     * @param deallocator 释放器
+     */
+    explicit mpmc_queue(size_t                  capacity,
+                        const allocator_type   &allocator   = malloc,
+                        const deallocator_type &deallocator = free);
+
+    /**
+     * @brief 禁止拷贝
+     */
+    mpmc_queue(const mpmc_queue &) = delete;
+
+    /**
+     * @brief 禁止拷贝
+     */
+    mpmc_queue &operator=(const mpmc_queue &) = delete;
+
+    /**
+     * @brief 析构函数，销毁剩余元素，调用时已没有线程访问队列
+     */
+    ~mpmc_queue();
+
+    /**
+     * @brief 容量
+     */
+    size_t capacity() const noexcept;
+
+    /**
+     * @brief 元素个数，并发读写时为近似值
+     */
+    size_t size() const noexcept;
+
+    /**
+     * @brief 是否为空，并发读写时为近似值
+     */
+    bool empty() const noexcept;
+
+    /**
+     * @brief 原位构造一个元素，构造不能抛出异常
+     * @return 队列已满时返回 false
+     */
+    template <typename... Args>
+    bool try_push(Args &&...args);
+
+    /**
+     * @brief 弹出一个元素
+     * @return 队列为空时返回 false
+     */
+    bool try_pop(value_type &value);
+
+    /**
+     * @brief 写入一个元素，队列已满时先自旋再休眠，直到写入成功
+     */
+    template <typename... Args>
+    void push(Args &&...args);
+
+    /**
+     * @brief 弹出一个元素，队列为空时先自旋再休眠，直到弹出成功
+     */
+    void pop(value_type &value);
+
+    /**
+     * @brief 写入一个元素，队列已满时至多等待 timeout
+     * @return 超时时返回 false
+     */
+    template <typename Rep, typename Period, typename... Args>
+    bool push_for(const std::chrono::duration<Rep, Period> &timeout, Args &&...args);
+
+    /**
+     * @brief 弹出一个元素，队列为空时至多等待 timeout
+     * @return 超时时返回 false
+     */
+    template <typename Rep, typename Period>
+    bool pop_for(value_type &value, const std::chrono::duration<Rep, Period> &timeout);
+
+private:
+    /**
+     * @brief 槽位
+     */
+    struct slot {
+        std::atomic<size_t> seq;                              ///< 序号
+        alignas(Type) unsigned char storage[sizeof(Type)];  ///< 元素存储
+
+        pointer get() noexcept { return std::launder(reinterpret_cast<pointer>(storage)); }
+    };
+
+    /**
+     * @brief 反复尝试 attempt，先自旋再休眠在 ec 上，直到成功或超时
+     *
+     * @param timeout 超时时间，为负时不超时
+     * @return 超时时返回 false
+     */
+    template <typename Attempt>
+    static bool wait_for(event_count &ec, std::chrono::nanoseconds timeout, Attempt &&attempt);
+
+    alignas(cache_line) std::atomic<size_t> head_{0};  ///< 下一个写入位置
+    alignas(cache_line) std::atomic<size_t> tail_{0};  ///< 下一个读出位置
+
+    alignas(cache_line) event_count not_empty_;  ///< 消费者等待队列非空
+    alignas(cache_line) event_count not_full_;   ///< 生产者等待队列不满
+
+    alignas(cache_line) size_t capacity_;  ///< 容量
+    size_t           mask_;                ///< 索引掩码
+    slot            *slots_;               ///< 槽位数组
+    deallocator_type deallocator_;         ///< 释放器
+};
+
+template <typename Type>
+mpmc_queue<Type>::mpmc_queue(size_t                  capacity,
+                             const allocator_type   &allocator,
+                             const deallocator_type &deallocator)
+    : capacity_(utility::next_pow2(capacity < 2 ? 2 : capacity)),
+      mask_(capacity_ - 1),
+      slots_(static_cast<slot *>(allocator(capacity_ * sizeof(slot)))),
+      deallocator_(deallocator) {
+    if (!slots_) throw std::bad_alloc{};
+    assert(reinterpret_cast<uintptr_t>(slots_) % alignof(slot) == 0);
+
+    for (size_t i = 0; i < capacity_; ++i) new (&slots_[i].seq) std::atomic<size_t>(i);
+}
+
+template <typename Type>
+mpmc_queue<Type>::~mpmc_queue() {
+    auto const head = head_.load(std::memory_order_acquire);
+    for (auto pos = tail_.load(std::memory_order_relaxed); pos != head; ++pos) {
+        slots_[pos & mask_].get()->~Type();
+    }
+    deallocator_(slots_);
+}
+
+template <typename Type>
+size_t mpmc_queue<Type>::capacity() const noexcept {
+    return capacity_;
+}
+
+template <typename Type>
+size_t mpmc_queue<Type>::size() const noexcept {
+    // 写入位置可能已被抢占但尚未写入，结果限制在 [0, capacity] 内
+    auto const tail = tail_.load(std::memory_order_acquire);
+    auto const head = head_.load(std::memory_order_acquire);
+    auto const n    = static_cast<ptrdiff_t>(head - tail);
+    return n < 0 ? 0 : std::min(static_cast<size_t>(n), capacity_);
+}
+
+template <typename Type>
+bool mpmc_queue<Type>::empty() const noexcept {
+    return size() == 0;
+}
+
+template <typename Type>
+template <typename... Args>
+bool mpmc_queue<Type>::try_push(Args &&...args) {
+    static_assert(std::is_nothrow_constructible_v<Type, Args &&...>,
+                  "a claimed slot cannot be given back");
+
+    auto  pos = head_.load(std::memory_order_relaxed);
+    slot *s;
+    for (;;) {
+        s               = &slots_[pos & mask_];
+        auto const seq  = s->seq.load(std::memory_order_acquire);
+        auto const diff = static_cast<ptrdiff_t>(seq - pos);
+        if (diff == 0) {
+            // 槽位可写，抢占位置，失败时 pos 更新为最新值
+            if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            // 槽位仍保存着上一圈的元素，队列已满
+            return false;
+        } else {
+            pos = head_.load(std::memory_order_relaxed);
+        }
+    }
+
+    new (s->storage) Type(std::forward<Args>(args)...);
+    s->seq.store(pos + 1, std::memory_order_release);
+    not_empty_.notify_one();
+    return true;
+}
+
+template <typename Type>
+bool mpmc_queue<Type>::try_pop(value_type &value) {
+    static_assert(std::is_nothrow_move_assignable_v<Type>, "a claimed slot cannot be given back");
+
+    auto  pos = tail_.load(std::memory_order_relaxed);
+    slot *s;
+    for (;;) {
+        s               = &slots_[pos & mask_];
+        auto const seq  = s->seq.load(std::memory_order_acquire);
+        auto const diff = static_cast<ptrdiff_t>(seq - (pos + 1));
+        if (diff == 0) {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            // 槽位尚未写入，队列为空
+            return false;
+        } else {
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+
+    auto const p = s->get();
+    value        = std::move(*p);
+    p->~Type();
+
+    // 槽位留给下一圈的生产者
+    s->seq.store(pos + capacity_, std::memory_order_release);
+    not_full_.notify_one();
+    return true;
+}
+
+template <typename Type>
+template <typename... Args>
+void mpmc_queue<Type>::push(Args &&...args) {
+    wait_for(not_full_, std::chrono::nanoseconds{-1}, [&] {
+        return try_push(std::forward<Args>(args)...);
+    });
+}
+
+template <typename Type>
+void mpmc_queue<Type>::pop(value_type &value) {
+    wait_for(not_empty_, std::chrono::nanoseconds{-1}, [&] { return try_pop(value); });
+}
+
+template <typename Type>
+template <typename Rep, typename Period, typename... Args>
+bool mpmc_queue<Type>::push_for(const std::chrono::duration<Rep, Period> &timeout, Args &&...args) {
+    return wait_for(not_full_,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(timeout),
+                    [&] { return try_push(std::forward<Args>(args)...); });
+}
+
+template <typename Type>
+template <typename Rep, typename Period>
+bool mpmc_queue<Type>::pop_for(value_type &value, const std::chrono::duration<Rep, Period> &timeout) {
+    return wait_for(not_empty_,
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(timeout),
+                    [&] { return try_pop(value); });
+}
+
+template <typename Type>
+template <typename Attempt>
+bool mpmc_queue<Type>::wait_for(event_count &ec, std::chrono::nanoseconds timeout, Attempt &&attempt) {
+    for (int i = 0; i < spin_count; ++i) {
+        if (attempt()) return true;
+        cpu_relax();
+    }
+
+    auto const forever  = timeout.count() < 0;
+    auto const deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        auto const key = ec.prepare_wait();
+        if (attempt()) {
+            ec.cancel_wait();
+            return true;
+        }
+
+        auto remaining = std::chrono::nanoseconds{-1};
+        if (!forever) {
+            remaining = deadline - std::chrono::steady_clock::now();
+            if (remaining.count() <= 0) {
+                ec.cancel_wait();
+                return false;
+            }
+        }
+
+        ec.wait(key, remaining);
+    }
+}
+
+}  // namespace flyzero
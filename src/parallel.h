@@ -0,0 +1,345 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "futex.h"
+#include "thread_pool.h"
+#include "utility.h"
+
+namespace flyzero {
+
+/**
+ * @brief 并行区间的共享状态
+ *
+ * 调用线程与至多 thread_count 个辅助任务一起从区间中领取块，块大小随剩余量递减（guided 调度）：
+ * 开始时块较大以减少领取次数，接近结束时块较小以平衡各线程的负载。
+ * 调用线程只等待已领取的块执行完，不等待尚未开始的辅助任务，
+ * 这些任务开始时发现区间已领完便直接结束，因此共享状态以引用计数管理。
+ */
+class parallel_range {
+public:
+    using body_type = void (*)(void *context, size_t lo, size_t hi);
+
+    /**
+     * @brief 在 [begin, end) 上执行 body，调用线程参与执行，body 抛出的第一个异常在此重新抛出
+     *
+     * @param pool 线程池
+     * @param begin 起点
+     * @param end 终点
+     * @param grain 最小块大小
+     * @param body 处理块 [lo, hi)
+     * @param context 传给 body 的参数，只在领取到块后访问
+     */
+    static void run(thread_pool &pool, size_t begin, size_t end, size_t grain, body_type body,
+                    void *context);
+
+private:
+    parallel_range(size_t begin, size_t end, size_t grain, size_t participants, body_type body,
+                   void *context)
+        : next_{begin},
+          end_{end},
+          grain_{std::max<size_t>(grain, 1)},
+          participants_{participants},
+          pending_{end - begin},
+          body_{body},
+          context_{context} {}
+
+    /**
+     * @brief 辅助任务
+     */
+    class helper : public thread_pool::task {
+    public:
+        explicit helper(std::shared_ptr<parallel_range> range) : range_{std::move(range)} {}
+
+        bool run(thread_pool &) override {
+            range_->work();
+            return true;
+        }
+
+        static void destroy(thread_pool::task *th) { delete th; }
+
+    private:
+        std::shared_ptr<parallel_range> range_;
+    };
+
+    /**
+     * @brief 领取一块，区间已领完时返回 false
+     */
+    bool claim(size_t &lo, size_t &hi) noexcept {
+        auto next = next_.load(std::memory_order_relaxed);
+        for (;;) {
+            if (next >= end_) return false;
+
+            auto const rest  = end_ - next;
+            auto const chunk = std::min(rest, std::max(grain_, rest / (2 * participants_)));
+            if (next_.compare_exchange_weak(
+                    next, next + chunk, std::memory_order_relaxed, std::memory_order_relaxed)) {
+                lo = next;
+                hi = next + chunk;
+                return true;
+            }
+        }
+    }
+
+    /**
+     * @brief 块执行完毕，全部执行完时唤醒调用线程
+     */
+    void finish(size_t n) noexcept {
+        if (pending_.fetch_sub(n, std::memory_order_acq_rel) == n) done_.notify_all();
+    }
+
+    /**
+     * @brief 领取并执行块直到区间领完
+     */
+    void work() noexcept {
+        size_t lo, hi;
+        while (claim(lo, hi)) {
+            try {
+                body_(context_, lo, hi);
+            } catch (...) {
+                // 保存第一个异常，领走剩余的块使其他线程尽快结束
+                {
+                    std::lock_guard<std::mutex> lock{mutex_};
+                    if (!error_) error_ = std::current_exception();
+                }
+
+                auto const rest = next_.exchange(end_, std::memory_order_relaxed);
+                if (rest < end_) finish(end_ - rest);
+            }
+            finish(hi - lo);
+        }
+    }
+
+    /**
+     * @brief 等待已领取的块全部执行完
+     */
+    void wait() noexcept {
+        while (pending_.load(std::memory_order_acquire) != 0) {
+            auto const key = done_.prepare_wait();
+            if (pending_.load(std::memory_order_acquire) == 0) {
+                done_.cancel_wait();
+                break;
+            }
+            done_.wait(key);
+        }
+    }
+
+    std::atomic<size_t> next_;          ///< 下一个未领取的位置
+    size_t const        end_;           ///< 终点
+    size_t const        grain_;         ///< 最小块大小
+    size_t const        participants_;  ///< 参与的线程数
+    std::atomic<size_t> pending_;       ///< 尚未执行完的元素数
+    event_count         done_;          ///< 调用线程在此等待
+    body_type const     body_;          ///< 处理块的函数
+    void *const         context_;       ///< 传给 body 的参数
+    std::mutex          mutex_;         ///< 保护 error_
+    std::exception_ptr  error_;         ///< 第一个异常
+};
+
+inline void parallel_range::run(thread_pool &pool, size_t begin, size_t end, size_t grain,
+                                body_type body, void *context) {
+    if (begin >= end) return;
+
+    // 区间不足两块时不值得唤醒工作线程
+    auto const n       = end - begin;
+    auto const helpers = std::min(pool.get_thread_count(), (n - 1) / std::max<size_t>(grain, 1));
+    if (helpers == 0) {
+        body(context, begin, end);
+        return;
+    }
+
+    std::shared_ptr<parallel_range> range{
+        new parallel_range{begin, end, grain, helpers + 1, body, context}};
+    for (size_t i = 0; i < helpers; ++i) {
+        auto const th = new helper{range};
+        if (!pool.push(th, helper::destroy)) {
+            // 队列已满时由已提交的辅助任务与调用线程完成
+            delete th;
+            break;
+        }
+    }
+
+    range->work();
+    range->wait();
+    if (range->error_) std::rethrow_exception(range->error_);
+}
+
+/**
+ * @brief 并行执行 f(i)，i 取遍 [begin, end)，或以 f(lo, hi) 的形式按块执行
+ *
+ * 调用线程参与执行，返回时全部调用已结束；f 抛出异常时剩余部分不再执行，第一个异常在此重新抛出。
+ *
+ * @param pool 线程池
+ * @param begin 起点
+ * @param end 终点
+ * @param f 可调用对象
+ * @param grain 最小块大小，f 很轻时应调大以摊薄领取的开销
+ */
+template <typename F>
+void parallel_for(thread_pool &pool, size_t begin, size_t end, F &&f, size_t grain = 1) {
+    using type = std::remove_reference_t<F>;
+
+    parallel_range::run(
+        pool, begin, end, grain,
+        [](void *context, size_t lo, size_t hi) {
+            auto &fn = *static_cast<type *>(context);
+            if constexpr (std::is_invocable_v<type &, size_t, size_t>) {
+                fn(lo, hi);
+            } else {
+                for (auto i = lo; i < hi; ++i) fn(i);
+            }
+        },
+        const_cast<void *>(static_cast<const void *>(std::addressof(f))));
+}
+
+/**
+ * @brief 并行归约
+ *
+ * 每块以 f(lo, hi, identity) 求出部分结果，再以 reduce 合并；块的划分与合并顺序不固定，
+ * reduce 须满足结合律与交换律，identity 须为 reduce 的单位元。
+ *
+ * @param pool 线程池
+ * @param begin 起点
+ * @param end 终点
+ * @param identity 单位元
+ * @param f 计算块 [lo, hi) 的部分结果
+ * @param reduce 合并两个部分结果
+ * @param grain 最小块大小
+ * @return 归约结果
+ */
+template <typename T, typename F, typename R>
+T parallel_reduce(thread_pool &pool, size_t begin, size_t end, T identity, F &&f, R &&reduce,
+                  size_t grain = 1) {
+    T          result = identity;
+    std::mutex mutex;
+
+    parallel_for(
+        pool, begin, end,
+        [&](size_t lo, size_t hi) {
+            T partial = f(lo, hi, identity);
+
+            std::lock_guard<std::mutex> lock{mutex};
+            result = reduce(std::move(result), std::move(partial));
+        },
+        grain);
+
+    return result;
+}
+
+/**
+ * @brief 并行归并排序，稳定
+ *
+ * 先把区间分成若干块并行地 std::stable_sort，再逐轮两两归并；
+ * 每轮按输出位置把归并切成等长的片，以二分查找定位各片在两个输入中的起点，片之间互不依赖，
+ * 因此最后一轮只剩一对时仍能全部线程参与。需要与区间等长的临时缓冲区。
+ *
+ * @param pool 线程池
+ * @param first 起点，随机访问迭代器
+ * @param last 终点
+ * @param comp 比较函数
+ * @param grain 小于此长度的区间直接 std::stable_sort，也是每片的最小长度
+ */
+template <typename RandomIt, typename Compare = std::less<>>
+void parallel_sort(thread_pool &pool, RandomIt first, RandomIt last, Compare comp = Compare{},
+                   size_t grain = 4096) {
+    using value_type = typename std::iterator_traits<RandomIt>::value_type;
+
+    auto const n = static_cast<size_t>(last - first);
+    grain        = std::max<size_t>(grain, 1);
+    if (n <= grain) {
+        std::stable_sort(first, last, comp);
+        return;
+    }
+
+    // 块数约为参与线程数的 4 倍，块长取 2 的幂；每轮归并也按块长切片，片不会跨越一对输入，
+    // 每轮都有约 4 倍于参与线程数的片
+    auto const participants = pool.get_thread_count() + 1;
+    auto const block        = static_cast<size_t>(
+        utility::next_pow2(std::max<size_t>(grain, (n + 4 * participants - 1) / (4 * participants))));
+
+    auto const              blocks = (n + block - 1) / block;
+    std::vector<value_type> buffer(std::make_move_iterator(first), std::make_move_iterator(last));
+    auto const              buf = buffer.begin();
+
+    parallel_for(pool, 0, blocks, [&](size_t b) {
+        std::stable_sort(buf + b * block, buf + std::min(n, (b + 1) * block), comp);
+    });
+
+    // 在 a 与 b 的稳定归并中，前 k 个输出里来自 a 的个数
+    auto const co_rank = [&comp](auto a, size_t m, auto b, size_t l, size_t k) {
+        size_t lo = k > l ? k - l : 0;
+        size_t hi = std::min(k, m);
+        while (lo < hi) {
+            auto const i = lo + (hi - lo) / 2;
+            auto const j = k - i;
+            if (j > 0 && !comp(b[j - 1], a[i])) {
+                lo = i + 1;
+            } else {
+                hi = i;
+            }
+        }
+        return lo;
+    };
+
+    // 在 src 与 dst 之间来回归并，每轮有序段长度翻倍。
+    // 归并会移走 src 中的元素，因此先求出全部片的起点，再开始移动
+    std::vector<size_t> split(blocks);
+    auto merge_pass = [&](auto src, auto dst, size_t width) {
+        // 第 p 片所在的一对有序段：[a, mid) 与 [mid, b)
+        auto const pair = [&](size_t p) {
+            auto const a = p * block / (2 * width) * (2 * width);
+            return std::make_tuple(a, std::min(n, a + width), std::min(n, a + 2 * width));
+        };
+
+        parallel_for(pool, 0, blocks, [&](size_t p) {
+            auto const [a, mid, b] = pair(p);
+            split[p] = co_rank(src + a, mid - a, src + mid, b - mid, p * block - a);
+        });
+
+        parallel_for(pool, 0, blocks, [&](size_t p) {
+            auto const [a, mid, b] = pair(p);
+            auto const out_lo      = p * block;
+            auto const out_hi      = std::min(n, out_lo + block);
+            auto const i_lo        = split[p];
+            auto const i_hi        = out_hi == b ? mid - a : split[p + 1];
+            auto const j_lo        = out_lo - a - i_lo;
+            auto const j_hi        = out_hi - a - i_hi;
+            std::merge(std::make_move_iterator(src + a + i_lo),
+                       std::make_move_iterator(src + a + i_hi),
+                       std::make_move_iterator(src + mid + j_lo),
+                       std::make_move_iterator(src + mid + j_hi),
+                       dst + out_lo,
+                       comp);
+        });
+    };
+
+    // 结果在 buffer 中时最后再并行移回
+    bool in_buffer = true;
+    for (size_t width = block; width < n; width *= 2) {
+        if (in_buffer) {
+            merge_pass(buf, first, width);
+        } else {
+            merge_pass(first, buf, width);
+        }
+        in_buffer = !in_buffer;
+    }
+
+    if (in_buffer) {
+        parallel_for(
+            pool, 0, n, [&](size_t lo, size_t hi) { std::move(buf + lo, buf + hi, first + lo); },
+            grain);
+    }
+}
+
+}  // namespace flyzero
@@ -0,0 +1,113 @@
+#include "priority_task_queue_thread.h"
+
+#include <limits>
+#include <stdexcept>
+
+namespace flyzero {
+
+priority_task_queue_thread::priority_task_queue_thread()
+    : priority_task_queue_thread{options{}} {}
+
+priority_task_queue_thread::priority_task_queue_thread(const options      &opts,
+                                                       const alloc_type   &alloc,
+                                                       const dealloc_type &dealloc)
+    : alloc_{alloc}, dealloc_{dealloc}, urgency_{opts.urgency.count()} {
+    if (opts.weights.empty()) throw std::invalid_argument{"No priority level"};
+
+    for (auto const weight : opts.weights) {
+        if (weight == 0) throw std::invalid_argument{"Priority weight must be positive"};
+        levels_.emplace_back(std::make_unique<level>(opts.queue_capacity, weight));
+    }
+
+    // 队列就绪后再启动线程
+    this->std::thread::operator=(std::thread{thread_routine, std::ref(*this)});
+}
+
+size_t priority_task_queue_thread::get_priority_count() const noexcept { return levels_.size(); }
+
+size_t priority_task_queue_thread::get_processed_task_num(size_t priority) const noexcept {
+    return levels_[priority]->processed.load(std::memory_order_relaxed);
+}
+
+size_t priority_task_queue_thread::get_shed_task_num(size_t priority) const noexcept {
+    return levels_[priority]->shed.load(std::memory_order_relaxed);
+}
+
+size_t priority_task_queue_thread::get_promoted_task_num(size_t priority) const noexcept {
+    return levels_[priority]->promoted.load(std::memory_order_relaxed);
+}
+
+const histogram &priority_task_queue_thread::get_queue_time(size_t priority) const noexcept {
+    return levels_[priority]->queue_time;
+}
+
+size_t priority_task_queue_thread::get_current_task_num() const noexcept {
+    size_t n = 0;
+    for (auto &lv : levels_) n += lv->queue.size();
+    return n;
+}
+
+void priority_task_queue_thread::thread_routine(priority_task_queue_thread &obj) {
+    for (;;) {
+        // 与 task_queue_thread 相同：先自旋，再让出 CPU，最后休眠
+        auto const lv = spin_then_park(obj.ready_, [&] { return obj.select(); });
+
+        // 在队列槽位中直接执行，执行完再释放槽位
+        auto      &e   = *lv->queue.front();
+        auto const now = clock::now().time_since_epoch().count();
+        lv->queue_time.record(static_cast<uint64_t>(now - e.enqueued));
+
+        auto const fin = e.fn();
+        lv->queue.pop();
+        increase(lv->processed);
+
+        if (!fin) break;
+    }
+}
+
+auto priority_task_queue_thread::select() -> level * {
+    auto const now = clock::now().time_since_epoch().count();
+
+    level *urgent   = nullptr;  // 截止时间最早且临近的优先级
+    level *weighted = nullptr;  // 加权轮转选中的优先级
+    level *first    = nullptr;  // 最高的非空优先级
+    auto   earliest = std::numeric_limits<clock::rep>::max();
+
+    for (auto &p : levels_) {
+        auto &lv = *p;
+
+        // 丢弃已过截止时间的任务
+        entry *e;
+        while ((e = lv.queue.front()) && e->deadline <= now) {
+            lv.queue.pop();
+            increase(lv.shed);
+        }
+        if (!e) continue;
+
+        if (!first) first = &lv;
+        if (!weighted && lv.credit > 0) weighted = &lv;
+        if (e->deadline - now <= urgency_ && e->deadline < earliest) {
+            urgent   = &lv;
+            earliest = e->deadline;
+        }
+    }
+
+    if (!first) return nullptr;
+
+    if (urgent) {
+        if (urgent != weighted) increase(urgent->promoted);
+        if (urgent->credit > 0) --urgent->credit;
+        return urgent;
+    }
+
+    if (!weighted) {
+        // 所有非空优先级的配额都已用完，开始新一轮
+        for (auto &lv : levels_) lv->credit = lv->weight;
+        weighted = first;
+    }
+
+    --weighted->credit;
+    return weighted;
+}
+
+}  // namespace flyzero
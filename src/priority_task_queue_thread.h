@@ -0,0 +1,191 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "futex.h"
+#include "histogram.h"
+#include "small_task.h"
+#include "spsc_queue.h"
+
+namespace flyzero {
+
+/**
+ * @brief 带优先级与截止时间的任务队列线程
+ *
+ * 每个优先级一个单生产者队列，不同优先级可以由不同线程提交。优先级按权重加权轮转：
+ * 每轮中优先级 i 至多执行 weights[i] 个任务，高优先级先执行，所有非空优先级的配额用完后开始新一轮。
+ * 队首任务距截止时间不足 urgency 时提前执行，已过截止时间的任务直接丢弃，不再迟到执行。
+ * 截止时间只在队首检查，同一优先级内仍按提交顺序执行。
+ */
+class priority_task_queue_thread : public std::thread {
+public:
+    using clock         = std::chrono::steady_clock;
+    using task_function = small_task<bool()>;
+    using alloc_type    = task_function::allocator_type;
+    using dealloc_type  = task_function::deallocator_type;
+
+    /**
+     * @brief 配置选项
+     */
+    struct options {
+        std::vector<unsigned>    weights{8, 4, 2, 1};                 ///< 各优先级的权重，0 为最高优先级
+        size_t                   queue_capacity{1024};                ///< 每个优先级的队列容量
+        std::chrono::nanoseconds urgency{std::chrono::milliseconds{1}};  ///< 提前执行的时间窗口
+    };
+
+    /**
+     * @brief 以默认选项构造
+     */
+    priority_task_queue_thread();
+
+    /**
+     * @brief 构造函数，启动工作线程
+     *
+     * @param opts 配置选项，weights 不能为空，权重不能为 0
+     * @param alloc 闭包过大时使用的分配器
+     * @param dealloc 闭包过大时使用的释放器
+     */
+    explicit priority_task_queue_thread(const options      &opts,
+                                        const alloc_type   &alloc   = malloc,
+                                        const dealloc_type &dealloc = free);
+
+    /**
+     * @brief 提交任务，返回 bool 或 void，返回 false 时停止线程，每个优先级只能由一个线程提交
+     *
+     * @param priority 优先级，0 为最高
+     * @param f 可调用对象
+     * @return 队列已满时返回 false
+     */
+    template <typename F>
+    bool push(size_t priority, F &&f);
+
+    /**
+     * @brief 提交带截止时间的任务，截止时间已过仍未开始执行时丢弃
+     */
+    template <typename F>
+    bool push(size_t priority, clock::time_point deadline, F &&f);
+
+    /**
+     * @brief 优先级数
+     */
+    size_t get_priority_count() const noexcept;
+
+    /**
+     * @brief 指定优先级已执行的任务数
+     */
+    size_t get_processed_task_num(size_t priority) const noexcept;
+
+    /**
+     * @brief 指定优先级因超过截止时间被丢弃的任务数
+     */
+    size_t get_shed_task_num(size_t priority) const noexcept;
+
+    /**
+     * @brief 指定优先级因临近截止时间被提前执行的任务数
+     */
+    size_t get_promoted_task_num(size_t priority) const noexcept;
+
+    /**
+     * @brief 指定优先级的排队时间直方图，单位纳秒，从提交到开始执行
+     */
+    const histogram &get_queue_time(size_t priority) const noexcept;
+
+    /**
+     * @brief 尚未执行的任务数，近似值
+     */
+    size_t get_current_task_num() const noexcept;
+
+protected:
+    static void thread_routine(priority_task_queue_thread &obj);
+
+private:
+    /**
+     * @brief 队列中的任务
+     */
+    struct entry {
+        template <typename F>
+        entry(F &&f, const alloc_type &alloc, const dealloc_type &dealloc, clock::rep deadline)
+            : fn{std::forward<F>(f), alloc, dealloc},
+              enqueued{clock::now().time_since_epoch().count()},
+              deadline{deadline} {}
+
+        task_function fn;        ///< 任务
+        clock::rep    enqueued;  ///< 提交时间
+        clock::rep    deadline;  ///< 截止时间，没有截止时间时为最大值
+    };
+
+    /**
+     * @brief 优先级
+     */
+    struct level {
+        level(size_t capacity, unsigned w) : queue{capacity}, weight{w}, credit{w} {}
+
+        spsc_queue<entry>   queue;         ///< 任务队列
+        unsigned            weight;        ///< 权重
+        unsigned            credit;        ///< 本轮剩余配额
+        std::atomic<size_t> processed{0};  ///< 已执行的任务数
+        std::atomic<size_t> shed{0};       ///< 丢弃的任务数
+        std::atomic<size_t> promoted{0};   ///< 提前执行的任务数
+        histogram           queue_time;    ///< 排队时间
+    };
+
+    /**
+     * @brief 提交任务
+     */
+    template <typename F>
+    bool push_function(size_t priority, clock::rep deadline, F &&f);
+
+    /**
+     * @brief 丢弃过期任务，挑选下一个执行的优先级，没有任务时返回空指针
+     */
+    level *select();
+
+    alloc_type                          alloc_;    ///< 分配器
+    dealloc_type                        dealloc_;  ///< 释放器，须比队列活得更久
+    std::vector<std::unique_ptr<level>> levels_;   ///< 各优先级
+    clock::rep                          urgency_;  ///< 提前执行的时间窗口
+    event_count                         ready_;    ///< 工作线程在此休眠
+};
+
+template <typename F>
+bool priority_task_queue_thread::push(size_t priority, F &&f) {
+    return push_function(priority, clock::time_point::max().time_since_epoch().count(),
+                         std::forward<F>(f));
+}
+
+template <typename F>
+bool priority_task_queue_thread::push(size_t priority, clock::time_point deadline, F &&f) {
+    return push_function(priority, deadline.time_since_epoch().count(), std::forward<F>(f));
+}
+
+template <typename F>
+bool priority_task_queue_thread::push_function(size_t priority, clock::rep deadline, F &&f) {
+    using type = std::decay_t<F>;
+
+    auto &lv = *levels_.at(priority);
+    bool  pushed;
+    if constexpr (std::is_void_v<std::invoke_result_t<type &>>) {
+        pushed = lv.queue.try_push(
+            [f = type(std::forward<F>(f))]() mutable {
+                f();
+                return true;
+            },
+            alloc_, dealloc_, deadline);
+    } else {
+        pushed = lv.queue.try_push(std::forward<F>(f), alloc_, dealloc_, deadline);
+    }
+
+    // 只有工作线程已休眠时才进入内核唤醒
+    if (pushed) ready_.notify_one();
+    return pushed;
+}
+
+}  // namespace flyzero
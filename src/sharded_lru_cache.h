@@ -0,0 +1,292 @@
+#pragma once
+
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "lru_cache.h"
+#include "utility.h"
+
+namespace flyzero {
+
+/**
+ * @brief 分片的并发 LRU 缓存
+ *
+ * 按键的哈希值把元素分到 2 的幂个分片，每个分片是一个独立加锁的 LruCache，
+ * 不同分片上的操作互不阻塞。分片取哈希值乘以黄金分割常数后的高位，
+ * 分片内的 LruCache 以低位选桶，两者互不相关。
+ * 迭代器不能越过锁的范围，因此查找以回调的形式在分片锁内访问元素；
+ * 清理过期元素逐个分片加锁，任何时刻只有一个分片被锁住。
+ *
+ * @tparam K 键类型
+ * @tparam V 值类型
+ * @tparam H 哈希函数类型，异构查找时需支持异构键
+ * @tparam E 比较函数类型
+ * @tparam A 分配器类型
+ */
+template <typename K,
+          typename V,
+          typename H = std::hash<K>,
+          typename E = std::equal_to<K>,
+          typename A = std::allocator<std::pair<K, V>>>
+class ShardedLruCache {
+    using Cache = LruCache<K, V, H, E, A>;
+
+    /**
+     * @brief 分片，独占缓存行，避免相邻分片的锁互相干扰
+     */
+    struct alignas(64) Shard {
+        Shard(typename Cache::Duration timeout, H const &hash, E const &equal, A const &alloc)
+            : cache_(timeout, hash, equal, alloc) {}
+
+        std::mutex mutex_;  ///< 保护 cache_
+        Cache cache_;       ///< 分片内的缓存
+    };
+
+    /**
+     * @brief 持有分片锁的访问
+     */
+    using Lock = std::lock_guard<std::mutex>;
+
+public:
+    /**
+     * @brief 时间点
+     */
+    using TimePoint = LruNodeBase::TimePoint;
+
+    /**
+     * @brief 超时时间
+     */
+    using Duration = typename Cache::Duration;
+
+    /**
+     * @brief 构造函数
+     * @param timeout 超时时间
+     * @param shard_count 分片数，向上取整为 2 的幂，通常取访问线程数的数倍
+     * @param hash 哈希函数，用于选择分片，并复制到每个分片内的 LruCache
+     * @param equal 比较函数，复制到每个分片内的 LruCache
+     * @param alloc 分配器，复制到每个分片内的 LruCache
+     */
+    explicit ShardedLruCache(Duration timeout,
+                             std::size_t shard_count = 16,
+                             H const &hash = H(),
+                             E const &equal = E(),
+                             A const &alloc = A());
+
+    /**
+     * @brief 禁止拷贝
+     */
+    ShardedLruCache(ShardedLruCache const &) = delete;
+    void operator=(ShardedLruCache const &) = delete;
+
+    /**
+     * @brief 分片数
+     */
+    std::size_t shard_count() const { return shards_.size(); }
+
+    /**
+     * @brief 获取元素数量，逐个分片加锁求和，并发修改时为近似值
+     */
+    std::size_t size() const;
+
+    /**
+     * @brief 异构查找元素，找到时在分片锁内调用 fn(const K &, V &)
+     * @tparam U 异构键
+     * @param key 键
+     * @param fn 回调函数，不能再访问本缓存
+     * @return bool 是否找到
+     */
+    template <typename U, typename F>
+    bool find(U const &key, F fn) requires std::regular_invocable<E, U, K>;
+
+    /**
+     * @brief 异构查找元素并更新访问时间，找到时在分片锁内调用 fn(const K &, V &)
+     * @param now 当前时间
+     * @param key 键
+     * @param fn 回调函数，不能再访问本缓存
+     * @return bool 是否找到
+     */
+    template <typename U, typename F>
+    bool find(TimePoint now, U const &key, F fn) requires std::regular_invocable<E, U, K>;
+
+    /**
+     * @brief 插入元素，键已存在时不修改
+     * @param now 当前时间
+     * @param key 键
+     * @param value 值
+     * @return bool 是否插入
+     */
+    bool insert(TimePoint now, K key, V value);
+
+    /**
+     * @brief 异构移除元素
+     * @return bool 是否移除
+     */
+    template <typename U>
+    bool erase(U const &key) requires std::regular_invocable<E, U, K>;
+
+    /**
+     * @brief 异构更新元素访问时间
+     * @return bool 是否找到
+     */
+    template <typename U>
+    bool touch(TimePoint now, U const &key) requires std::regular_invocable<E, U, K>;
+
+    /**
+     * @brief 清理全部分片的过期元素，逐个分片加锁，回调在分片锁内调用
+     * @tparam F 回调函数类型，需要支持 operator()(K, V)
+     * @param now 当前时间
+     * @param fn 回调函数
+     * @return size_t 清理的元素数量
+     */
+    template <typename F>
+    size_t clear_expired(TimePoint now, F fn) requires std::regular_invocable<F, K, V>;
+
+    /**
+     * @brief 清理全部分片的过期元素
+     */
+    size_t clear_expired(TimePoint now) {
+        return clear_expired(now, [](K, V) {});
+    }
+
+    /**
+     * @brief 只清理一个分片的过期元素，可由定时器每次清理一个分片，把清理分摊到多次
+     * @param shard 分片序号，取值范围 [0, shard_count())
+     * @param now 当前时间
+     * @param fn 回调函数
+     * @return size_t 清理的元素数量
+     */
+    template <typename F>
+    size_t clear_expired(std::size_t shard,
+                         TimePoint now,
+                         F fn) requires std::regular_invocable<F, K, V>;
+
+private:
+    /**
+     * @brief 选择键所在的分片，取哈希值乘以黄金分割常数后的第 32 位起的若干位
+     */
+    template <typename U>
+    Shard &shard_of(U const &key);
+
+    H hash_;                                      ///< 选择分片的哈希函数
+    std::vector<std::unique_ptr<Shard>> shards_;  ///< 分片
+};
+
+template <typename K, typename V, typename H, typename E, typename A>
+ShardedLruCache<K, V, H, E, A>::ShardedLruCache(Duration timeout,
+                                                std::size_t shard_count,
+                                                H const &hash,
+                                                E const &equal,
+                                                A const &alloc)
+    : hash_(hash) {
+    auto const n = utility::next_pow2(shard_count);
+    shards_.reserve(n);
+    for (auto i = 0ul; i < n; ++i) {
+        shards_.push_back(std::make_unique<Shard>(timeout, hash, equal, alloc));
+    }
+}
+
+template <typename K, typename V, typename H, typename E, typename A>
+std::size_t ShardedLruCache<K, V, H, E, A>::size() const {
+    std::size_t n = 0;
+    for (auto &shard : shards_) {
+        Lock lock(shard->mutex_);
+        n += shard->cache_.size();
+    }
+    return n;
+}
+
+template <typename K, typename V, typename H, typename E, typename A>
+template <typename U, typename F>
+bool ShardedLruCache<K, V, H, E, A>::find(U const &key,
+                                          F fn) requires std::regular_invocable<E, U, K> {
+    auto &shard = shard_of(key);
+    Lock lock(shard.mutex_);
+    auto const it = shard.cache_.find(key);
+    if (it == shard.cache_.end()) return false;
+
+    fn(Cache::key(it), Cache::value(it));
+    return true;
+}
+
+template <typename K, typename V, typename H, typename E, typename A>
+template <typename U, typename F>
+bool ShardedLruCache<K, V, H, E, A>::find(TimePoint now, U const &key, F fn) requires
+    std::regular_invocable<E, U, K> {
+    auto &shard = shard_of(key);
+    Lock lock(shard.mutex_);
+    auto const it = shard.cache_.find(key);
+    if (it == shard.cache_.end()) return false;
+
+    shard.cache_.touch(now, it);
+    fn(Cache::key(it), Cache::value(it));
+    return true;
+}
+
+template <typename K, typename V, typename H, typename E, typename A>
+bool ShardedLruCache<K, V, H, E, A>::insert(TimePoint now, K key, V value) {
+    auto &shard = shard_of(key);
+    Lock lock(shard.mutex_);
+    return shard.cache_.insert(now, std::move(key), std::move(value)).second;
+}
+
+template <typename K, typename V, typename H, typename E, typename A>
+template <typename U>
+bool ShardedLruCache<K, V, H, E, A>::erase(U const &key) requires std::regular_invocable<E, U, K> {
+    auto &shard = shard_of(key);
+    Lock lock(shard.mutex_);
+    auto const it = shard.cache_.find(key);
+    if (it == shard.cache_.end()) return false;
+
+    shard.cache_.erase(it);
+    return true;
+}
+
+template <typename K, typename V, typename H, typename E, typename A>
+template <typename U>
+bool ShardedLruCache<K, V, H, E, A>::touch(TimePoint now,
+                                           U const &key) requires std::regular_invocable<E, U, K> {
+    auto &shard = shard_of(key);
+    Lock lock(shard.mutex_);
+    auto const it = shard.cache_.find(key);
+    if (it == shard.cache_.end()) return false;
+
+    shard.cache_.touch(now, it);
+    return true;
+}
+
+template <typename K, typename V, typename H, typename E, typename A>
+template <typename F>
+size_t ShardedLruCache<K, V, H, E, A>::clear_expired(TimePoint now, F fn) requires
+    std::regular_invocable<F, K, V> {
+    size_t count = 0;
+    for (auto i = 0ul; i < shards_.size(); ++i) {
+        count += clear_expired(i, now, fn);
+    }
+    return count;
+}
+
+template <typename K, typename V, typename H, typename E, typename A>
+template <typename F>
+size_t ShardedLruCache<K, V, H, E, A>::clear_expired(std::size_t shard,
+                                                     TimePoint now,
+                                                     F fn) requires std::regular_invocable<F, K, V> {
+    auto &s = *shards_[shard];
+    Lock lock(s.mutex_);
+    return s.cache_.clear_expired(now, fn);
+}
+
+template <typename K, typename V, typename H, typename E, typename A>
+template <typename U>
+auto ShardedLruCache<K, V, H, E, A>::shard_of(U const &key) -> Shard & {
+    // 分片内的 LruCache 以哈希值低位选桶，这里取乘积的高位，避免同一分片的键挤在少数桶中
+    auto const h = static_cast<uint64_t>(hash_(key)) * 0x9e3779b97f4a7c15ULL;
+    return *shards_[(h >> 32) & (shards_.size() - 1)];
+}
+
+}  // namespace flyzero
@@ -0,0 +1,75 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "shared_memory.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifndef likely
+#define likely(x) (__builtin_expect(!!(x), 1))
+#endif
+
+#ifndef unlikely
+#define unlikely(x) (__builtin_expect(!!(x), 0))
+#endif
+
+void *shared_memory_map_mirrored(int const shmfd,
+                                 size_t head_size,
+                                 size_t const capacity,
+                                 size_t const align,
+                                 int const thp) {
+    // head_size 和 capacity 必须是对齐粒度的整数倍
+    assert(head_size > 0);
+    assert(capacity > 0);
+    assert((head_size & (align - 1)) == 0);
+    assert((capacity & (align - 1)) == 0);
+
+    // 先预订 total + capacity 长度的地址空间，大页时多预订 align 长度用于对齐起始地址
+    size_t const total = capacity + head_size;
+    size_t const slack = align > (size_t)sysconf(_SC_PAGESIZE) ? align : 0;
+    char *const base = mmap(NULL, total + capacity + slack, PROT_NONE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if unlikely (base == MAP_FAILED) return NULL;
+
+    // 对齐起始地址，归还首尾多余的地址空间
+    char *const addr = (char *)(((uintptr_t)base + align - 1) & ~(uintptr_t)(align - 1));
+    if (addr != base) munmap(base, addr - base);
+    if (base + slack != addr) munmap(addr + total + capacity, base + slack - addr);
+
+    // 将共享内存的 [0, total) 段映射到预订的内存 [addr, addr + total) 段上
+    int flags = MAP_SHARED | MAP_FIXED | (shmfd == -1 ? MAP_ANONYMOUS : 0);
+    int prot = PROT_READ | PROT_WRITE;
+    void *new_addr = mmap(addr, total, prot, flags, shmfd, 0);
+    if unlikely (new_addr != addr) {
+        goto ERROR_RETURN;
+    }
+
+    // 创建地址相邻的镜像内存区
+    // 将共享内存 [head_size, total) 段内存再次映射到预订的内存 [addr + total, addr + total +
+    // capacity) 段上。有文件描述符时按偏移再映射一次，大页内存也适用；
+    // 匿名共享内存没有文件描述符，通过 mremap 复制映射
+    if (shmfd >= 0) {
+        if unlikely (mmap(addr + total, capacity, prot, MAP_SHARED | MAP_FIXED, shmfd,
+                          (off_t)head_size) != addr + total) {
+            goto ERROR_RETURN;
+        }
+    } else if unlikely (mremap(addr + head_size, 0, capacity, MREMAP_MAYMOVE | MREMAP_FIXED,
+                               addr + total) != addr + total) {
+        goto ERROR_RETURN;
+    }
+
+    // 建议内核使用透明大页，内核未开启时忽略
+    if (thp) {
+        madvise(addr, total + capacity, MADV_HUGEPAGE);
+    }
+
+    return addr;
+
+ERROR_RETURN:
+    munmap(addr, total + capacity);
+    return NULL;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief 映射带镜像区的共享内存，circular_buffer 与 broadcast_buffer 共用
+ *        共享内存的 [0, head_size) 段为头部，[head_size, head_size + capacity) 段为数据区，
+ *        数据区之后紧接着再映射一次数据区，使跨越数据区末尾的读写在地址上连续。
+ *        映射总长度为 head_size + capacity * 2，通过 munmap 释放
+ *
+ * \param shmfd     共享内存对象文件描述符，为 -1 时创建匿名共享内存
+ * \param head_size 头部大小，必须是 align 的整数倍
+ * \param capacity  数据区大小，必须是 align 的整数倍
+ * \param align     起始地址的对齐粒度，大页时为大页大小
+ * \param thp       是否建议内核使用透明大页
+ *
+ * \return 成功时返回映射的起始地址，失败时返回空指针
+ */
+void* shared_memory_map_mirrored(
+    int shmfd, size_t head_size, size_t capacity, size_t align, int thp);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace flyzero {
+
+template <typename Signature, size_t Capacity = 48>
+class small_task;
+
+/**
+ * @brief 只能移动的类型擦除可调用对象，不超过 Capacity 字节的闭包直接存放在对象内部
+ *
+ * 闭包过大、对齐要求过高或移动构造可能抛出异常时，从构造时传入的分配器分配，
+ * 释放器复制一份与闭包存放在一起。默认容量使对象恰好占一个缓存行。
+ */
+template <typename R, typename... Args, size_t Capacity>
+class small_task<R(Args...), Capacity> {
+public:
+    using allocator_type   = std::function<void *(size_t)>;
+    using deallocator_type = std::function<void(void *)>;
+
+    /**
+     * @brief 闭包类型 F 是否直接存放在对象内部
+     */
+    template <typename F>
+    static constexpr bool fits_inline = sizeof(F) <= Capacity &&
+                                        alignof(F) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible_v<F>;
+
+    /**
+     * @brief 构造空对象
+     */
+    small_task() noexcept = default;
+
+    /**
+     * @brief 构造函数
+     *
+     * @param f 可调用对象
+     * @param allocator 闭包过大时使用的分配器
+     * @param deallocator 闭包过大时使用的释放器，复制后与闭包存放在一起
+     */
+    template <typename F>
+    small_task(F &&f, const allocator_type &allocator, const deallocator_type &deallocator);
+
+    /**
+     * @brief 移动构造函数
+     */
+    small_task(small_task &&other) noexcept;
+
+    /**
+     * @brief 移动赋值
+     */
+    small_task &operator=(small_task &&other) noexcept;
+
+    /**
+     * @brief 禁止拷贝
+     */
+    small_task(const small_task &) = delete;
+
+    /**
+     * @brief 禁止拷贝
+     */
+    small_task &operator=(const small_task &) = delete;
+
+    /**
+     * @brief 析构函数
+     */
+    ~small_task();
+
+    /**
+     * @brief 是否非空
+     */
+    explicit operator bool() const noexcept;
+
+    /**
+     * @brief 调用，对象不能为空
+     */
+    R operator()(Args... args);
+
+    /**
+     * @brief 销毁闭包，置为空对象
+     */
+    void reset() noexcept;
+
+private:
+    /**
+     * @brief 按闭包类型生成的操作表
+     */
+    struct operations {
+        R (*invoke)(void *storage, Args &&...args);
+        void (*relocate)(void *dst, void *src) noexcept;  ///< 移动到 dst 并销毁 src
+        void (*destroy)(void *storage) noexcept;
+    };
+
+    /**
+     * @brief 分配在堆上的闭包，释放器按值保存，调用方可以传入临时对象
+     */
+    template <typename F>
+    struct heap_block {
+        deallocator_type deallocator;
+        F                f;
+    };
+
+    template <typename F>
+    static const operations inline_operations;
+
+    template <typename F>
+    static const operations heap_operations;
+
+    const operations *ops_{nullptr};                               ///< 操作表，空对象为空指针
+    alignas(std::max_align_t) unsigned char storage_[Capacity];  ///< 闭包或堆上闭包的指针
+};
+
+template <typename R, typename... Args, size_t Capacity>
+template <typename F>
+const typename small_task<R(Args...), Capacity>::operations
+    small_task<R(Args...), Capacity>::inline_operations = {
+        [](void *storage, Args &&...args) -> R {
+            return std::invoke(*static_cast<F *>(storage), std::forward<Args>(args)...);
+        },
+        [](void *dst, void *src) noexcept {
+            new (dst) F(std::move(*static_cast<F *>(src)));
+            static_cast<F *>(src)->~F();
+        },
+        [](void *storage) noexcept { static_cast<F *>(storage)->~F(); },
+};
+
+template <typename R, typename... Args, size_t Capacity>
+template <typename F>
+const typename small_task<R(Args...), Capacity>::operations
+    small_task<R(Args...), Capacity>::heap_operations = {
+        [](void *storage, Args &&...args) -> R {
+            return std::invoke((*static_cast<heap_block<F> **>(storage))->f,
+                               std::forward<Args>(args)...);
+        },
+        [](void *dst, void *src) noexcept {
+            *static_cast<heap_block<F> **>(dst) = *static_cast<heap_block<F> **>(src);
+        },
+        [](void *storage) noexcept {
+            auto const block       = *static_cast<heap_block<F> **>(storage);
+            auto const deallocator = std::move(block->deallocator);
+            block->~heap_block<F>();
+            deallocator(block);
+        },
+};
+
+template <typename R, typename... Args, size_t Capacity>
+template <typename F>
+small_task<R(Args...), Capacity>::small_task(F                      &&f,
+                                             const allocator_type   &allocator,
+                                             const deallocator_type &deallocator) {
+    using type = std::decay_t<F>;
+    static_assert(std::is_invocable_r_v<R, type &, Args...>, "incompatible callable");
+
+    if constexpr (fits_inline<type>) {
+        new (storage_) type(std::forward<F>(f));
+        ops_ = &inline_operations<type>;
+    } else {
+        static_assert(alignof(heap_block<type>) <= alignof(std::max_align_t),
+                      "over-aligned closure");
+
+        auto const p = allocator(sizeof(heap_block<type>));
+        if (!p) throw std::bad_alloc{};
+
+        try {
+            auto const block = new (p) heap_block<type>{deallocator, std::forward<F>(f)};
+            new (storage_) heap_block<type> *(block);
+        } catch (...) {
+            deallocator(p);
+            throw;
+        }
+        ops_ = &heap_operations<type>;
+    }
+}
+
+template <typename R, typename... Args, size_t Capacity>
+small_task<R(Args...), Capacity>::small_task(small_task &&other) noexcept : ops_{other.ops_} {
+    if (ops_) {
+        ops_->relocate(storage_, other.storage_);
+        other.ops_ = nullptr;
+    }
+}
+
+template <typename R, typename... Args, size_t Capacity>
+auto small_task<R(Args...), Capacity>::operator=(small_task &&other) noexcept -> small_task & {
+    if (this != &other) {
+        reset();
+        if (other.ops_) {
+            other.ops_->relocate(storage_, other.storage_);
+            ops_       = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+    return *this;
+}
+
+template <typename R, typename... Args, size_t Capacity>
+small_task<R(Args...), Capacity>::~small_task() {
+    reset();
+}
+
+template <typename R, typename... Args, size_t Capacity>
+small_task<R(Args...), Capacity>::operator bool() const noexcept {
+    return ops_ != nullptr;
+}
+
+template <typename R, typename... Args, size_t Capacity>
+R small_task<R(Args...), Capacity>::operator()(Args... args) {
+    return ops_->invoke(storage_, std::forward<Args>(args)...);
+}
+
+template <typename R, typename... Args, size_t Capacity>
+void small_task<R(Args...), Capacity>::reset() noexcept {
+    if (ops_) {
+        ops_->destroy(storage_);
+        ops_ = nullptr;
+    }
+}
+
+}  // namespace flyzero
@@ -0,0 +1,291 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <utility>
+
+#include "utility.h"
+
+namespace flyzero {
+
+/**
+ * @brief 单生产者单消费者无锁队列
+ *
+ * 读写索引各占一个缓存行，以 acquire/release 同步。双方各自缓存对方的索引，
+ * 只有缓存显示空间或元素不足时才读取对方的缓存行；批量操作每批只发布一次索引，
+ * 生产者与消费者不必为每个元素来回传递缓存行。
+ * 只允许一个生产者线程和一个消费者线程，队列不可移动。
+ */
+template <typename Type>
+class spsc_queue {
+public:
+    using value_type       = Type;
+    using pointer          = value_type *;
+    using allocator_type   = std::function<void *(size_t)>;
+    using deallocator_type = std::function<void(void *)>;
+
+    static constexpr size_t const cache_line = 64;  ///< 缓存行大小
+
+    /**
+     * @brief 构造函数
+     *
+     * @param capacity 容量，向上取整为 2 的幂
+     * @param allocator 分配器
+     * @param deallocator 释放器
+     */
+    explicit spsc_queue(size_t                  capacity,
+                        const allocator_type   &allocator   = malloc,
+                        const deallocator_type &deallocator = free);
+
+    /**
+     * @brief 禁止拷贝
+     */
+    spsc_queue(const spsc_queue &) = delete;
+
+    /**
+     * @brief 禁止拷贝
+     */
+    spsc_queue &operator=(const spsc_queue &) = delete;
+
+    /**
+     * @brief 析构函数，销毁剩余元素，调用时生产者与消费者都已停止
+     */
+    ~spsc_queue();
+
+    /**
+     * @brief 容量
+     */
+    size_t capacity() const noexcept;
+
+    /**
+     * @brief 元素个数，并发读写时为近似值
+     */
+    size_t size() const noexcept;
+
+    /**
+     * @brief 是否为空，并发读写时为近似值
+     */
+    bool empty() const noexcept;
+
+    /**
+     * @brief 生产者原位构造一个元素
+     * @return 队列已满时返回 false
+     */
+    template <typename... Args>
+    bool try_push(Args &&...args);
+
+    /**
+     * @brief 生产者检查能否写入，返回 true 时随后的一次 try_push 必定成功
+     */
+    bool can_push() noexcept;
+
+    /**
+     * @brief 生产者批量移入元素，只发布一次写索引
+     *
+     * @param first 源迭代器，元素以 std::move(*first) 逐个移入
+     * @param n 最多移入的个数
+     * @return 实际移入的个数，队列已满时为 0
+     */
+    template <typename InputIt>
+    size_t try_push_n(InputIt first, size_t n);
+
+    /**
+     * @brief 消费者弹出一个元素
+     * @return 队列为空时返回 false
+     */
+    bool try_pop(value_type &value);
+
+    /**
+     * @brief 消费者批量弹出元素，只发布一次读索引
+     *
+     * @param out 目标迭代器，元素以 *out = std::move(...) 逐个移出
+     * @param n 最多弹出的个数
+     * @return 实际弹出的个数，队列为空时为 0
+     */
+    template <typename OutputIt>
+    size_t try_pop_n(OutputIt out, size_t n);
+
+    /**
+     * @brief 消费者查看队首元素
+     * @return 队列为空时返回空指针
+     */
+    pointer front() noexcept;
+
+    /**
+     * @brief 消费者销毁队首元素，队列不能为空
+     */
+    void pop() noexcept;
+
+private:
+    /**
+     * @brief 元素地址
+     */
+    pointer at(size_t idx) const noexcept;
+
+    /**
+     * @brief 生产者可写的个数，缓存的读索引显示空间不足 n 时才重新读取
+     */
+    size_t writable(size_t w, size_t n) noexcept;
+
+    /**
+     * @brief 消费者可读的个数，缓存的写索引显示元素不足 n 时才重新读取
+     */
+    size_t readable(size_t r, size_t n) noexcept;
+
+    alignas(cache_line) std::atomic<size_t> widx_{0};  ///< 写索引，生产者发布
+    size_t rcache_{0};                                 ///< 生产者缓存的读索引
+
+    alignas(cache_line) std::atomic<size_t> ridx_{0};  ///< 读索引，消费者发布
+    size_t wcache_{0};                                 ///< 消费者缓存的写索引
+
+    alignas(cache_line) size_t capacity_;  ///< 容量
+    size_t           mask_;                ///< 索引掩码
+    void            *buffer_;              ///< 元素数组
+    deallocator_type deallocator_;         ///< 释放器
+};
+
+template <typename Type>
+spsc_queue<Type>::spsc_queue(size_t                  capacity,
+                             const allocator_type   &allocator,
+                             const deallocator_type &deallocator)
+    : capacity_(utility::next_pow2(capacity)),
+      mask_(capacity_ - 1),
+      buffer_(allocator(capacity_ * sizeof(Type))),
+      deallocator_(deallocator) {
+    if (!buffer_) throw std::bad_alloc{};
+    assert(reinterpret_cast<uintptr_t>(buffer_) % alignof(Type) == 0);
+}
+
+template <typename Type>
+spsc_queue<Type>::~spsc_queue() {
+    auto const w = widx_.load(std::memory_order_acquire);
+    for (auto r = ridx_.load(std::memory_order_relaxed); r != w; ++r) at(r)->~Type();
+    deallocator_(buffer_);
+}
+
+template <typename Type>
+size_t spsc_queue<Type>::capacity() const noexcept {
+    return capacity_;
+}
+
+template <typename Type>
+size_t spsc_queue<Type>::size() const noexcept {
+    // 先读读索引，保证不小于 0
+    auto const r = ridx_.load(std::memory_order_acquire);
+    return widx_.load(std::memory_order_acquire) - r;
+}
+
+template <typename Type>
+bool spsc_queue<Type>::empty() const noexcept {
+    return size() == 0;
+}
+
+template <typename Type>
+template <typename... Args>
+bool spsc_queue<Type>::try_push(Args &&...args) {
+    auto const w = widx_.load(std::memory_order_relaxed);
+    if (writable(w, 1) == 0) return false;
+
+    new (at(w)) Type(std::forward<Args>(args)...);
+    widx_.store(w + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename Type>
+bool spsc_queue<Type>::can_push() noexcept {
+    return writable(widx_.load(std::memory_order_relaxed), 1) > 0;
+}
+
+template <typename Type>
+template <typename InputIt>
+size_t spsc_queue<Type>::try_push_n(InputIt first, size_t n) {
+    auto const w = widx_.load(std::memory_order_relaxed);
+    n            = std::min(n, writable(w, n));
+
+    size_t i = 0;
+    try {
+        for (; i < n; ++i, ++first) new (at(w + i)) Type(std::move(*first));
+    } catch (...) {
+        // 发布已构造的元素
+        widx_.store(w + i, std::memory_order_release);
+        throw;
+    }
+
+    if (n > 0) widx_.store(w + n, std::memory_order_release);
+    return n;
+}
+
+template <typename Type>
+bool spsc_queue<Type>::try_pop(value_type &value) {
+    return try_pop_n(&value, 1) == 1;
+}
+
+template <typename Type>
+template <typename OutputIt>
+size_t spsc_queue<Type>::try_pop_n(OutputIt out, size_t n) {
+    auto const r = ridx_.load(std::memory_order_relaxed);
+    n            = std::min(n, readable(r, n));
+
+    size_t i = 0;
+    try {
+        for (; i < n; ++i, ++out) {
+            auto const p = at(r + i);
+            *out         = std::move(*p);
+            p->~Type();
+        }
+    } catch (...) {
+        // 未移出的元素仍留在队列中
+        ridx_.store(r + i, std::memory_order_release);
+        throw;
+    }
+
+    if (n > 0) ridx_.store(r + n, std::memory_order_release);
+    return n;
+}
+
+template <typename Type>
+auto spsc_queue<Type>::front() noexcept -> pointer {
+    auto const r = ridx_.load(std::memory_order_relaxed);
+    return readable(r, 1) > 0 ? at(r) : nullptr;
+}
+
+template <typename Type>
+void spsc_queue<Type>::pop() noexcept {
+    auto const r = ridx_.load(std::memory_order_relaxed);
+    assert(readable(r, 1) > 0);
+    at(r)->~Type();
+    ridx_.store(r + 1, std::memory_order_release);
+}
+
+template <typename Type>
+auto spsc_queue<Type>::at(size_t idx) const noexcept -> pointer {
+    return static_cast<pointer>(buffer_) + (idx & mask_);
+}
+
+template <typename Type>
+size_t spsc_queue<Type>::writable(size_t w, size_t n) noexcept {
+    auto space = capacity_ - (w - rcache_);
+    if (space < n) {
+        rcache_ = ridx_.load(std::memory_order_acquire);
+        space   = capacity_ - (w - rcache_);
+    }
+    return space;
+}
+
+template <typename Type>
+size_t spsc_queue<Type>::readable(size_t r, size_t n) noexcept {
+    auto avail = wcache_ - r;
+    if (avail < n) {
+        wcache_ = widx_.load(std::memory_order_acquire);
+        avail   = wcache_ - r;
+    }
+    return avail;
+}
+
+}  // namespace flyzero
@@ -1,39 +1,58 @@
 #include "task_queue_thread.h"
 
+#include <array>
+
 namespace flyzero
 {
 
     bool task_queue_thread::push(task * th, void (* deleter)(task*))
     {
-        if (queue_.full())
-            return false;
-
-        queue_.push(task_pointer(th, deleter));
-
-        if (get_current_task_num() == 1)
-            sema_.post();
+        // 失败时任务所有权仍归调用者
+        legacy_task t(th, deleter);
+        if (push_function(std::move(t)))
+            return true;
 
-        return true;
+        t.release();
+        return false;
     }
 
     void task_queue_thread::thread_routine(task_queue_thread & obj)
     {
+        // 批量取出任务，每批只更新一次读索引
+        std::array<task_function, batch_size> batch;
+
         for ( ; ; )
         {
-            if (obj.queue_.empty())
+            // 队列为空时先自旋，再让出 CPU，最后休眠，任务间隔很短时不必休眠
+            auto const n = spin_then_park(
+                obj.ready_,
+                [&] { return obj.queue_.try_pop_n(batch.begin(), batch.size()); },
+                [&] { increase(obj.sleep_num_); },
+                spin_count, yield_count);
+
+            increase(obj.batch_num_);
+
+            // 每批读一次开关，统计关闭时不读时钟
+            auto const metrics = obj.metrics_enabled_.load(std::memory_order_relaxed);
+            if (metrics)
+                obj.queue_depth_.record(n + obj.queue_.size());
+
+            for (std::size_t i = 0; i < n; ++i)
             {
-                obj.sema_.wait();
-                continue;
-            }
+                auto const start = metrics ? clock::now() : clock::time_point();
 
-            auto fin = obj.front()->run(obj);
+                auto fin = batch[i](obj);
 
-            obj.pop();
+                batch[i].reset();
 
-            ++obj.processed_task_num_;
+                if (metrics)
+                    obj.run_time_.record(elapsed_ns(start));
 
-            if (!fin)
-                break;
+                increase(obj.processed_task_num_);
+
+                if (!fin)
+                    return;
+            }
         }
     }
 
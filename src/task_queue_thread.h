@@ -1,16 +1,23 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <thread>
 #include <memory>
+#include <cstdint>
 #include <cstdlib>
+#include <type_traits>
 
-#include <boost/interprocess/sync/interprocess_semaphore.hpp>
-
-#include "circular_queue.h"
+#include "cpu_topology.h"
+#include "futex.h"
+#include "histogram.h"
+#include "small_task.h"
+#include "spsc_queue.h"
 
 namespace flyzero
 {
 
+    // 任务队列线程，push 只能由一个线程调用
     class task_queue_thread
         : public std::thread
     {
@@ -23,43 +30,181 @@ namespace flyzero
             virtual bool run(class task_queue_thread & thread_obj) = 0;
         };
 
+        using clock = std::chrono::steady_clock;
+
         using alloc_type = std::function<void*(std::size_t)>;
         using dealloc_type = std::function<void(void *)>;
 
+        // 队列中的任务，较小的闭包直接存放在队列槽位中
+        using task_function = flyzero::small_task<bool(task_queue_thread &)>;
+
     protected:
-        using task_deleter = std::function<void(task *)>;
-        using task_pointer = std::unique_ptr<task, task_deleter>;
-        using task_queue = flyzero::circular_queue<task_pointer>;
+        using task_queue = flyzero::spsc_queue<task_function>;
+
+        // 工作线程每次从队列中批量取出的最大任务数
+        static constexpr std::size_t batch_size = 32;
+
+        // 队列为空时先自旋 spin_count 次，再让出 CPU yield_count 次，之后休眠；单核时直接休眠
+        static constexpr int spin_count = 256;
+        static constexpr int yield_count = 16;
 
     public:
         explicit task_queue_thread(std::size_t const queue_capacity, const alloc_type & alloc = malloc, const dealloc_type & dealloc = free)
-            : queue_(queue_capacity, alloc, dealloc)
+            : alloc_(alloc)
+            , dealloc_(dealloc)
+            , queue_(queue_capacity, alloc, dealloc)
             , processed_task_num_(0)
-            , sema_(0)
         {
-            // start the thread after queue and sema are ready
+            // start the thread after queue is ready
             this->std::thread::operator=(std::thread(thread_routine, std::ref(*this)));
         }
 
         bool push(task* th, void (*deleter)(task*));
 
-        std::size_t get_processed_task_num(void) const { return processed_task_num_; }
+        // 提交可调用对象，参数为 task_queue_thread & 或为空，返回 bool 或 void，返回 false 时停止线程
+        // 闭包能放入 task_function 时不分配内存，否则从构造时传入的 alloc 分配
+        template <typename F>
+        bool push(F && f);
+
+        std::size_t get_processed_task_num(void) const { return processed_task_num_.load(std::memory_order_relaxed); }
 
         std::size_t get_current_task_num(void) const { return queue_.size(); }
 
-    protected:
-        void pop(void) { queue_.pop(); }
+        // 以下计数器与直方图均为单写者原子变量，任意线程都可以随时读取
+
+        // 提交成功的任务数，由提交线程更新
+        std::size_t get_pushed_task_num(void) const { return pushed_task_num_.load(std::memory_order_relaxed); }
+
+        // 因队列已满提交失败的次数
+        std::size_t get_rejected_task_num(void) const { return rejected_task_num_.load(std::memory_order_relaxed); }
+
+        // 工作线程批量取出任务的次数，与已执行任务数之比为平均批大小
+        std::size_t get_batch_num(void) const { return batch_num_.load(std::memory_order_relaxed); }
+
+        // 工作线程因队列为空而休眠的次数
+        std::size_t get_sleep_num(void) const { return sleep_num_.load(std::memory_order_relaxed); }
+
+        // 开启或关闭直方图统计，开启后每个任务多读三次时钟，默认关闭
+        // 开启前已提交的任务不计入排队时间
+        void enable_metrics(bool enable) { metrics_enabled_.store(enable, std::memory_order_relaxed); }
 
-        task * front(void) { return queue_.front().get(); }
+        // 从提交到开始执行的时间，单位纳秒
+        const histogram & get_wait_time(void) const { return wait_time_; }
 
-        const task * front(void) const { return queue_.front().get(); }
+        // 任务执行时间，单位纳秒
+        const histogram & get_run_time(void) const { return run_time_; }
 
+        // 每次取任务时队列中的任务数
+        const histogram & get_queue_depth(void) const { return queue_depth_; }
+
+        // 按放置策略放置工作线程，index 为线程在一组线程中的序号，失败时抛出 std::system_error
+        void set_placement(const thread_placement & placement, std::size_t index = 0) { placement.apply(*this, index); }
+
+    protected:
         static void thread_routine(task_queue_thread & obj);
 
     private:
+        // 以 push(task *, deleter) 提交的任务
+        class legacy_task
+        {
+        public:
+            legacy_task(task * th, void (*deleter)(task *)) noexcept : th_(th), deleter_(deleter) {}
+
+            legacy_task(legacy_task && other) noexcept : th_(other.th_), deleter_(other.deleter_) { other.th_ = nullptr; }
+
+            ~legacy_task(void) { if (th_) deleter_(th_); }
+
+            bool operator()(task_queue_thread & obj) { return th_->run(obj); }
+
+            void release(void) { th_ = nullptr; }
+
+        private:
+            task * th_;
+            void (*deleter_)(task *);
+        };
+
+        // 在队列槽位中原位构造任务，开启统计时附带提交时间
+        template <typename F>
+        bool push_function(F && f);
+
+        // 距 since 的纳秒数
+        static std::uint64_t elapsed_ns(clock::time_point since) { return std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - since).count(); }
+
+        alloc_type alloc_;
+        dealloc_type dealloc_;
         task_queue queue_;
-        std::size_t processed_task_num_;
-        boost::interprocess::interprocess_semaphore sema_;
+        std::atomic<std::size_t> processed_task_num_;
+        event_count ready_;
+
+        std::atomic<std::size_t> pushed_task_num_{0};
+        std::atomic<std::size_t> rejected_task_num_{0};
+        std::atomic<std::size_t> batch_num_{0};
+        std::atomic<std::size_t> sleep_num_{0};
+        std::atomic<bool> metrics_enabled_{false};
+        histogram wait_time_;
+        histogram run_time_;
+        histogram queue_depth_;
     };
 
+    template <typename F>
+    bool task_queue_thread::push(F && f)
+    {
+        using type = std::decay_t<F>;
+
+        if constexpr (std::is_invocable_v<type &, task_queue_thread &>)
+        {
+            if constexpr (std::is_void_v<std::invoke_result_t<type &, task_queue_thread &>>)
+                return push_function([f = type(std::forward<F>(f))](task_queue_thread & obj) mutable { f(obj); return true; });
+            else
+                return push_function(std::forward<F>(f));
+        }
+        else
+        {
+            if constexpr (std::is_void_v<std::invoke_result_t<type &>>)
+                return push_function([f = type(std::forward<F>(f))](task_queue_thread &) mutable { f(); return true; });
+            else
+                return push_function([f = type(std::forward<F>(f))](task_queue_thread &) mutable { return static_cast<bool>(f()); });
+        }
+    }
+
+    template <typename F>
+    bool task_queue_thread::push_function(F && f)
+    {
+        bool pushed;
+        if (metrics_enabled_.load(std::memory_order_relaxed))
+        {
+            // 包装闭包会移走 f，先确认有空位，失败时 f 保持原样，push(task *, deleter) 依赖这一点
+            if (!queue_.can_push())
+            {
+                increase(rejected_task_num_);
+                return false;
+            }
+
+            // 开始执行时记录排队时间，闭包多占 8 字节
+            auto const enqueued = clock::now();
+            pushed = queue_.try_push([f = std::decay_t<F>(std::forward<F>(f)), enqueued](task_queue_thread & obj) mutable
+            {
+                obj.wait_time_.record(elapsed_ns(enqueued));
+                return f(obj);
+            }, alloc_, dealloc_);
+        }
+        else
+        {
+            pushed = queue_.try_push(std::forward<F>(f), alloc_, dealloc_);
+        }
+
+        if (!pushed)
+        {
+            increase(rejected_task_num_);
+            return false;
+        }
+
+        increase(pushed_task_num_);
+
+        // 只有工作线程已休眠时才进入内核唤醒
+        ready_.notify_one();
+
+        return true;
+    }
+
 }
\ No newline at end of file
@@ -1,18 +1,69 @@
 #include "tcp_connection.h"
 
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <netinet/in.h>
 #include <sys/socket.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+
 #include "circular_buffer.h"
 
 namespace flyzero {
 
+namespace {
+
+/**
+ * @brief 发送时间戳保留的最大数据块数，防止收不到确认时无限增长
+ */
+constexpr size_t const max_tx_chunks = 4096;
+
+/**
+ * @brief 时间戳控制消息缓冲区
+ */
+union timestamp_control_buffer {
+    char    data[CMSG_SPACE(sizeof(scm_timestamping)) + CMSG_SPACE(sizeof(sock_extended_err) + 64)];
+    cmsghdr align;
+};
+
+/**
+ * @brief 转换为纳秒
+ */
+inline uint64_t to_ns(const timespec &ts) noexcept {
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief 内核时间戳使用的时钟，单位纳秒
+ */
+inline uint64_t realtime_ns() noexcept {
+    timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    return to_ns(ts);
+}
+
+/**
+ * @brief 读取控制消息中的软件时间戳
+ */
+inline uint64_t software_timestamp(const cmsghdr *cmsg) noexcept {
+    scm_timestamping tss;
+    std::memcpy(&tss, CMSG_DATA(cmsg), sizeof tss);
+    return to_ns(tss.ts[0]);
+}
+
+}  // namespace
+
 void tcp_connection::on_read() {
     while (true) {
         // 获取可写入的空间
         auto const wbuf = circular_buffer_get_writable(rcb_.get());
         if (wbuf.size > 0) [[likely]] {
             // 有可写入的空间，读取数据
-            auto const n = ::recv(fd(), wbuf.data, wbuf.size, 0);
+            auto const n = receive(wbuf.data, wbuf.size);
             if (n > 0) [[likely]] {
                 circular_buffer_push_data(rcb_.get(), n);
                 continue;
@@ -37,10 +88,13 @@ void tcp_connection::on_read() {
 }
 
 void tcp_connection::on_write() {
+    if (ts_) [[unlikely]]
+        on_error();
+
     while (true) {
         auto const rbuf = circular_buffer_get_readable(wcb_.get());
         if (rbuf.size > 0) [[likely]] {
-            auto const n = ::send(fd(), rbuf.data, rbuf.size, 0);
+            auto const n = ::send(fd(), rbuf.data, rbuf.size, MSG_NOSIGNAL);
             if (n > 0) [[likely]] {
                 circular_buffer_pop_data(wcb_.get(), n);
                 continue;
@@ -53,16 +107,51 @@ void tcp_connection::on_write() {
                 on_close();
                 return;
             }
-        } else if (produce() == 0) [[unlikely]] {
-            on_close();
+        } else if (produce() == 0) {
+            // 没有可写数据，等待 send() 或下一次可写事件
             return;
         }
     }
 }
 
+size_t tcp_connection::send(const void *data, size_t size) {
+    auto const src = static_cast<const char *>(data);
+    size_t     n   = 0;
+
+    // 写入写环形缓冲区并尽量发送，发送腾出空间后继续写入，
+    // 直到全部写入或缓冲区确实已满；剩余数据在可写事件中发送，错误在读事件中处理
+    while (true) {
+        auto const wbuf = circular_buffer_get_writable_min(wcb_.get(), size - n);
+        auto const m    = std::min(size - n, wbuf.size);
+        std::memcpy(wbuf.data, src + n, m);
+        commit_write(m);
+        n += m;
+
+        size_t flushed = 0;
+        while (true) {
+            auto const rbuf = circular_buffer_get_readable(wcb_.get());
+            if (rbuf.size == 0) break;
+
+            auto const sent = ::send(fd(), rbuf.data, rbuf.size, MSG_NOSIGNAL);
+            if (sent <= 0) break;
+
+            circular_buffer_pop_data(wcb_.get(), sent);
+            flushed += sent;
+        }
+
+        if (n == size || flushed == 0) return n;
+    }
+}
+
 inline size_t tcp_connection::consume() {
-    // 消费可读数据
-    auto const rbuf         = circular_buffer_get_readable(rcb_.get());
+    // 消费全部可读数据，读环形缓冲区已满时报文可能占满整个缓冲区
+    auto const rbuf = circular_buffer_get_readable_min(rcb_.get(), SIZE_MAX);
+    if (ts_ && ts_->rx_time) [[unlikely]] {
+        auto const now = realtime_ns();
+        ts_->stats.kernel_to_handler.record(now > ts_->rx_time ? now - ts_->rx_time : 0);
+        ts_->rx_time = 0;
+    }
+
     auto const consume_size = on_read(rbuf.data, rbuf.size);
     if (consume_size > 0) [[likely]]
         circular_buffer_pop_data(rcb_.get(), consume_size);
@@ -74,16 +163,129 @@ inline size_t tcp_connection::produce() {
     auto const wbuf         = circular_buffer_get_writable(wcb_.get());
     auto const produce_size = on_write(wbuf.data, wbuf.size);
     if (produce_size > 0) [[likely]]
-        circular_buffer_push_data(wcb_.get(), produce_size);
+        commit_write(produce_size);
     return produce_size;
 }
 
-auto tcp_connection::create_cb(size_t size) -> cb {
+inline void tcp_connection::commit_write(size_t size) {
+    if (size == 0) return;
+
+    circular_buffer_push_data(wcb_.get(), size);
+    if (ts_) [[unlikely]] {
+        ts_->produced += size;
+        ts_->chunks.push_back({ts_->produced, realtime_ns()});
+
+        // 收不到发送时间戳时（如 Unix 域套接字）丢弃最早的数据块
+        if (ts_->chunks.size() > max_tx_chunks) {
+            ts_->chunks.pop_front();
+            ++ts_->base;
+        }
+    }
+}
+
+bool tcp_connection::enable_timestamping() {
+    if (ts_) return true;
+
+    unsigned const flags = SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE |
+                           SOF_TIMESTAMPING_TX_SCHED | SOF_TIMESTAMPING_TX_SOFTWARE |
+                           SOF_TIMESTAMPING_TX_ACK | SOF_TIMESTAMPING_OPT_ID |
+                           SOF_TIMESTAMPING_OPT_TSONLY;
+    if (::setsockopt(fd(), SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof flags) != 0) {
+        return false;
+    }
+
+    ts_ = std::make_unique<timestamping>();
+    return true;
+}
+
+ssize_t tcp_connection::receive(void *data, size_t size) {
+    if (!ts_) [[likely]]
+        return ::recv(fd(), data, size, 0);
+
+    // 同时读取接收时间戳
+    iovec                    iov{data, size};
+    timestamp_control_buffer ctrl;
+    msghdr                   msg{};
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = ctrl.data;
+    msg.msg_controllen = sizeof ctrl.data;
+
+    auto const n = ::recvmsg(fd(), &msg, 0);
+    if (n > 0 && ts_->rx_time == 0) {
+        for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+                ts_->rx_time = software_timestamp(cmsg);
+            }
+        }
+    }
+
+    return n;
+}
+
+void tcp_connection::on_error() {
+    if (!ts_) return;
+
+    // 读取错误队列中的全部发送时间戳
+    while (true) {
+        timestamp_control_buffer ctrl;
+        msghdr                   msg{};
+        msg.msg_control    = ctrl.data;
+        msg.msg_controllen = sizeof ctrl.data;
+        if (::recvmsg(fd(), &msg, MSG_ERRQUEUE) < 0) return;
+
+        uint64_t                 time = 0;
+        const sock_extended_err *err  = nullptr;
+        for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING) {
+                time = software_timestamp(cmsg);
+            } else if ((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                       (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+                err = reinterpret_cast<const sock_extended_err *>(CMSG_DATA(cmsg));
+            }
+        }
+
+        if (time && err && err->ee_errno == ENOMSG &&
+            err->ee_origin == SO_EE_ORIGIN_TIMESTAMPING) {
+            on_tx_timestamp(err->ee_info, err->ee_data, time);
+        }
+    }
+}
+
+void tcp_connection::on_tx_timestamp(uint32_t stage, uint32_t key, uint64_t time) {
+    auto &ts = *ts_;
+    if (stage > SCM_TSTAMP_ACK || ts.produced == 0) return;
+
+    // 将 32 位的字节偏移还原为 64 位，得到已到达该阶段的字节数
+    auto const last    = ts.produced - 1;
+    auto const reached = last - static_cast<uint32_t>(static_cast<uint32_t>(last) - key) + 1;
+
+    histogram *const hists[] = {
+        &ts.stats.handler_to_wire, &ts.stats.handler_to_sched, &ts.stats.handler_to_ack};
+
+    // 记录全部已到达该阶段的数据块的时延
+    auto &idx = ts.stage[stage];
+    idx       = std::max(idx, ts.base);
+    while (idx - ts.base < ts.chunks.size() && ts.chunks[idx - ts.base].end <= reached) {
+        auto const produced = ts.chunks[idx - ts.base].time;
+        hists[stage]->record(time > produced ? time - produced : 0);
+        ++idx;
+    }
+
+    // 丢弃全部阶段都已处理的数据块
+    auto const done = std::min({ts.stage[0], ts.stage[1], ts.stage[2]});
+    while (ts.base < done) {
+        ts.chunks.pop_front();
+        ++ts.base;
+    }
+}
+
+auto tcp_connection::create_cb(size_t size, int flag) -> cb {
     if (size == 0) {
         return cb{nullptr};
     }
 
-    auto const p = circular_buffer_create(nullptr, size, 0, 0);
+    auto const p = circular_buffer_create(nullptr, size, 0, flag);
     if (!p) {
         throw std::runtime_error{"Failed to create circular buffer"};
     }
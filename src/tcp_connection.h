@@ -1,10 +1,13 @@
 #pragma once
 
+#include <cstdint>
+#include <deque>
 #include <memory>
 
 #include "circular_buffer.h"
 #include "event_dispatch.h"
 #include "file_descriptor.h"
+#include "histogram.h"
 
 namespace flyzero {
 
@@ -16,14 +19,26 @@ class tcp_connection : public event_dispatch::io_listener {
     using cb = std::unique_ptr<circular_buffer, deleter>;
 
 public:
+    /**
+     * @brief 基于内核时间戳的时延统计，单位为纳秒
+     */
+    struct latency_stats {
+        histogram kernel_to_handler;  ///< 内核收到数据到交给 on_read 处理
+        histogram handler_to_sched;   ///< on_write 生产数据到进入发送队列调度
+        histogram handler_to_wire;    ///< on_write 生产数据到交给网卡驱动
+        histogram handler_to_ack;     ///< on_write 生产数据到收到对端确认
+    };
+
     /**
      * @brief 构造函数
      *
      * @param sock 套接字
      * @param rcb_size 读环形缓冲区大小
      * @param wcb_size 写环形缓冲区大小
+     * @param cb_flag 创建环形缓冲区的标志，如 CIRCULAR_BUFFER_PREFAULT | CIRCULAR_BUFFER_MLOCK
+     *        可在建立连接时预分配并锁定缓冲区，避免收发路径上的首次缺页
      */
-    tcp_connection(int sock, size_t rcb_size, size_t wcb_size);
+    tcp_connection(int sock, size_t rcb_size, size_t wcb_size, int cb_flag = 0);
 
     /**
      * @brief 构造函数
@@ -31,8 +46,10 @@ public:
      * @param sock 套接字
      * @param rcb_size 读环形缓冲区大小
      * @param wcb_size 写环形缓冲区大小
+     * @param cb_flag 创建环形缓冲区的标志，如 CIRCULAR_BUFFER_PREFAULT | CIRCULAR_BUFFER_MLOCK
+     *        可在建立连接时预分配并锁定缓冲区，避免收发路径上的首次缺页
      */
-    tcp_connection(file_descriptor &&sock, size_t rcb_size, size_t wcb_size);
+    tcp_connection(file_descriptor &&sock, size_t rcb_size, size_t wcb_size, int cb_flag = 0);
 
     /**
      * @brief 禁止拷贝
@@ -59,7 +76,42 @@ public:
      */
     tcp_connection &operator=(tcp_connection &&) = default;
 
+    /**
+     * @brief 启用 SO_TIMESTAMPING，记录软件接收时间戳以及发送调度、发送、确认时间戳，
+     *        应在发送任何数据之前调用
+     *
+     * @return 成功时返回 true
+     */
+    bool enable_timestamping();
+
+    /**
+     * @brief 时延统计
+     *
+     * @return 未启用时间戳时返回空指针
+     */
+    const latency_stats *latency() const noexcept;
+
 private:
+    /**
+     * @brief 时间戳状态
+     */
+    struct timestamping {
+        /**
+         * @brief 一次 on_write 生产的数据
+         */
+        struct chunk {
+            uint64_t end;   ///< 数据结束偏移
+            uint64_t time;  ///< 生产时间
+        };
+
+        latency_stats     stats;        ///< 时延统计
+        std::deque<chunk> chunks;       ///< 尚未收到确认时间戳的数据
+        uint64_t          base{0};      ///< chunks 首元素的序号
+        uint64_t          stage[3]{};   ///< 各发送阶段已处理到的 chunk 序号
+        uint64_t          produced{0};  ///< 已生产的字节数
+        uint64_t          rx_time{0};   ///< 待处理数据中最早的内核接收时间
+    };
+
     /**
      * @brief 读取数据
      */
@@ -70,6 +122,25 @@ private:
      */
     void on_write() override final;
 
+    /**
+     * @brief 读取错误队列中的发送时间戳
+     */
+    void on_error() override final;
+
+    /**
+     * @brief 接收数据，启用时间戳时同时读取接收时间戳
+     */
+    ssize_t receive(void *data, size_t size);
+
+    /**
+     * @brief 处理一个发送时间戳
+     *
+     * @param stage 发送阶段，SCM_TSTAMP_SCHED、SCM_TSTAMP_SND 或 SCM_TSTAMP_ACK
+     * @param key 到达该阶段的最后一个字节的偏移
+     * @param time 时间戳
+     */
+    void on_tx_timestamp(uint32_t stage, uint32_t key, uint64_t time);
+
     /**
      * @brief 消费可读数据
      */
@@ -80,13 +151,19 @@ private:
      */
     size_t produce();
 
+    /**
+     * @brief 提交已写入写环形缓冲区的数据
+     */
+    void commit_write(size_t size);
+
     /**
      * @brief 创建环形缓冲区
      *
      * @param size 缓冲区大小，若为 0，则返回空的缓冲区
+     * @param flag 创建标志，CIRCULAR_BUFFER_* 按位或
      * @return 环形缓冲区对象指针
      */
-    static cb create_cb(size_t size);
+    static cb create_cb(size_t size, int flag);
 
 protected:
     /**
@@ -95,30 +172,47 @@ protected:
     virtual size_t on_read(const void *data, size_t size) = 0;
 
     /**
-     * @brief 写数据处理函数
+     * @brief 写数据处理函数，写环形缓冲区为空且可写时调用，返回 0 表示暂无数据可写
      */
     virtual size_t on_write(void *data, size_t size) = 0;
 
+    /**
+     * @brief 将数据写入写环形缓冲区并尽量发送，发送腾出空间后继续写入，未发送完的数据在可写事件中继续发送
+     *
+     * @param data 数据
+     * @param size 数据长度
+     * @return 实际写入写环形缓冲区的长度，只有写环形缓冲区已满且套接字暂时无法发送时小于 size
+     */
+    size_t send(const void *data, size_t size);
+
     /**
      * @brief 关闭连接处理函数
      */
     virtual void on_close() = 0;
 
 private:
-    cb rcb_{};  ///< 读环形缓冲区对象指针
-    cb wcb_{};  ///< 写环形缓冲区对象指针
+    cb                            rcb_{};  ///< 读环形缓冲区对象指针
+    cb                            wcb_{};  ///< 写环形缓冲区对象指针
+    std::unique_ptr<timestamping> ts_{};   ///< 时间戳状态，未启用时为空
 };
 
 inline void tcp_connection::deleter::operator()(circular_buffer *cb) const noexcept {
     circular_buffer_destroy(cb);
 }
 
-inline tcp_connection::tcp_connection(int sock, size_t rcb_size, size_t wcb_size)
-    : tcp_connection{file_descriptor(sock), rcb_size, wcb_size} {}
+inline tcp_connection::tcp_connection(int sock, size_t rcb_size, size_t wcb_size, int cb_flag)
+    : tcp_connection{file_descriptor(sock), rcb_size, wcb_size, cb_flag} {}
 
-inline tcp_connection::tcp_connection(file_descriptor &&sock, size_t rcb_size, size_t wcb_size)
+inline tcp_connection::tcp_connection(file_descriptor &&sock,
+                                      size_t             rcb_size,
+                                      size_t             wcb_size,
+                                      int                cb_flag)
     : event_dispatch::io_listener{std::move(sock)},
-      rcb_{create_cb(rcb_size)},
-      wcb_{create_cb(wcb_size)} {}
+      rcb_{create_cb(rcb_size, cb_flag)},
+      wcb_{create_cb(wcb_size, cb_flag)} {}
+
+inline auto tcp_connection::latency() const noexcept -> const latency_stats * {
+    return ts_ ? &ts_->stats : nullptr;
+}
 
 }  // namespace flyzero
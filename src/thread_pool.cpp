@@ -0,0 +1,287 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "utility.h"
+
+namespace flyzero {
+
+/**
+ * @brief 工作线程
+ */
+struct thread_pool::worker {
+    /**
+     * @brief Chase-Lev 双端队列，容量固定，所有者在底部压入与取出，其他线程在顶部窃取
+     */
+    class deque {
+    public:
+        explicit deque(size_t capacity);
+
+        /**
+         * @brief 所有者压入任务
+         * @return 队列已满时返回 false
+         */
+        bool push(const task_entry &entry) noexcept;
+
+        /**
+         * @brief 所有者取出最近压入的任务
+         */
+        bool take(task_entry &entry) noexcept;
+
+        /**
+         * @brief 其他线程窃取最早压入的任务，与其他窃取者或所有者竞争失败时也返回 false
+         */
+        bool steal(task_entry &entry) noexcept;
+
+        /**
+         * @brief 任务数，近似值
+         */
+        size_t size() const noexcept;
+
+    private:
+        /**
+         * @brief 槽位，窃取者可能与所有者同时读写，因此以原子变量存放
+         */
+        struct slot {
+            std::atomic<task *>       th{nullptr};
+            std::atomic<deleter_type> deleter{nullptr};
+        };
+
+        alignas(64) std::atomic<int64_t> top_{0};     ///< 窃取端
+        alignas(64) std::atomic<int64_t> bottom_{0};  ///< 所有者端
+        alignas(64) size_t const mask_;               ///< 索引掩码
+        std::unique_ptr<slot[]> slots_;               ///< 槽位数组
+    };
+
+    worker(thread_pool &p, size_t capacity, uint64_t seed) : pool{p}, tasks{capacity}, rng{seed} {}
+
+    thread_pool        &pool;          ///< 所属线程池
+    deque               tasks;         ///< 本地任务
+    std::atomic<size_t> processed{0};  ///< 已执行的任务数
+    uint64_t            rng;           ///< 挑选窃取对象的随机数状态
+    uint32_t            tick{0};       ///< 取任务的次数
+    std::thread         thread;        ///< 线程
+};
+
+thread_local thread_pool::worker *thread_pool::current_ = nullptr;
+
+thread_pool::worker::deque::deque(size_t capacity)
+    : mask_{utility::next_pow2(capacity) - 1}, slots_{new slot[mask_ + 1]} {}
+
+bool thread_pool::worker::deque::push(const task_entry &entry) noexcept {
+    auto const b = bottom_.load(std::memory_order_relaxed);
+    auto const t = top_.load(std::memory_order_acquire);
+    if (b - t > static_cast<int64_t>(mask_)) return false;
+
+    auto &s = slots_[b & mask_];
+    s.th.store(entry.th, std::memory_order_relaxed);
+    s.deleter.store(entry.deleter, std::memory_order_relaxed);
+    bottom_.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+bool thread_pool::worker::deque::take(task_entry &entry) noexcept {
+    // 先占住底部，再检查是否与窃取者争夺同一个任务
+    auto const b = bottom_.load(std::memory_order_relaxed) - 1;
+    bottom_.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto t = top_.load(std::memory_order_relaxed);
+    if (t > b) {
+        bottom_.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    auto &s = slots_[b & mask_];
+    entry   = {s.th.load(std::memory_order_relaxed), s.deleter.load(std::memory_order_relaxed)};
+    if (t < b) return true;
+
+    // 最后一个任务，与窃取者竞争
+    auto const won =
+        top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    bottom_.store(b + 1, std::memory_order_relaxed);
+    return won;
+}
+
+bool thread_pool::worker::deque::steal(task_entry &entry) noexcept {
+    auto t = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto const b = bottom_.load(std::memory_order_acquire);
+    if (t >= b) return false;
+
+    // 所有者压入时不会覆盖未被取走的槽位，抢占成功时读到的任务有效
+    auto &s = slots_[t & mask_];
+    task_entry const e{s.th.load(std::memory_order_relaxed),
+                       s.deleter.load(std::memory_order_relaxed)};
+    if (!top_.compare_exchange_strong(
+            t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+        return false;
+    }
+
+    entry = e;
+    return true;
+}
+
+size_t thread_pool::worker::deque::size() const noexcept {
+    auto const t = top_.load(std::memory_order_acquire);
+    auto const b = bottom_.load(std::memory_order_acquire);
+    return b > t ? static_cast<size_t>(b - t) : 0;
+}
+
+thread_pool::thread_pool() : thread_pool{options{}} {}
+
+thread_pool::thread_pool(const options &opts) : opts_{opts}, injector_{opts.queue_capacity} {
+    if (opts_.thread_count == 0) {
+        opts_.thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // 先创建全部工作线程对象，窃取时会遍历它们
+    for (size_t i = 0; i < opts_.thread_count; ++i) {
+        workers_.emplace_back(
+            std::make_unique<worker>(*this, opts_.deque_capacity, 0x9e3779b97f4a7c15ULL * (i + 1)));
+    }
+
+    try {
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            auto &w  = *workers_[i];
+            w.thread = std::thread{[this, &w] { worker_routine(w); }};
+            opts_.placement.apply(w.thread, i);
+        }
+    } catch (...) {
+        stop();
+        join();
+        throw;
+    }
+}
+
+thread_pool::~thread_pool() {
+    stop();
+    join();
+
+    // 释放未执行的任务
+    task_entry entry;
+    for (auto &w : workers_) {
+        while (w->tasks.take(entry)) entry.deleter(entry.th);
+    }
+    while (injector_.try_pop(entry)) entry.deleter(entry.th);
+}
+
+bool thread_pool::push(task *th, deleter_type deleter) {
+    if (stopped_.load(std::memory_order_relaxed)) return false;
+
+    // 工作线程内提交的任务压入自己的队列，满时溢出到注入队列
+    task_entry const entry{th, deleter};
+    auto const       self = current_;
+    if (!(self && &self->pool == this && self->tasks.push(entry)) && !injector_.try_push(entry)) {
+        return false;
+    }
+
+    idle_.notify_one();
+    return true;
+}
+
+bool thread_pool::push_for(task *th, deleter_type deleter, std::chrono::nanoseconds timeout) {
+    if (stopped_.load(std::memory_order_relaxed)) return false;
+
+    // 工作线程内不等待，否则全部工作线程都在等待时没有线程取任务
+    auto const self = current_;
+    if (self && &self->pool == this) return push(th, deleter);
+
+    if (!injector_.push_for(timeout, task_entry{th, deleter})) return false;
+
+    idle_.notify_one();
+    return true;
+}
+
+void thread_pool::stop() noexcept {
+    stopped_.store(true, std::memory_order_release);
+    idle_.notify_all();
+}
+
+void thread_pool::join() {
+    for (auto &w : workers_) {
+        if (w->thread.joinable()) w->thread.join();
+    }
+}
+
+size_t thread_pool::get_thread_count() const noexcept { return workers_.size(); }
+
+size_t thread_pool::get_processed_task_num() const noexcept {
+    size_t n = 0;
+    for (auto &w : workers_) n += w->processed.load(std::memory_order_relaxed);
+    return n;
+}
+
+size_t thread_pool::get_current_task_num() const noexcept {
+    auto n = injector_.size();
+    for (auto &w : workers_) n += w->tasks.size();
+    return n;
+}
+
+void thread_pool::worker_routine(worker &self) {
+    current_ = &self;
+
+    task_entry entry;
+    while (!stopped_.load(std::memory_order_acquire)) {
+        // 短暂自旋，新任务往往很快到来，免去休眠与唤醒的系统调用
+        auto found = find_task(self, entry);
+        for (int i = 0; !found && i < opts_.spin_count; ++i) {
+            cpu_relax();
+            found = find_task(self, entry);
+        }
+
+        if (!found) {
+            // 登记后再检查一次，提交方要么看到登记，要么任务能被找到
+            auto const key = idle_.prepare_wait();
+            if (stopped_.load(std::memory_order_acquire)) {
+                idle_.cancel_wait();
+                break;
+            }
+
+            if (!find_task(self, entry)) {
+                idle_.wait(key);
+                continue;
+            }
+
+            idle_.cancel_wait();
+        }
+
+        run(self, entry);
+    }
+
+    current_ = nullptr;
+}
+
+bool thread_pool::find_task(worker &self, task_entry &entry) {
+    // 定期优先检查注入队列，避免本地任务源源不断时外部提交的任务饿死
+    if (++self.tick % 61 == 0 && injector_.try_pop(entry)) return true;
+    return self.tasks.take(entry) || injector_.try_pop(entry) || steal(self, entry);
+}
+
+bool thread_pool::steal(worker &self, task_entry &entry) {
+    auto const n = workers_.size();
+    if (n < 2) return false;
+
+    // xorshift 挑选起点，避免所有空闲线程争抢同一个工作线程
+    self.rng ^= self.rng << 13;
+    self.rng ^= self.rng >> 7;
+    self.rng ^= self.rng << 17;
+    auto const start = static_cast<size_t>(self.rng % n);
+    for (size_t i = 0; i < n; ++i) {
+        auto &victim = *workers_[(start + i) % n];
+        if (&victim != &self && victim.tasks.steal(entry)) return true;
+    }
+
+    return false;
+}
+
+void thread_pool::run(worker &self, const task_entry &entry) {
+    auto const fin = entry.th->run(*this);
+    entry.deleter(entry.th);
+    self.processed.store(self.processed.load(std::memory_order_relaxed) + 1,
+                         std::memory_order_relaxed);
+
+    if (!fin) stop();
+}
+
+}  // namespace flyzero
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "cpu_topology.h"
+#include "futex.h"
+#include "mpmc_queue.h"
+
+namespace flyzero {
+
+/**
+ * @brief 工作窃取线程池
+ *
+ * 每个工作线程持有一个 Chase-Lev 双端队列，工作线程内提交的任务压入自己的队列并以后进先出执行，
+ * 其他线程提交的任务进入全局注入队列。工作线程依次从自己的队列、注入队列取任务，
+ * 都为空时随机挑选其他工作线程窃取；全都没有任务时短暂自旋后休眠，提交任务时只在有线程休眠时才唤醒。
+ */
+class thread_pool {
+public:
+    /**
+     * @brief 任务，与 task_queue_thread::task 结构相同，但 run 的参数为线程池，两者不能互换
+     *
+     * task_queue_thread::task 的派生类迁移时：
+     * - 基类改为 thread_pool::task，run 的参数改为 thread_pool &，run 中向原线程提交后续任务的调用改为 pool.push；
+     * - push(task *, deleter) 的约定不变，删除器在任务执行后或线程池析构时调用，提交失败时任务仍归调用者；
+     * - run 返回 false 时停止整个线程池而不只是一个线程，只为结束单个任务的派生类应改为返回 true。
+     */
+    class task {
+    public:
+        task(void)          = default;
+        virtual ~task(void) = default;
+
+        /**
+         * @brief 执行任务
+         * @return 返回 false 时停止线程池，与 task_queue_thread 中停止线程的约定一致
+         */
+        virtual bool run(thread_pool &pool) = 0;
+    };
+
+    using deleter_type = void (*)(task *);
+
+    /**
+     * @brief 配置选项
+     */
+    struct options {
+        size_t thread_count{0};        ///< 工作线程数，为 0 时取 std::thread::hardware_concurrency()
+        size_t queue_capacity{4096};   ///< 全局注入队列容量
+        size_t deque_capacity{1024};   ///< 每个工作线程的双端队列容量，满时溢出到注入队列
+        int    spin_count{64};         ///< 没有任务时休眠前的自旋轮数
+        thread_placement placement;    ///< 工作线程的放置策略，第 i 个工作线程按序号 i 放置
+    };
+
+    /**
+     * @brief 以默认选项构造，每个 CPU 一个工作线程
+     */
+    thread_pool();
+
+    /**
+     * @brief 构造函数，启动全部工作线程
+     */
+    explicit thread_pool(const options &opts);
+
+    /**
+     * @brief 禁止拷贝
+     */
+    thread_pool(const thread_pool &) = delete;
+
+    /**
+     * @brief 禁止拷贝
+     */
+    thread_pool &operator=(const thread_pool &) = delete;
+
+    /**
+     * @brief 析构函数，停止并等待全部工作线程，未执行的任务以各自的删除器释放
+     */
+    ~thread_pool();
+
+    /**
+     * @brief 提交任务，可在任意线程调用，不阻塞
+     *
+     * 外部线程提交的任务进入容量为 options::queue_capacity 的注入队列，队列满时立即返回 false，
+     * 由调用者决定重试、丢弃或改用 push_for 等待，线程池不会替调用者缓存任务。
+     *
+     * @param th 任务
+     * @param deleter 任务执行完毕后调用的删除器
+     * @return 队列已满或线程池已停止时返回 false，任务所有权仍归调用者
+     */
+    bool push(task *th, deleter_type deleter);
+
+    /**
+     * @brief 提交任务，注入队列已满时先自旋再休眠，至多等待 timeout 直到工作线程取走任务腾出空间
+     *
+     * 在本线程池的工作线程内调用时不等待，与 push 相同，以免全部工作线程互相等待。
+     * 等待期间线程池停止时不再有线程取任务，超时后返回 false；停止前已写入的任务在析构时以删除器释放。
+     *
+     * @param th 任务
+     * @param deleter 任务执行完毕后调用的删除器
+     * @param timeout 最长等待时间
+     * @return 超时或线程池已停止时返回 false，任务所有权仍归调用者
+     */
+    bool push_for(task *th, deleter_type deleter, std::chrono::nanoseconds timeout);
+
+    /**
+     * @brief 请求停止，工作线程执行完手头的任务后退出
+     */
+    void stop() noexcept;
+
+    /**
+     * @brief 等待全部工作线程退出，不能在工作线程内调用
+     */
+    void join();
+
+    /**
+     * @brief 工作线程数
+     */
+    size_t get_thread_count() const noexcept;
+
+    /**
+     * @brief 已执行的任务数
+     */
+    size_t get_processed_task_num() const noexcept;
+
+    /**
+     * @brief 尚未执行的任务数，近似值
+     */
+    size_t get_current_task_num() const noexcept;
+
+private:
+    /**
+     * @brief 任务及其删除器
+     */
+    struct task_entry {
+        task        *th;
+        deleter_type deleter;
+    };
+
+    struct worker;
+
+    /**
+     * @brief 工作线程主循环
+     */
+    void worker_routine(worker &self);
+
+    /**
+     * @brief 依次从自己的队列、注入队列和其他工作线程取任务
+     */
+    bool find_task(worker &self, task_entry &entry);
+
+    /**
+     * @brief 从随机挑选的其他工作线程窃取任务
+     */
+    bool steal(worker &self, task_entry &entry);
+
+    /**
+     * @brief 执行并释放任务
+     */
+    void run(worker &self, const task_entry &entry);
+
+    static thread_local worker *current_;  ///< 当前线程所属的工作线程，非工作线程为空
+
+    options                              opts_;           ///< 配置选项
+    mpmc_queue<task_entry>               injector_;       ///< 全局注入队列
+    std::vector<std::unique_ptr<worker>> workers_;        ///< 工作线程
+    event_count                          idle_;           ///< 空闲工作线程在此休眠
+    std::atomic<bool>                    stopped_{false}; ///< 是否已请求停止
+};
+
+}  // namespace flyzero
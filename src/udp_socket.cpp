@@ -0,0 +1,220 @@
+#include "udp_socket.h"
+
+#include <netinet/udp.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "utility.h"
+
+namespace flyzero {
+
+udp_socket::udp_socket(file_descriptor &&sock, const options &opts)
+    : event_dispatch::io_listener{std::move(sock)},
+      opts_{opts},
+      rx_slots_{new char[opts.batch_size * opts.slot_size]},
+      tx_slots_{new char[opts.batch_size * opts.slot_size]},
+      rx_msgs_(opts.batch_size),
+      tx_msgs_(opts.batch_size),
+      rx_iovs_(opts.batch_size),
+      tx_iovs_(opts.batch_size),
+      rx_addrs_(opts.batch_size),
+      tx_addrs_(opts.batch_size),
+      rx_ctrls_(opts.batch_size),
+      tx_ctrls_(opts.batch_size) {
+#ifdef UDP_GRO
+    // 启用 GRO，内核不支持时退化为逐个接收
+    int const on = 1;
+    gro_ = opts.gro && ::setsockopt(fd(), SOL_UDP, UDP_GRO, &on, sizeof on) == 0;
+#endif
+
+    // 预先建立消息头与接收槽、地址、控制消息之间的关联
+    for (size_t i = 0; i < opts.batch_size; ++i) {
+        rx_iovs_[i].iov_base = rx_slots_.get() + i * opts.slot_size;
+        rx_iovs_[i].iov_len  = opts.slot_size;
+
+        auto &rx             = rx_msgs_[i].msg_hdr;
+        rx.msg_name          = &rx_addrs_[i];
+        rx.msg_iov           = &rx_iovs_[i];
+        rx.msg_iovlen        = 1;
+        rx.msg_control       = rx_ctrls_[i].data;
+        reset_rx_slot(i);
+
+        tx_iovs_[i].iov_base = tx_slots_.get() + i * opts.slot_size;
+
+        auto &tx             = tx_msgs_[i].msg_hdr;
+        tx.msg_name          = &tx_addrs_[i];
+        tx.msg_iov           = &tx_iovs_[i];
+        tx.msg_iovlen        = 1;
+    }
+}
+
+bool udp_socket::enqueue(const void     *data,
+                         size_t          size,
+                         uint16_t        segment_size,
+                         const sockaddr *addr,
+                         socklen_t       addrlen) {
+    if (size > opts_.slot_size || addrlen > sizeof(sockaddr_storage)) [[unlikely]] {
+        return false;
+    }
+
+    // 发送队列已满，先尝试发送
+    if (tx_tail_ == opts_.batch_size) [[unlikely]] {
+        flush();
+        if (tx_tail_ == opts_.batch_size) return false;
+    }
+
+    auto const i = tx_tail_++;
+    std::memcpy(tx_iovs_[i].iov_base, data, size);
+    tx_iovs_[i].iov_len = size;
+    std::memcpy(&tx_addrs_[i], addr, addrlen);
+
+    auto &tx       = tx_msgs_[i].msg_hdr;
+    tx.msg_namelen = addrlen;
+    if (segment_size > 0 && segment_size < size) {
+#ifdef UDP_SEGMENT
+        // 通过控制消息指定 GSO 分段大小
+        tx.msg_control    = tx_ctrls_[i].data;
+        tx.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+        auto const cmsg   = CMSG_FIRSTHDR(&tx);
+        cmsg->cmsg_level  = SOL_UDP;
+        cmsg->cmsg_type   = UDP_SEGMENT;
+        cmsg->cmsg_len    = CMSG_LEN(sizeof(uint16_t));
+        std::memcpy(CMSG_DATA(cmsg), &segment_size, sizeof segment_size);
+#else
+        --tx_tail_;
+        return false;
+#endif
+    } else {
+        tx.msg_control    = nullptr;
+        tx.msg_controllen = 0;
+    }
+
+    return true;
+}
+
+size_t udp_socket::flush() {
+    size_t sent = 0;
+    while (tx_head_ < tx_tail_) {
+        auto const n = ::sendmmsg(fd(), &tx_msgs_[tx_head_], tx_tail_ - tx_head_, 0);
+        if (n > 0) [[likely]] {
+            tx_head_ += n;
+            sent += n;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // 等待可写事件后继续发送
+            break;
+        } else if (errno != EINTR) {
+            // 队首报文发送失败（如 EMSGSIZE、ECONNREFUSED），丢弃后继续
+            ++tx_head_;
+        }
+    }
+
+    if (tx_head_ == tx_tail_) {
+        tx_head_ = 0;
+        tx_tail_ = 0;
+    }
+
+    return sent;
+}
+
+void udp_socket::on_read() {
+    auto const batch = rx_msgs_.size();
+    while (true) {
+        auto const n = ::recvmmsg(fd(), rx_msgs_.data(), batch, 0, nullptr);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) [[likely]] {
+                return;
+            } else if (errno == EINTR || errno == ECONNREFUSED) {
+                continue;
+            }
+
+            throw utility::system_error(errno,
+                                        "recvmmsg(%d, %p, %zu, 0, nullptr) failed: %s",
+                                        fd(),
+                                        rx_msgs_.data(),
+                                        batch,
+                                        std::strerror(errno));
+        }
+
+        for (int i = 0; i < n; ++i) {
+            auto const &msg  = rx_msgs_[i];
+            auto const  data = static_cast<const char *>(rx_iovs_[i].iov_base);
+            size_t      size = msg.msg_len;
+
+            // GRO 合并的报文携带分段大小，按分段拆分后回调
+            size_t segment_size = size;
+#ifdef UDP_GRO
+            if (gro_) {
+                for (auto cmsg = CMSG_FIRSTHDR(&msg.msg_hdr); cmsg;
+                     cmsg      = CMSG_NXTHDR(const_cast<msghdr *>(&msg.msg_hdr), cmsg)) {
+                    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                        int gso_size;
+                        std::memcpy(&gso_size, CMSG_DATA(cmsg), sizeof gso_size);
+                        if (gso_size > 0) segment_size = gso_size;
+                    }
+                }
+            }
+#endif
+
+            size_t off = 0;
+            do {
+                auto const len = std::min(segment_size, size - off);
+                on_datagram(datagram{data + off, len, rx_addrs_[i]});
+                off += len;
+            } while (off < size);
+
+            reset_rx_slot(i);
+        }
+
+        on_batch_end();
+
+        // 未填满一批，接收队列已空
+        if (static_cast<size_t>(n) < batch) return;
+    }
+}
+
+void udp_socket::on_write() { flush(); }
+
+void udp_socket::reset_rx_slot(size_t i) noexcept {
+    auto &rx          = rx_msgs_[i].msg_hdr;
+    rx.msg_namelen    = sizeof(sockaddr_storage);
+    rx.msg_controllen = gro_ ? sizeof(control_buffer) : 0;
+    rx.msg_flags      = 0;
+}
+
+int udp_socket::bind(in_addr_t ip, uint16_t port) {
+    // 创建套接字
+    file_descriptor sock(::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0));
+    if (!sock) return -1;
+
+    // 绑定地址
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(ip);
+    addr.sin_port        = htons(port);
+
+    auto const err = ::bind(sock.get(), reinterpret_cast<sockaddr *>(&addr), sizeof addr);
+    if (err != 0) return -1;
+
+    return sock.release();
+}
+
+int udp_socket::bind(const in6_addr &ip, uint16_t port) {
+    // 创建套接字
+    file_descriptor sock(::socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK, 0));
+    if (!sock) return -1;
+
+    // 绑定地址
+    sockaddr_in6 addr{};
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr   = ip;
+    addr.sin6_port   = htons(port);
+
+    auto const err = ::bind(sock.get(), reinterpret_cast<sockaddr *>(&addr), sizeof addr);
+    if (err != 0) return -1;
+
+    return sock.release();
+}
+
+}  // namespace flyzero
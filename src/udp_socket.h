@@ -0,0 +1,293 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "event_dispatch.h"
+#include "file_descriptor.h"
+#include "ipv4_addr.h"
+#include "ipv6_addr.h"
+
+namespace flyzero {
+
+class udp_socket : public event_dispatch::io_listener {
+public:
+    /**
+     * @brief 配置选项
+     */
+    struct options {
+        size_t batch_size{32};    ///< 单次 recvmmsg/sendmmsg 处理的最大报文数
+        size_t slot_size{2048};   ///< 每个收发槽的大小，启用 GRO/GSO 时建议设为 65536
+        bool   gro{false};        ///< 是否启用 UDP_GRO，内核不支持时自动关闭
+    };
+
+    /**
+     * @brief 接收到的报文，数据与地址均直接引用接收槽，仅在 on_datagram 回调期间有效
+     */
+    class datagram {
+    public:
+        datagram(const void *data, size_t size, const sockaddr_storage &addr) noexcept;
+
+        /**
+         * @brief 报文数据
+         */
+        const void *data() const noexcept;
+
+        /**
+         * @brief 报文长度
+         */
+        size_t size() const noexcept;
+
+        /**
+         * @brief 发送方地址族，AF_INET 或 AF_INET6
+         */
+        sa_family_t family() const noexcept;
+
+        /**
+         * @brief 发送方 IPv4 地址，仅当 family() == AF_INET 时有效
+         */
+        const ipv4_addr &ipv4() const noexcept;
+
+        /**
+         * @brief 发送方 IPv6 地址，仅当 family() == AF_INET6 时有效
+         */
+        const ipv6_addr &ipv6() const noexcept;
+
+        /**
+         * @brief 发送方端口，主机字节序
+         */
+        uint16_t port() const noexcept;
+
+        /**
+         * @brief 发送方原始地址
+         */
+        const sockaddr_storage &addr() const noexcept;
+
+        /**
+         * @brief 发送方原始地址长度
+         */
+        socklen_t addrlen() const noexcept;
+
+    private:
+        const void             *data_;  ///< 报文数据
+        size_t                  size_;  ///< 报文长度
+        const sockaddr_storage *addr_;  ///< 发送方地址
+    };
+
+    /**
+     * @brief 构造函数
+     *
+     * @param sock 已绑定的非阻塞 UDP 套接字
+     * @param opts 配置选项
+     */
+    udp_socket(int sock, const options &opts);
+
+    /**
+     * @brief 构造函数
+     *
+     * @param sock 已绑定的非阻塞 UDP 套接字
+     * @param opts 配置选项
+     */
+    udp_socket(file_descriptor &&sock, const options &opts);
+
+    /**
+     * @brief 禁止拷贝
+     */
+    udp_socket(const udp_socket &) = delete;
+
+    /**
+     * @brief 移动构造函数
+     */
+    udp_socket(udp_socket &&) = default;
+
+    /**
+     * @brief 析构函数
+     */
+    ~udp_socket() override = default;
+
+    /**
+     * @brief 禁止拷贝
+     */
+    void operator=(const udp_socket &) = delete;
+
+    /**
+     * @brief 移动赋值
+     */
+    udp_socket &operator=(udp_socket &&) = default;
+
+    /**
+     * @brief 将报文放入发送队列，队列满时先尝试 flush
+     *
+     * @param data 报文数据
+     * @param size 报文长度，不能超过 slot_size
+     * @param addr 目的地址
+     * @param addrlen 目的地址长度
+     * @return 成功入队时返回 true；报文过长或发送队列仍满时返回 false
+     */
+    bool send(const void *data, size_t size, const sockaddr *addr, socklen_t addrlen);
+
+    /**
+     * @brief 将一段数据按 segment_size 切分为多个报文，通过 UDP_SEGMENT 一次交给内核
+     *
+     * @param data 数据
+     * @param size 数据长度，不能超过 slot_size
+     * @param segment_size 每个报文的长度，最后一个报文可以更短
+     * @param addr 目的地址
+     * @param addrlen 目的地址长度
+     * @return 成功入队时返回 true；报文过长或发送队列仍满时返回 false
+     */
+    bool send(const void     *data,
+              size_t          size,
+              uint16_t        segment_size,
+              const sockaddr *addr,
+              socklen_t       addrlen);
+
+    /**
+     * @brief 通过 sendmmsg 发送队列中的报文
+     *
+     * @return 本次发送的报文数
+     */
+    size_t flush();
+
+    /**
+     * @brief 发送队列中待发送的报文数
+     */
+    size_t pending() const noexcept;
+
+    /**
+     * @brief 是否已启用 UDP_GRO
+     */
+    bool gro_enabled() const noexcept;
+
+    /**
+     * @brief 创建绑定到指定 IPv4 地址和端口的非阻塞 UDP 套接字
+     */
+    static int bind(in_addr_t ip, uint16_t port);
+
+    /**
+     * @brief 创建绑定到指定 IPv6 地址和端口的非阻塞 UDP 套接字
+     */
+    static int bind(const in6_addr &ip, uint16_t port);
+
+protected:
+    /**
+     * @brief 报文处理函数，GRO 合并的报文会被拆分后逐个回调
+     */
+    virtual void on_datagram(const datagram &dgram) = 0;
+
+    /**
+     * @brief 一批报文处理完成后的回调，可在此 flush 回复
+     */
+    virtual void on_batch_end() {}
+
+private:
+    /**
+     * @brief 接收数据
+     */
+    void on_read() override final;
+
+    /**
+     * @brief 发送队列可写
+     */
+    void on_write() override final;
+
+    /**
+     * @brief 入队一个发送报文
+     */
+    bool enqueue(const void     *data,
+                 size_t          size,
+                 uint16_t        segment_size,
+                 const sockaddr *addr,
+                 socklen_t       addrlen);
+
+    /**
+     * @brief 重置接收槽的地址与控制消息长度
+     */
+    void reset_rx_slot(size_t i) noexcept;
+
+    /**
+     * @brief 控制消息缓冲区，足以容纳 UDP_GRO/UDP_SEGMENT
+     */
+    struct control_buffer {
+        alignas(cmsghdr) char data[CMSG_SPACE(sizeof(int))];
+    };
+
+    options                          opts_;        ///< 配置选项
+    bool                             gro_{false};  ///< 是否已启用 GRO
+    std::unique_ptr<char[]>          rx_slots_;    ///< 接收槽内存
+    std::unique_ptr<char[]>          tx_slots_;    ///< 发送槽内存
+    std::vector<mmsghdr>             rx_msgs_;     ///< 接收消息头
+    std::vector<mmsghdr>             tx_msgs_;     ///< 发送消息头
+    std::vector<iovec>               rx_iovs_;     ///< 接收 iovec
+    std::vector<iovec>               tx_iovs_;     ///< 发送 iovec
+    std::vector<sockaddr_storage>    rx_addrs_;    ///< 发送方地址
+    std::vector<sockaddr_storage>    tx_addrs_;    ///< 目的地址
+    std::vector<control_buffer>      rx_ctrls_;    ///< 接收控制消息
+    std::vector<control_buffer>      tx_ctrls_;    ///< 发送控制消息
+    size_t                           tx_head_{0};  ///< 发送队列头
+    size_t                           tx_tail_{0};  ///< 发送队列尾
+};
+
+static_assert(sizeof(ipv4_addr) == sizeof(in_addr) && std::is_standard_layout_v<ipv4_addr>,
+              "ipv4_addr must be layout-compatible with in_addr");
+
+static_assert(sizeof(ipv6_addr) == sizeof(in6_addr) && std::is_standard_layout_v<ipv6_addr>,
+              "ipv6_addr must be layout-compatible with in6_addr");
+
+inline udp_socket::datagram::datagram(const void             *data,
+                                      size_t                  size,
+                                      const sockaddr_storage &addr) noexcept
+    : data_{data}, size_{size}, addr_{&addr} {}
+
+inline const void *udp_socket::datagram::data() const noexcept { return data_; }
+
+inline size_t udp_socket::datagram::size() const noexcept { return size_; }
+
+inline sa_family_t udp_socket::datagram::family() const noexcept { return addr_->ss_family; }
+
+inline const ipv4_addr &udp_socket::datagram::ipv4() const noexcept {
+    auto const &sin = *reinterpret_cast<const sockaddr_in *>(addr_);
+    return *reinterpret_cast<const ipv4_addr *>(&sin.sin_addr);
+}
+
+inline const ipv6_addr &udp_socket::datagram::ipv6() const noexcept {
+    auto const &sin6 = *reinterpret_cast<const sockaddr_in6 *>(addr_);
+    return *reinterpret_cast<const ipv6_addr *>(&sin6.sin6_addr);
+}
+
+inline uint16_t udp_socket::datagram::port() const noexcept {
+    return family() == AF_INET6 ? ntohs(reinterpret_cast<const sockaddr_in6 *>(addr_)->sin6_port)
+                                : ntohs(reinterpret_cast<const sockaddr_in *>(addr_)->sin_port);
+}
+
+inline const sockaddr_storage &udp_socket::datagram::addr() const noexcept { return *addr_; }
+
+inline socklen_t udp_socket::datagram::addrlen() const noexcept {
+    return family() == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+}
+
+inline udp_socket::udp_socket(int sock, const options &opts)
+    : udp_socket{file_descriptor(sock), opts} {}
+
+inline bool udp_socket::send(const void *data, size_t size, const sockaddr *addr, socklen_t addrlen) {
+    return enqueue(data, size, 0, addr, addrlen);
+}
+
+inline bool udp_socket::send(const void     *data,
+                             size_t          size,
+                             uint16_t        segment_size,
+                             const sockaddr *addr,
+                             socklen_t       addrlen) {
+    return enqueue(data, size, segment_size, addr, addrlen);
+}
+
+inline size_t udp_socket::pending() const noexcept { return tx_tail_ - tx_head_; }
+
+inline bool udp_socket::gro_enabled() const noexcept { return gro_; }
+
+}  // namespace flyzero
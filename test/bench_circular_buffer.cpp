@@ -0,0 +1,272 @@
+#include <circular_buffer.h>
+#include <histogram.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+using clock_type = std::chrono::steady_clock;
+
+// 缓冲区的内存类型
+struct backing {
+    const char *name;   ///< 名称
+    int         flag;   ///< 创建标志
+    bool        named;  ///< 是否使用 shm_open 命名对象
+};
+
+static backing const backings[] = {
+    {"anonymous", 0, false},
+    {"shm", 0, true},
+    {"memfd", CIRCULAR_BUFFER_MEMFD, false},
+    {"thp", CIRCULAR_BUFFER_MEMFD | CIRCULAR_BUFFER_THP, false},
+    {"hugetlb_2mb", CIRCULAR_BUFFER_HUGE_2MB, false},
+};
+
+// 按内存类型创建缓冲区，不可用时返回空指针
+static circular_buffer *create_ring(const backing &b, size_t capacity) {
+    if (!b.named) return circular_buffer_create(nullptr, capacity, 0, b.flag);
+
+    static unsigned seq  = 0;
+    auto const      name = "/bench_circular_buffer." + std::to_string(::getpid()) + "." +
+                      std::to_string(seq++);
+    return circular_buffer_create(name.c_str(), capacity, 0, b.flag);
+}
+
+// 将当前线程绑定到指定 CPU，CPU 不足时不绑定
+static void pin_to_cpu(unsigned cpu) {
+    if (std::thread::hardware_concurrency() <= cpu) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    ::pthread_setaffinity_np(::pthread_self(), sizeof set, &set);
+}
+
+// 等待对端时先忙等，忙等过久则让出 CPU，单核机器上也能推进
+static void backoff(unsigned &spins) {
+    if (++spins < 1024) {
+        __builtin_ia32_pause();
+    } else {
+        spins = 0;
+        std::this_thread::yield();
+    }
+}
+
+static double seconds_since(clock_type::time_point start) {
+    return std::chrono::duration<double>(clock_type::now() - start).count();
+}
+
+// 输出一条 JSON 结果，结果之间以逗号分隔
+static void emit(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static void emit(const char *fmt, ...) {
+    static bool first = true;
+    std::printf(first ? "  {" : ",\n  {");
+    first = false;
+
+    va_list args;
+    va_start(args, fmt);
+    std::vprintf(fmt, args);
+    va_end(args);
+    std::printf("}");
+}
+
+// 生产者：逐条写入固定长度的消息，每条消息以序号开头
+static void produce(circular_buffer *cb, size_t msg_size, size_t count) {
+    unsigned spins = 0;
+    for (size_t i = 0; i < count; ++i) {
+        auto writable = circular_buffer_get_writable_min(cb, msg_size);
+        while (writable.size < msg_size) {
+            backoff(spins);
+            writable = circular_buffer_get_writable_min(cb, msg_size);
+        }
+
+        std::memset(writable.data, 0, msg_size);
+        std::memcpy(writable.data, &i, sizeof i);
+        circular_buffer_push_data(cb, msg_size);
+    }
+}
+
+// 消费者：逐条读取并校验序号
+static void consume(circular_buffer *cb, size_t msg_size, size_t count) {
+    unsigned spins = 0;
+    for (size_t i = 0; i < count; ++i) {
+        auto readable = circular_buffer_get_readable_min(cb, msg_size);
+        while (readable.size < msg_size) {
+            backoff(spins);
+            readable = circular_buffer_get_readable_min(cb, msg_size);
+        }
+
+        size_t seq;
+        std::memcpy(&seq, readable.data, sizeof seq);
+        if (seq != i) std::abort();
+        circular_buffer_pop_data(cb, msg_size);
+    }
+}
+
+// 单线程 push/pop 的开销，不涉及跨核通信
+static void bench_single_thread(size_t msg_size, size_t count) {
+    auto const cb = circular_buffer_create(nullptr, 64 * 1024, 0, 0);
+    assert(cb);
+
+    auto const start = clock_type::now();
+    for (size_t i = 0; i < count; ++i) {
+        auto const writable = circular_buffer_get_writable(cb);
+        std::memcpy(writable.data, &i, sizeof i);
+        circular_buffer_push_data(cb, msg_size);
+
+        auto const readable = circular_buffer_get_readable(cb);
+        size_t     seq;
+        std::memcpy(&seq, readable.data, sizeof seq);
+        if (seq != i) std::abort();
+        circular_buffer_pop_data(cb, msg_size);
+    }
+    auto const elapsed = seconds_since(start);
+
+    circular_buffer_destroy(cb);
+    emit("\"case\":\"single_thread\",\"msg_size\":%zu,\"ns_per_push_pop\":%.2f",
+         msg_size,
+         elapsed * 1e9 / count);
+}
+
+// 跨线程吞吐：生产者与消费者分别绑定在两个 CPU 上
+static void bench_thread_throughput(const backing &b,
+                                    size_t         capacity,
+                                    size_t         msg_size,
+                                    size_t         total_bytes) {
+    auto const cb = create_ring(b, capacity);
+    if (!cb) return;
+
+    auto const count = total_bytes / msg_size;
+    std::thread consumer{[cb, count, msg_size] {
+        pin_to_cpu(1);
+        consume(cb, msg_size, count);
+    }};
+
+    pin_to_cpu(0);
+    auto const start = clock_type::now();
+    produce(cb, msg_size, count);
+    consumer.join();
+    auto const elapsed = seconds_since(start);
+
+    circular_buffer_destroy(cb);
+    emit("\"case\":\"thread_throughput\",\"backing\":\"%s\",\"capacity\":%zu,\"msg_size\":%zu,"
+         "\"msgs_per_sec\":%.0f,\"mb_per_sec\":%.1f",
+         b.name,
+         capacity,
+         msg_size,
+         count / elapsed,
+         count * msg_size / elapsed / (1024 * 1024));
+}
+
+// 跨进程吞吐：子进程消费，与跨线程的差别在于页表与调度
+static void bench_process_throughput(const backing &b,
+                                     size_t         capacity,
+                                     size_t         msg_size,
+                                     size_t         total_bytes) {
+    auto const cb = create_ring(b, capacity);
+    if (!cb) return;
+
+    auto const count = total_bytes / msg_size;
+    auto const start = clock_type::now();
+    auto const pid   = ::fork();
+    if (pid == 0) {
+        pin_to_cpu(1);
+        consume(cb, msg_size, count);
+        ::_exit(0);
+    }
+
+    pin_to_cpu(0);
+    produce(cb, msg_size, count);
+    int status;
+    ::waitpid(pid, &status, 0);
+    auto const elapsed = seconds_since(start);
+
+    circular_buffer_destroy(cb);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) std::abort();
+    emit("\"case\":\"process_throughput\",\"backing\":\"%s\",\"capacity\":%zu,\"msg_size\":%zu,"
+         "\"msgs_per_sec\":%.0f,\"mb_per_sec\":%.1f",
+         b.name,
+         capacity,
+         msg_size,
+         count / elapsed,
+         count * msg_size / elapsed / (1024 * 1024));
+}
+
+// 往返延迟：两个缓冲区分别承载请求与应答，两端绑定在不同 CPU 上
+static void bench_ping_pong(const backing &b, size_t msg_size, size_t rounds) {
+    auto const ping = create_ring(b, 64 * 1024);
+    if (!ping) return;
+    auto const pong = create_ring(b, 64 * 1024);
+    if (!pong) {
+        circular_buffer_destroy(ping);
+        return;
+    }
+
+    std::thread echo{[ping, pong, msg_size, rounds] {
+        pin_to_cpu(1);
+        for (size_t i = 0; i < rounds; ++i) {
+            consume(ping, msg_size, 1);
+            produce(pong, msg_size, 1);
+        }
+    }};
+
+    pin_to_cpu(0);
+    flyzero::histogram rtt;
+    for (size_t i = 0; i < rounds; ++i) {
+        auto const start = clock_type::now();
+        produce(ping, msg_size, 1);
+        consume(pong, msg_size, 1);
+        rtt.record(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start)
+                       .count());
+    }
+    echo.join();
+
+    circular_buffer_destroy(ping);
+    circular_buffer_destroy(pong);
+    emit("\"case\":\"ping_pong\",\"backing\":\"%s\",\"msg_size\":%zu,\"rounds\":%zu,"
+         "\"rtt_ns_min\":%llu,\"rtt_ns_p50\":%llu,\"rtt_ns_p99\":%llu,\"rtt_ns_max\":%llu",
+         b.name,
+         msg_size,
+         rounds,
+         static_cast<unsigned long long>(rtt.min()),
+         static_cast<unsigned long long>(rtt.percentile(50)),
+         static_cast<unsigned long long>(rtt.percentile(99)),
+         static_cast<unsigned long long>(rtt.max()));
+}
+
+int main(int argc, char *argv[]) {
+    // argv[1]: 每个吞吐用例传输的 MB 数；argv[2]: 往返次数
+    size_t const mb     = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256;
+    size_t const rounds = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+
+    size_t const capacities[] = {64 * 1024, 4 * 1024 * 1024};
+    size_t const msg_sizes[]  = {8, 64, 512, 4096};
+
+    std::printf("[\n");
+
+    for (auto const msg_size : msg_sizes) bench_single_thread(msg_size, mb * 1024 * 1024 / msg_size);
+
+    for (auto const &b : backings) {
+        for (auto const capacity : capacities) {
+            for (auto const msg_size : msg_sizes) {
+                bench_thread_throughput(b, capacity, msg_size, mb * 1024 * 1024);
+                bench_process_throughput(b, capacity, msg_size, mb * 1024 * 1024);
+            }
+        }
+    }
+
+    for (auto const &b : backings) {
+        for (auto const msg_size : {size_t{8}, size_t{512}}) bench_ping_pong(b, msg_size, rounds);
+    }
+
+    std::printf("\n]\n");
+}
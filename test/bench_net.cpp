@@ -0,0 +1,363 @@
+#include <histogram.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <tcp_connection.h>
+#include <tcp_server.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// 回显与请求/应答服务器的网络路径基准测试，结果以 JSON 输出到标准输出
+//
+// 用法：bench_net [每个用例的测量时长（毫秒），默认 200]
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+enum class mode { echo, rpc };
+
+/**
+ * @brief 请求/应答模式的请求头
+ */
+struct rpc_request {
+    uint32_t payload_size;   ///< 请求负载长度
+    uint32_t response_size;  ///< 应答负载长度
+};
+
+constexpr uint32_t const rpc_payload_size = 16;       ///< 请求/应答模式的请求负载长度
+constexpr size_t const   buffer_size      = 1 << 20;  ///< 连接的读写缓冲区大小
+
+uint64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               clock_type::now().time_since_epoch())
+        .count();
+}
+
+void set_nodelay(int sock) {
+    int const on = 1;
+    ::setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+}
+
+/**
+ * @brief 服务端连接
+ */
+class server_connection : public flyzero::tcp_connection {
+public:
+    server_connection(flyzero::file_descriptor &&sock, mode m)
+        : tcp_connection{std::move(sock), buffer_size, buffer_size}, mode_{m} {}
+
+    bool closed() const { return closed_; }
+
+protected:
+    size_t on_read(const void *data, size_t size) override {
+        if (mode_ == mode::echo) return send(data, size);
+
+        // 处理完整的请求，写缓冲区不足时保留剩余请求
+        static char const zeros[65536]{};
+        auto const        p        = static_cast<const char *>(data);
+        size_t            consumed = 0;
+        while (size - consumed >= sizeof(rpc_request)) {
+            rpc_request req;
+            std::memcpy(&req, p + consumed, sizeof req);
+            auto const len = sizeof req + req.payload_size;
+            if (size - consumed < len) break;
+
+            uint32_t const header = req.response_size;
+            if (send(&header, sizeof header) != sizeof header) break;
+            for (uint32_t left = req.response_size; left > 0;) {
+                auto const n = send(zeros, std::min<size_t>(left, sizeof zeros));
+                if (n == 0) {
+                    std::fprintf(stderr, "server write buffer overflow\n");
+                    std::abort();
+                }
+                left -= n;
+            }
+
+            consumed += len;
+        }
+
+        return consumed;
+    }
+
+    size_t on_write(void *, size_t) override { return 0; }
+
+    void on_close() override { closed_ = true; }
+
+private:
+    mode mode_;           ///< 服务模式
+    bool closed_{false};  ///< 是否已关闭
+};
+
+/**
+ * @brief 服务端，关闭的连接在下一轮循环中回收
+ */
+class server : public flyzero::tcp_server, public flyzero::event_dispatch::loop_listener {
+public:
+    server(flyzero::event_dispatch &dispatch, int sock, mode m)
+        : tcp_server{sock}, dispatch_{dispatch}, mode_{m} {
+        dispatch_.register_io_listener(*this, flyzero::event_dispatch::event::read);
+        dispatch_.register_loop_listener(*this);
+    }
+
+    static int listen_tcp() { return tcp_server::listen(INADDR_LOOPBACK, 0); }
+
+    static int listen_unix(const char *path) { return tcp_server::listen(path); }
+
+protected:
+    void on_accept(flyzero::file_descriptor &&sock,
+                   const sockaddr_storage   &addr,
+                   socklen_t) override {
+        if (addr.ss_family == AF_INET) set_nodelay(sock.get());
+        auto conn = std::make_unique<server_connection>(std::move(sock), mode_);
+        dispatch_.register_io_listener(*conn, flyzero::event_dispatch::event::read_write);
+        connections_.push_back(std::move(conn));
+    }
+
+    void on_loop() override {
+        std::erase_if(connections_, [](auto const &conn) { return conn->closed(); });
+    }
+
+private:
+    flyzero::event_dispatch                        &dispatch_;     ///< 事件分发器
+    mode                                            mode_;         ///< 服务模式
+    std::vector<std::unique_ptr<server_connection>> connections_;  ///< 连接
+};
+
+/**
+ * @brief 压测客户端连接，保持 depth 个未完成的请求
+ */
+class client_connection : public flyzero::tcp_connection {
+public:
+    client_connection(flyzero::file_descriptor &&sock, mode m, size_t size, size_t depth)
+        : tcp_connection{std::move(sock), buffer_size, buffer_size},
+          request_(m == mode::echo ? size : sizeof(rpc_request) + rpc_payload_size),
+          response_size_{m == mode::echo ? size : sizeof(uint32_t) + size},
+          send_times_(depth) {
+        if (m == mode::rpc) {
+            rpc_request const req{rpc_payload_size, static_cast<uint32_t>(size)};
+            std::memcpy(request_.data(), &req, sizeof req);
+        }
+    }
+
+    /**
+     * @brief 发出请求直到未完成的请求数达到 depth
+     */
+    void fill() {
+        while (outstanding_ < send_times_.size()) {
+            if (send(request_.data(), request_.size()) != request_.size()) {
+                std::fprintf(stderr, "client write buffer overflow\n");
+                std::abort();
+            }
+            send_times_[(sent_++) % send_times_.size()] = now_ns();
+            ++outstanding_;
+        }
+    }
+
+    /**
+     * @brief 开始统计
+     */
+    void start_measure() {
+        measuring_ = true;
+        completed_ = 0;
+        latency_.reset();
+    }
+
+    void stop_measure() { measuring_ = false; }
+
+    uint64_t completed() const { return completed_; }
+
+    const flyzero::histogram &latency() const { return latency_; }
+
+protected:
+    size_t on_read(const void *, size_t size) override {
+        // 应答长度固定，按字节数统计完成的请求
+        received_ += size;
+        auto const now = now_ns();
+        while (received_ >= response_size_) {
+            received_ -= response_size_;
+            auto const sent = send_times_[(done_++) % send_times_.size()];
+            --outstanding_;
+            if (measuring_) {
+                latency_.record(now - sent);
+                ++completed_;
+            }
+        }
+
+        fill();
+        return size;
+    }
+
+    size_t on_write(void *, size_t) override { return 0; }
+
+    void on_close() override {
+        std::fprintf(stderr, "client connection closed unexpectedly\n");
+        std::abort();
+    }
+
+private:
+    std::vector<char>     request_;           ///< 请求
+    size_t                response_size_;     ///< 应答长度
+    std::vector<uint64_t> send_times_;        ///< 未完成请求的发送时间
+    size_t                sent_{0};           ///< 已发送的请求数
+    size_t                done_{0};           ///< 已完成的请求数
+    size_t                outstanding_{0};    ///< 未完成的请求数
+    size_t                received_{0};       ///< 未凑成完整应答的字节数
+    bool                  measuring_{false};  ///< 是否正在统计
+    uint64_t              completed_{0};      ///< 统计期间完成的请求数
+    flyzero::histogram    latency_;           ///< 请求时延
+};
+
+/**
+ * @brief 测试用例
+ */
+struct bench_case {
+    const char *transport;    ///< 传输方式
+    mode        m;            ///< 服务模式
+    size_t      connections;  ///< 连接数
+    size_t      size;         ///< 消息长度
+    size_t      depth;        ///< 流水线深度
+};
+
+flyzero::file_descriptor connect_to(const sockaddr_storage &addr, socklen_t addrlen) {
+    flyzero::file_descriptor sock{::socket(addr.ss_family, SOCK_STREAM, 0)};
+    if (!sock || ::connect(sock.get(), reinterpret_cast<const sockaddr *>(&addr), addrlen) != 0) {
+        std::perror("connect");
+        std::abort();
+    }
+
+    if (addr.ss_family == AF_INET) set_nodelay(sock.get());
+    sock.set_nonblocking();
+    return sock;
+}
+
+void run_case(const bench_case        &c,
+              const sockaddr_storage  &addr,
+              socklen_t                addrlen,
+              std::chrono::milliseconds duration,
+              bool                     first) {
+    flyzero::event_dispatch                         dispatch;
+    std::vector<std::unique_ptr<client_connection>> clients;
+    for (size_t i = 0; i < c.connections; ++i) {
+        auto conn = std::make_unique<client_connection>(
+            connect_to(addr, addrlen), c.m, c.size, c.depth);
+        dispatch.register_io_listener(*conn, flyzero::event_dispatch::event::read_write);
+        conn->fill();
+        clients.push_back(std::move(conn));
+    }
+
+    // 预热
+    auto run_for = [&](clock_type::duration d) {
+        auto const deadline = clock_type::now() + d;
+        while (clock_type::now() < deadline) dispatch.run_once(std::chrono::milliseconds{1});
+    };
+    run_for(duration / 10);
+
+    // 测量
+    for (auto &conn : clients) conn->start_measure();
+    auto const begin = clock_type::now();
+    run_for(duration);
+    auto const elapsed = std::chrono::duration<double>(clock_type::now() - begin).count();
+    for (auto &conn : clients) conn->stop_measure();
+
+    flyzero::histogram latency;
+    uint64_t           completed = 0;
+    for (auto const &conn : clients) {
+        latency.merge(conn->latency());
+        completed += conn->completed();
+    }
+
+    auto const rps = completed / elapsed;
+    std::printf("%s    {\"transport\": \"%s\", \"mode\": \"%s\", \"connections\": %zu, "
+                "\"message_size\": %zu, \"depth\": %zu, \"requests\": %lu, "
+                "\"duration_s\": %.3f, \"requests_per_sec\": %.0f, \"mb_per_sec\": %.2f, "
+                "\"latency_ns\": {\"p50\": %lu, \"p99\": %lu, \"p999\": %lu, \"max\": %lu}}",
+                first ? "" : ",\n",
+                c.transport,
+                c.m == mode::echo ? "echo" : "rpc",
+                c.connections,
+                c.size,
+                c.depth,
+                completed,
+                elapsed,
+                rps,
+                rps * c.size / (1 << 20),
+                latency.percentile(50),
+                latency.percentile(99),
+                latency.percentile(99.9),
+                latency.max());
+    std::fflush(stdout);
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+    std::chrono::milliseconds const duration{argc > 1 ? std::atoi(argv[1]) : 200};
+    auto const                      unix_path = "/tmp/bench_net.sock";
+    auto const                      rpc_path  = "/tmp/bench_net_rpc.sock";
+
+    // 启动服务端
+    flyzero::event_dispatch server_dispatch;
+    server                  tcp_echo{server_dispatch, server::listen_tcp(), mode::echo};
+    server                  tcp_rpc{server_dispatch, server::listen_tcp(), mode::rpc};
+    server                  unix_echo{server_dispatch, server::listen_unix(unix_path), mode::echo};
+    server                  unix_rpc{server_dispatch, server::listen_unix(rpc_path), mode::rpc};
+
+    std::atomic<bool> stop{false};
+    std::thread       server_thread([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            server_dispatch.run_once(std::chrono::milliseconds{10});
+        }
+    });
+
+    // 服务端地址
+    auto local_addr = [](const flyzero::tcp_server &s, sockaddr_storage &addr) {
+        socklen_t addrlen = sizeof addr;
+        ::getsockname(s.fd(), reinterpret_cast<sockaddr *>(&addr), &addrlen);
+        return addrlen;
+    };
+    sockaddr_storage tcp_addrs[2];
+    socklen_t const  tcp_lens[2] = {local_addr(tcp_echo, tcp_addrs[0]),
+                                    local_addr(tcp_rpc, tcp_addrs[1])};
+    sockaddr_storage unix_addrs[2]{};
+    for (auto i : {0, 1}) {
+        auto &sun      = reinterpret_cast<sockaddr_un &>(unix_addrs[i]);
+        sun.sun_family = AF_UNIX;
+        std::strcpy(sun.sun_path, i == 0 ? unix_path : rpc_path);
+    }
+
+    // 遍历连接数、消息长度与流水线深度
+    std::printf("{\"benchmark\": \"bench_net\", \"results\": [\n");
+    bool first = true;
+    for (auto const transport : {"tcp", "unix"}) {
+        for (auto const m : {mode::echo, mode::rpc}) {
+            for (size_t connections : {1, 8, 64}) {
+                for (size_t size : {64, 1024, 16384}) {
+                    for (size_t depth : {1, 16}) {
+                        bench_case const c{transport, m, connections, size, depth};
+                        auto const       i = m == mode::echo ? 0 : 1;
+                        if (std::strcmp(transport, "tcp") == 0) {
+                            run_case(c, tcp_addrs[i], tcp_lens[i], duration, first);
+                        } else {
+                            run_case(c, unix_addrs[i], sizeof(sockaddr_un), duration, first);
+                        }
+                        first = false;
+                    }
+                }
+            }
+        }
+    }
+    std::printf("\n]}\n");
+
+    stop = true;
+    server_thread.join();
+    ::unlink(unix_path);
+    ::unlink(rpc_path);
+}
@@ -0,0 +1,81 @@
+#include <parallel.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+using clock_type = std::chrono::steady_clock;
+using flyzero::thread_pool;
+
+// 取 3 次中最短的耗时，单位秒
+template <typename F>
+static double measure(F &&f) {
+    auto best = 1e30;
+    for (int i = 0; i < 3; ++i) {
+        auto const start = clock_type::now();
+        f();
+        best = std::min(best, std::chrono::duration<double>(clock_type::now() - start).count());
+    }
+    return best;
+}
+
+int main(int argc, char *argv[]) {
+    // argv[1]: 元素数；argv[2]: 最多的工作线程数，默认为 CPU 数
+    size_t const n       = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+    size_t const threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10)
+                                    : std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<double> data(n);
+    std::mt19937_64     rng{42};
+    for (auto &x : data) x = static_cast<double>(rng() % 1000000);
+
+    std::printf("[\n");
+    for (size_t t = 1; t <= threads; t *= 2) {
+        // 调用线程也参与执行，参与的线程数为 t + 1
+        thread_pool::options opts;
+        opts.thread_count = t;
+        opts.placement    = flyzero::thread_placement::spread();
+        thread_pool pool{opts};
+
+        std::vector<double> out(n);
+        auto const          for_s = measure([&] {
+            flyzero::parallel_for(
+                pool, 0, n,
+                [&](size_t lo, size_t hi) {
+                    for (auto i = lo; i < hi; ++i) out[i] = std::sqrt(data[i]) * std::log1p(data[i]);
+                },
+                4096);
+        });
+
+        auto const reduce_s = measure([&] {
+            volatile double sum = flyzero::parallel_reduce(
+                pool, 0, n, 0.0,
+                [&](size_t lo, size_t hi, double init) {
+                    for (auto i = lo; i < hi; ++i) init += data[i];
+                    return init;
+                },
+                [](double a, double b) { return a + b; },
+                4096);
+            (void)sum;
+        });
+
+        auto const sort_s = measure([&] {
+            auto v = data;
+            flyzero::parallel_sort(pool, v.begin(), v.end());
+        });
+
+        std::printf("%s  {\"workers\":%zu,\"elements\":%zu,\"for_ms\":%.2f,\"reduce_ms\":%.2f,"
+                    "\"sort_ms\":%.2f}",
+                    t == 1 ? "" : ",\n",
+                    t,
+                    n,
+                    for_s * 1e3,
+                    reduce_s * 1e3,
+                    sort_s * 1e3);
+    }
+    std::printf("\n]\n");
+}
@@ -0,0 +1,286 @@
+#include <histogram.h>
+#include <priority_task_queue_thread.h>
+#include <pthread.h>
+#include <sched.h>
+#include <small_task.h>
+#include <spsc_queue.h>
+#include <task_queue_thread.h>
+#include <thread_pool.h>
+
+#include <array>
+#include <atomic>
+#include <boost/interprocess/sync/interprocess_semaphore.hpp>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+using clock_type = std::chrono::steady_clock;
+using flyzero::task_queue_thread;
+
+// 原来的唤醒方式：队列长度变为 1 时 post 信号量，队列为空时 wait，作为对照
+class semaphore_thread : public std::thread {
+public:
+    explicit semaphore_thread(size_t capacity) : queue_{capacity}, sema_{0} {
+        this->std::thread::operator=(std::thread{[this] { routine(); }});
+    }
+
+    template <typename F>
+    bool push(F &&f) {
+        if (!queue_.try_push(
+                [f = std::forward<F>(f)]() mutable { return call(f); }, alloc_, dealloc_)) {
+            return false;
+        }
+
+        if (queue_.size() == 1) sema_.post();
+        return true;
+    }
+
+    size_t get_processed_task_num() const { return processed_.load(std::memory_order_relaxed); }
+
+private:
+    using function = flyzero::small_task<bool()>;
+
+    template <typename F>
+    static bool call(F &f) {
+        if constexpr (std::is_void_v<std::invoke_result_t<F &>>) {
+            f();
+            return true;
+        } else {
+            return f();
+        }
+    }
+
+    void routine() {
+        std::array<function, 32> batch;
+        for (;;) {
+            auto const n = queue_.try_pop_n(batch.begin(), batch.size());
+            if (n == 0) {
+                sema_.wait();
+                continue;
+            }
+
+            for (size_t i = 0; i < n; ++i) {
+                auto const fin = batch[i]();
+                batch[i].reset();
+                processed_.store(processed_.load(std::memory_order_relaxed) + 1,
+                                 std::memory_order_relaxed);
+                if (!fin) return;
+            }
+        }
+    }
+
+    function::allocator_type                    alloc_{malloc};
+    function::deallocator_type                  dealloc_{free};
+    flyzero::spsc_queue<function>               queue_;
+    std::atomic<size_t>                         processed_{0};
+    boost::interprocess::interprocess_semaphore sema_;
+};
+
+// 开启统计的 task_queue_thread，衡量统计的开销
+class metrics_thread : public task_queue_thread {
+public:
+    explicit metrics_thread(size_t capacity) : task_queue_thread{capacity} { enable_metrics(true); }
+};
+
+// 单工作线程的 thread_pool，每个任务单独分配
+class pool_thread {
+public:
+    explicit pool_thread(size_t capacity) : pool_{make_options(capacity)} {}
+
+    template <typename F>
+    bool push(F &&f) {
+        auto const th = new callable<std::decay_t<F>>{std::forward<F>(f)};
+        if (pool_.push(th, destroy)) return true;
+
+        delete th;
+        return false;
+    }
+
+    size_t get_processed_task_num() const { return pool_.get_processed_task_num(); }
+
+    void join() { pool_.join(); }
+
+private:
+    template <typename F>
+    class callable : public flyzero::thread_pool::task {
+    public:
+        explicit callable(F f) : f_{std::move(f)} {}
+
+        bool run(flyzero::thread_pool &) override {
+            if constexpr (std::is_void_v<std::invoke_result_t<F &>>) {
+                f_();
+                return true;
+            } else {
+                return f_();
+            }
+        }
+
+    private:
+        F f_;
+    };
+
+    static void destroy(flyzero::thread_pool::task *th) { delete th; }
+
+    static flyzero::thread_pool::options make_options(size_t capacity) {
+        flyzero::thread_pool::options opts;
+        opts.thread_count   = 1;
+        opts.queue_capacity = capacity;
+        if (std::thread::hardware_concurrency() > 1) {
+            opts.placement = flyzero::thread_placement::pin({1});
+        }
+        return opts;
+    }
+
+    flyzero::thread_pool pool_;
+};
+
+// 只有一个优先级的 priority_task_queue_thread
+class priority_thread : public flyzero::priority_task_queue_thread {
+public:
+    explicit priority_thread(size_t capacity) : priority_task_queue_thread{make_options(capacity)} {}
+
+    template <typename F>
+    bool push(F &&f) {
+        return priority_task_queue_thread::push(0, std::forward<F>(f));
+    }
+
+    size_t get_processed_task_num() const { return priority_task_queue_thread::get_processed_task_num(0); }
+
+private:
+    static options make_options(size_t capacity) {
+        options opts;
+        opts.weights        = {1};
+        opts.queue_capacity = capacity;
+        return opts;
+    }
+};
+
+// 将线程绑定到指定 CPU，CPU 不足时不绑定
+static void pin_to_cpu(pthread_t thread, unsigned cpu) {
+    if (std::thread::hardware_concurrency() <= cpu) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    ::pthread_setaffinity_np(thread, sizeof set, &set);
+}
+
+// 等待工作线程执行完 n 个任务，忙等过久则让出 CPU，单核机器上也能推进
+template <typename Thread>
+static void wait_processed(const Thread &thread, size_t n) {
+    for (unsigned spins = 0; thread.get_processed_task_num() < n;) {
+        if (++spins < 1024) {
+            __builtin_ia32_pause();
+        } else {
+            spins = 0;
+            std::this_thread::yield();
+        }
+    }
+}
+
+// 工作线程绑定到 CPU 1，提交线程绑定到 CPU 0；线程池在构造时已绑定
+template <typename Thread>
+static void place(Thread &thread) {
+    if constexpr (!std::is_same_v<Thread, pool_thread>) pin_to_cpu(thread.native_handle(), 1);
+    pin_to_cpu(::pthread_self(), 0);
+}
+
+template <typename Thread, typename F>
+static void push_until_accepted(Thread &thread, F &&f) {
+    while (!thread.push(f)) std::this_thread::yield();
+}
+
+// 输出一条 JSON 结果，结果之间以逗号分隔
+static void emit(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static void emit(const char *fmt, ...) {
+    static bool first = true;
+    std::printf(first ? "  {" : ",\n  {");
+    first = false;
+
+    va_list args;
+    va_start(args, fmt);
+    std::vprintf(fmt, args);
+    va_end(args);
+    std::printf("}");
+}
+
+// 连续提交空任务，测量吞吐
+template <typename Thread>
+static void bench_throughput(const char *name, size_t count) {
+    Thread thread{4096};
+    place(thread);
+
+    auto const start = clock_type::now();
+    for (size_t i = 0; i < count; ++i) push_until_accepted(thread, [] {});
+    wait_processed(thread, count);
+    auto const elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    push_until_accepted(thread, [] { return false; });
+    thread.join();
+
+    emit("\"case\":\"throughput\",\"queue\":\"%s\",\"tasks\":%zu,\"tasks_per_sec\":%.0f",
+         name,
+         count,
+         count / elapsed);
+}
+
+// 逐个提交任务并等待执行，测量从提交到开始执行的延迟，gap 为两次提交之间的间隔
+template <typename Thread>
+static void bench_latency(const char *name, size_t rounds, std::chrono::microseconds gap) {
+    Thread thread{4096};
+    place(thread);
+
+    flyzero::histogram hist;
+    for (size_t i = 0; i < rounds; ++i) {
+        if (gap.count() > 0) std::this_thread::sleep_for(gap);
+
+        auto const pushed = clock_type::now();
+        push_until_accepted(thread, [&hist, pushed] {
+            hist.record(std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() -
+                                                                             pushed)
+                            .count());
+        });
+        wait_processed(thread, i + 1);
+    }
+
+    push_until_accepted(thread, [] { return false; });
+    thread.join();
+
+    emit("\"case\":\"latency\",\"queue\":\"%s\",\"gap_us\":%lld,\"rounds\":%zu,"
+         "\"ns_min\":%llu,\"ns_p50\":%llu,\"ns_p99\":%llu,\"ns_max\":%llu",
+         name,
+         static_cast<long long>(gap.count()),
+         rounds,
+         static_cast<unsigned long long>(hist.min()),
+         static_cast<unsigned long long>(hist.percentile(50)),
+         static_cast<unsigned long long>(hist.percentile(99)),
+         static_cast<unsigned long long>(hist.max()));
+}
+
+int main(int argc, char *argv[]) {
+    // argv[1]: 吞吐用例的任务数；argv[2]: 延迟用例的轮数
+    size_t const tasks  = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+    size_t const rounds = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+
+    std::printf("[\n");
+
+    bench_throughput<semaphore_thread>("semaphore", tasks);
+    bench_throughput<task_queue_thread>("spin_park", tasks);
+    bench_throughput<metrics_thread>("spin_park_metrics", tasks);
+    bench_throughput<priority_thread>("priority", tasks);
+    bench_throughput<pool_thread>("thread_pool", tasks);
+
+    // 背靠背提交时工作线程仍在自旋；间隔 1ms 时工作线程已休眠，延迟包含唤醒
+    for (auto const gap : {std::chrono::microseconds{0}, std::chrono::microseconds{1000}}) {
+        auto const n = gap.count() > 0 ? rounds / 100 : rounds;
+        bench_latency<semaphore_thread>("semaphore", n, gap);
+        bench_latency<task_queue_thread>("spin_park", n, gap);
+        bench_latency<metrics_thread>("spin_park_metrics", n, gap);
+        bench_latency<priority_thread>("priority", n, gap);
+        bench_latency<pool_thread>("thread_pool", n, gap);
+    }
+
+    std::printf("\n]\n");
+}
@@ -0,0 +1,183 @@
+#include <broadcast_buffer.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// 写入第 i 条记录，数据长度随序号变化，每个字节都是序号的低 8 位
+static bool write_record(broadcast_buffer *bb, int i) {
+    auto const size = sizeof i + i % 37;
+    auto const data = broadcast_buffer_reserve(bb, size);
+    if (!data) return false;
+    std::memset(data, i & 0xff, size);
+    std::memcpy(data, &i, sizeof i);
+    broadcast_buffer_commit(bb, data, i % 3);
+    return true;
+}
+
+// 校验记录完整，返回序号
+static int check_record(int type, const void *data, size_t size) {
+    int i;
+    std::memcpy(&i, data, sizeof i);
+    assert(type == i % 3);
+    assert(size == sizeof i + i % 37);
+    for (auto k = sizeof i; k < size; ++k) {
+        assert(static_cast<const unsigned char *>(data)[k] == (i & 0xff));
+    }
+    return i;
+}
+
+// 按序读取，不允许丢失
+static void expect_next(int type, const void *data, size_t size, void *arg) {
+    auto const next = static_cast<int *>(arg);
+    assert(check_record(type, data, size) == *next);
+    ++*next;
+}
+
+// 测试无损模式，每个读者都读到全部记录，生产者被最慢的读者阻塞
+void test_lossless() {
+    auto const bb = broadcast_buffer_create(nullptr, 4096, 3, BROADCAST_BUFFER_LOSSLESS);
+    assert(bb);
+
+    auto constexpr N = 100000;
+    std::vector<broadcast_reader *> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.push_back(broadcast_reader_open(bb));
+        assert(readers.back());
+    }
+
+    // 游标已用完
+    assert(!broadcast_reader_open(bb) && errno == EBUSY);
+
+    std::vector<std::thread> threads;
+    for (auto const reader : readers) {
+        threads.emplace_back([reader] {
+            int next = 0;
+            while (next < N) {
+                if (broadcast_reader_read(reader, expect_next, &next, 64) == 0) {
+                    std::this_thread::yield();
+                }
+            }
+            assert(broadcast_reader_lost(reader) == 0);
+            broadcast_reader_close(reader);
+        });
+    }
+
+    for (int i = 0; i < N; ++i) {
+        while (!write_record(bb, i)) std::this_thread::yield();
+    }
+
+    for (auto &thread : threads) thread.join();
+
+    // 读者注销后生产者不再被阻塞
+    for (int i = 0; i < N; ++i) assert(write_record(bb, i));
+
+    broadcast_buffer_destroy(bb);
+}
+
+// 测试有损模式，慢读者跳过被覆盖的记录并得知丢失的字节数
+void test_lossy() {
+    auto const bb = broadcast_buffer_create(nullptr, 4096, 0, 0);
+    assert(bb);
+
+    auto const reader = broadcast_reader_open(bb);
+    assert(reader);
+
+    // 写入远超容量的记录，生产者从不等待
+    auto constexpr N = 10000;
+    for (int i = 0; i < N; ++i) assert(write_record(bb, i));
+
+    // 读到的是最近的若干条记录，序号连续
+    struct state {
+        int first{-1};
+        int last{-1};
+    } st;
+    while (broadcast_reader_read(
+               reader,
+               [](int type, const void *data, size_t size, void *arg) {
+                   auto const s = static_cast<state *>(arg);
+                   auto const i = check_record(type, data, size);
+                   if (s->first < 0) s->first = i;
+                   assert(s->last < 0 || i == s->last + 1);
+                   s->last = i;
+               },
+               &st,
+               64) > 0) {
+    }
+
+    assert(st.last == N - 1);
+    assert(st.first > 0);
+    assert(broadcast_reader_lost(reader) > 0);
+    broadcast_reader_close(reader);
+
+    // 生产者持续覆盖时读者读到的记录仍然完整且有序
+    auto const racer = broadcast_reader_open(bb);
+    std::thread producer([bb] {
+        for (int i = 0; i < 200000; ++i) write_record(bb, i);
+    });
+
+    int last = -1;
+    for (int k = 0; k < 10000; ++k) {
+        broadcast_reader_read(
+            racer,
+            [](int type, const void *data, size_t size, void *arg) {
+                auto const i = check_record(type, data, size);
+                assert(i > *static_cast<int *>(arg));
+                *static_cast<int *>(arg) = i;
+            },
+            &last,
+            64);
+    }
+
+    producer.join();
+    broadcast_reader_close(racer);
+    broadcast_buffer_destroy(bb);
+}
+
+// 测试跨进程读取与回收已退出进程的游标
+void test_process() {
+    auto const bb = broadcast_buffer_create(nullptr, 4096, 2, BROADCAST_BUFFER_LOSSLESS);
+    assert(bb);
+
+    // 子进程登记游标后不注销就退出
+    auto pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        _exit(broadcast_reader_open(bb) ? 0 : 1);
+    }
+
+    int status;
+    assert(waitpid(pid, &status, 0) == pid && WEXITSTATUS(status) == 0);
+    assert(broadcast_buffer_reap(bb) == 1);
+
+    // 子进程读取全部记录
+    auto const reader = broadcast_reader_open(bb);
+    assert(reader);
+    pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        int next = 0;
+        while (next < 10000) {
+            if (broadcast_reader_read(reader, expect_next, &next, 64) == 0) usleep(100);
+        }
+        _exit(0);
+    }
+
+    for (int i = 0; i < 10000; ++i) {
+        while (!write_record(bb, i)) usleep(100);
+    }
+
+    assert(waitpid(pid, &status, 0) == pid && WEXITSTATUS(status) == 0);
+    broadcast_reader_close(reader);
+    broadcast_buffer_destroy(bb);
+}
+
+int main() {
+    test_lossless();
+    test_lossy();
+    test_process();
+}
@@ -1,7 +1,16 @@
 #include <circular_buffer.h>
 
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <thread>
+#include <vector>
 
 // 测试单生产者单消费者
 void test_sp_sc(size_t private_size) {
@@ -16,7 +25,7 @@ void test_sp_sc(size_t private_size) {
     }
 
     auto constexpr N = 10000000;
-    volatile auto producer_done = false;
+    std::atomic<bool> producer_done{false};
 
     // 创建生产者线程
     std::thread producer([cb] {
@@ -40,9 +49,11 @@ void test_sp_sc(size_t private_size) {
     // 创建消费者线程
     std::thread consumer([cb, &producer_done] {
         for (int i = 0; i < N;) {
+            // 先读结束标志，生产者已结束时随后读到的写索引包含全部数据
+            auto const done = producer_done.load();
             auto readable = circular_buffer_get_readable(cb);
             if (readable.size < sizeof(int)) {
-                if (producer_done) {
+                if (done) {
                     abort();
                 }
 
@@ -93,8 +104,549 @@ void test_attach() {
     circular_buffer_destroy(cb1);
 }
 
+// 部分提交后缓存的长度可能不足，按所需长度获取时重新读取对端索引
+void test_partial_pop_push() {
+    auto const cb = circular_buffer_create(nullptr, 4096, 0, 0);
+    assert(cb);
+    auto const capacity = circular_buffer_get_writable(cb).size;
+    assert(capacity == 4096);
+
+    // 消费者缓存了写索引，部分弹出后生产者写满
+    assert(circular_buffer_push_data(cb, 100) == 100);
+    assert(circular_buffer_get_readable(cb).size == 100);
+    assert(circular_buffer_pop_data(cb, 50) == 50);
+    assert(circular_buffer_get_writable_min(cb, capacity - 50).size == capacity - 50);
+    assert(circular_buffer_push_data(cb, capacity - 50) == capacity - 50);
+
+    // 缓存的长度未用尽时不读取对端索引
+    assert(circular_buffer_get_readable(cb).size == 50);
+    assert(circular_buffer_get_readable_min(cb, 51).size == capacity);
+
+    // 生产者缓存了读索引，部分写入后消费者读空
+    assert(circular_buffer_pop_data(cb, capacity) == capacity);
+    assert(circular_buffer_get_writable_min(cb, SIZE_MAX).size == capacity);
+    assert(circular_buffer_push_data(cb, 3000) == 3000);
+    assert(circular_buffer_pop_data(cb, 3000) == 3000);
+    assert(circular_buffer_get_writable(cb).size == capacity - 3000);
+    assert(circular_buffer_get_writable_min(cb, SIZE_MAX).size == capacity);
+    assert(circular_buffer_get_readable(cb).size == 0);
+
+    circular_buffer_destroy(cb);
+}
+
+// 测试单生产者单消费者记录接口
+void test_sp_sc_records() {
+    auto const cb = circular_buffer_create(nullptr, 4096, 0, 0);
+    assert(cb);
+
+    auto const handler = [](int type, const void *data, size_t size, void *arg) {
+        auto const next = static_cast<int *>(arg);
+        int i;
+        std::memcpy(&i, data, sizeof i);
+        assert(i == *next && type == i % 5);
+        assert(size == sizeof i + i % 29);
+        assert(reinterpret_cast<uintptr_t>(data) % 8 == 0);
+        ++*next;
+    };
+
+    // 一批记录全部提交前对消费者不可见
+    auto const a = circular_buffer_reserve(cb, sizeof(int));
+    auto const b = circular_buffer_reserve(cb, sizeof(int) + 1);
+    assert(a && b);
+    int v = 0;
+    std::memcpy(a, &v, sizeof v);
+    v = 1;
+    std::memcpy(b, &v, sizeof v);
+    circular_buffer_commit(cb, a, 0);
+    int next = 0;
+    assert(circular_buffer_read_records(cb, handler, &next, 16) == 0);
+    circular_buffer_commit(cb, b, 1);
+    assert(circular_buffer_read_records(cb, handler, &next, 16) == 2);
+
+    // 使用记录接口时等待的是记录数据长度，计入记录头与对齐
+    auto const skip = [](int, const void *, size_t, void *) {};
+    auto const big = circular_buffer_reserve(cb, 4000);
+    assert(big);
+    circular_buffer_commit(cb, big, 0);
+    assert(circular_buffer_wait_writable(cb, 80, 0) == 88);
+    auto const start = std::chrono::steady_clock::now();
+    assert(circular_buffer_wait_writable(cb, 81, 10) < 96);
+    assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds{10});
+    assert(!circular_buffer_reserve(cb, 81));
+    auto const last = circular_buffer_reserve(cb, 80);
+    assert(last);
+    circular_buffer_commit(cb, last, 0);
+    assert(circular_buffer_read_records(cb, skip, nullptr, 16) == 2);
+
+    // 跨线程按批写入变长记录，记录跨越缓冲区末尾
+    auto constexpr N = 200000;
+    std::thread producer([cb] {
+        for (int i = 2; i < N;) {
+            void *batch[8];
+            int   n = 0;
+            for (; n < 1 + i % 8 && i + n < N; ++n) {
+                auto const k = i + n;
+                if (!(batch[n] = circular_buffer_reserve(cb, sizeof k + k % 29))) break;
+                std::memcpy(batch[n], &k, sizeof k);
+            }
+
+            if (n == 0) {
+                circular_buffer_wait_writable(cb, sizeof i + i % 29, -1);
+                continue;
+            }
+
+            for (int j = 0; j < n; ++j) circular_buffer_commit(cb, batch[j], (i + j) % 5);
+            i += n;
+        }
+    });
+
+    while (next < N) {
+        if (circular_buffer_read_records(cb, handler, &next, 64) == 0) {
+            circular_buffer_wait_readable(cb, 1, -1);
+        }
+    }
+
+    producer.join();
+    circular_buffer_destroy(cb);
+}
+
+// 测试多生产者单消费者
+void test_mp_sc() {
+    auto const cb = circular_buffer_create(nullptr, 4096, 0, CIRCULAR_BUFFER_MPSC);
+    assert(cb);
+
+    auto constexpr P = 4;
+    auto constexpr N = 100000;
+
+    // 每个生产者写入递增的序号，记录长度随序号变化
+    std::vector<std::thread> producers;
+    for (int p = 0; p < P; ++p) {
+        producers.emplace_back([cb, p] {
+            for (int i = 0; i < N; ++i) {
+                auto const size = sizeof i + i % 13;
+                void      *data;
+                while (!(data = circular_buffer_reserve(cb, size))) std::this_thread::yield();
+                std::memset(data, p, size);
+                std::memcpy(data, &i, sizeof i);
+                circular_buffer_commit(cb, data, p);
+            }
+        });
+    }
+
+    // 每个生产者的记录按序到达
+    struct state {
+        int next[P];
+        int total;
+    } st{};
+    while (st.total < P * N) {
+        auto const n = circular_buffer_read_records(
+            cb,
+            [](int type, const void *data, size_t size, void *arg) {
+                auto const s = static_cast<state *>(arg);
+                assert(type >= 0 && type < P);
+                int i;
+                std::memcpy(&i, data, sizeof i);
+                assert(i == s->next[type]);
+                assert(size == sizeof i + i % 13);
+                for (auto k = sizeof i; k < size; ++k) {
+                    assert(static_cast<const char *>(data)[k] == type);
+                }
+                ++s->next[type];
+                ++s->total;
+            },
+            &st,
+            64);
+        if (n == 0) std::this_thread::yield();
+    }
+
+    for (auto &producer : producers) producer.join();
+    circular_buffer_destroy(cb);
+}
+
+// 测试生产者提交前崩溃
+void test_mp_sc_unblock() {
+    auto const cb = circular_buffer_create(nullptr, 4096, 0, CIRCULAR_BUFFER_MPSC);
+    assert(cb);
+
+    auto const handler = [](int type, const void *, size_t, void *arg) {
+        static_cast<std::vector<int> *>(arg)->push_back(type);
+    };
+
+    // 第一条记录永远不会提交，之后的记录已提交也不可读
+    auto const lost = circular_buffer_reserve(cb, 100);
+    assert(lost);
+    auto const data = circular_buffer_reserve(cb, 10);
+    assert(data);
+    circular_buffer_commit(cb, data, 7);
+
+    std::vector<int> types;
+    assert(circular_buffer_read_records(cb, handler, &types, 16) == 0);
+
+    // 跳过未提交的记录
+    assert(circular_buffer_unblock(cb) == 1);
+    assert(circular_buffer_read_records(cb, handler, &types, 16) == 1);
+    assert(types.size() == 1 && types[0] == 7);
+    assert(circular_buffer_unblock(cb) == 0);
+
+    // 已读空间归还后可以写满整个缓冲区
+    size_t n = 0;
+    while (auto const p = circular_buffer_reserve(cb, 56)) {
+        circular_buffer_commit(cb, p, 1);
+        ++n;
+    }
+    assert(n == 4096 / 64);
+    assert(circular_buffer_read_records(cb, handler, &types, n) == n);
+
+    circular_buffer_destroy(cb);
+}
+
+// 测试阻塞等待
+void test_wait() {
+    auto const cb = circular_buffer_create(nullptr, 4096, 0, 0);
+    assert(cb);
+
+    // 超时返回
+    auto const start = std::chrono::steady_clock::now();
+    assert(circular_buffer_wait_readable(cb, 1, 20) == 0);
+    assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds{20});
+
+    // 跨线程唤醒消费者
+    std::thread consumer([cb] {
+        auto const n = circular_buffer_wait_readable(cb, 8, -1);
+        assert(n >= 8);
+        assert(circular_buffer_pop_data(cb, 8) == 8);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    circular_buffer_push_data(cb, 4);
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    circular_buffer_push_data(cb, 4);
+    consumer.join();
+
+    // 写满后跨线程唤醒生产者
+    circular_buffer_get_writable(cb);
+    assert(circular_buffer_push_data(cb, 4096) == 4096);
+    std::thread producer([cb] { assert(circular_buffer_wait_writable(cb, 100, -1) >= 100); });
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    circular_buffer_pop_data(cb, 100);
+    producer.join();
+
+    // 跨进程唤醒，子进程等待父进程写入
+    circular_buffer_pop_data(cb, 4096);
+    auto const pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        auto const n = circular_buffer_wait_readable(cb, 16, 5000);
+        _exit(n >= 16 ? 0 : 1);
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{20});
+    circular_buffer_push_data(cb, 16);
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    circular_buffer_destroy(cb);
+
+    // 多生产者模式，等待记录提交
+    auto const mp = circular_buffer_create(nullptr, 4096, 0, CIRCULAR_BUFFER_MPSC);
+    assert(mp);
+    auto const data = circular_buffer_reserve(mp, 32);
+    assert(circular_buffer_wait_readable(mp, 0, 10) == 0);
+    std::thread committer([mp, data] {
+        std::this_thread::sleep_for(std::chrono::milliseconds{20});
+        circular_buffer_commit(mp, data, 1);
+    });
+    assert(circular_buffer_wait_readable(mp, 0, -1) == 8 + 32);
+    committer.join();
+    circular_buffer_destroy(mp);
+}
+
+// 写入跨越缓冲区末尾的数据，通过镜像内存区连续读出，并通过原映射验证
+static void check_mirror(circular_buffer *cb) {
+    auto w = circular_buffer_get_writable(cb);
+    auto const capacity = w.size;
+    circular_buffer_push_data(cb, capacity - 8);
+    circular_buffer_pop_data(cb, capacity - 8);
+
+    assert(circular_buffer_wait_writable(cb, capacity, 0) == capacity);
+    w = circular_buffer_get_writable(cb);
+    assert(w.size == capacity);
+    for (int i = 0; i < 16; ++i) static_cast<char *>(w.data)[i] = static_cast<char>(i);
+    circular_buffer_push_data(cb, 16);
+
+    auto const r = circular_buffer_get_readable(cb);
+    assert(r.size == 16);
+    assert(std::memcmp(r.data, w.data, 16) == 0);
+    assert(static_cast<char *>(r.data)[8] == static_cast<char *>(r.data)[8 - capacity]);
+    circular_buffer_pop_data(cb, 16);
+}
+
+// 测试 memfd 与大页
+void test_huge_page() {
+    // memfd，通过文件描述符附着
+    auto const fd = memfd_create("test_circular_buffer", MFD_CLOEXEC);
+    assert(fd >= 0);
+    auto const cb1 = circular_buffer_fcreate(fd, 64 * 1024, 0, CIRCULAR_BUFFER_MEMFD);
+    assert(cb1);
+    auto const cb2 = circular_buffer_fattach(fd);
+    assert(cb2);
+    close(fd);
+    check_mirror(cb1);
+    *static_cast<char *>(circular_buffer_get_writable(cb1).data) = 'x';
+    circular_buffer_push_data(cb1, 1);
+    assert(*static_cast<char *>(circular_buffer_get_readable(cb2).data) == 'x');
+    circular_buffer_detach(cb2);
+    circular_buffer_destroy(cb1);
+
+    // 透明大页，映射对齐到 2MB
+    auto const thp = circular_buffer_create(nullptr, 1, 0, CIRCULAR_BUFFER_MEMFD | CIRCULAR_BUFFER_THP);
+    assert(thp);
+    auto const data = circular_buffer_get_writable(thp);
+    assert(data.size == 2 * 1024 * 1024);
+    assert(reinterpret_cast<uintptr_t>(data.data) % (2 * 1024 * 1024) == 0);
+    check_mirror(thp);
+    circular_buffer_destroy(thp);
+
+    // 两种大页不能同时使用
+    auto const invalid = circular_buffer_create(
+        nullptr, 1, 0, CIRCULAR_BUFFER_HUGE_2MB | CIRCULAR_BUFFER_HUGE_1GB);
+    assert(!invalid && errno == EINVAL);
+
+    // 2MB 大页，系统没有预留大页时跳过
+    auto const huge = circular_buffer_create(nullptr, 4 * 1024 * 1024, 0, CIRCULAR_BUFFER_HUGE_2MB);
+    if (huge) {
+        assert(reinterpret_cast<uintptr_t>(huge) % (2 * 1024 * 1024) == 0);
+        check_mirror(huge);
+        circular_buffer_destroy(huge);
+    }
+}
+
+// 测试 NUMA 节点绑定
+void test_numa() {
+    auto const cb = circular_buffer_create(nullptr, 1024 * 1024, 0, CIRCULAR_BUFFER_NUMA_NODE(0));
+    if (!cb) {
+        // 内核不支持 NUMA
+        assert(errno == ENOSYS);
+        return;
+    }
+
+    assert(circular_buffer_get_numa_node(cb) == 0);
+    check_mirror(cb);
+    circular_buffer_destroy(cb);
+}
+
+// 检查整个缓冲区与镜像都已驻留内存
+static void check_resident(circular_buffer *cb, size_t capacity) {
+    assert(circular_buffer_wait_writable(cb, capacity, 0) == capacity);
+    auto const data = circular_buffer_get_writable(cb).data;
+    auto const page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> vec(2 * capacity / page_size);
+    assert(mincore(data, 2 * capacity, vec.data()) == 0);
+    for (auto const v : vec) assert(v & 1);
+}
+
+// 测试预分配与锁定
+void test_prefault() {
+    auto constexpr capacity = size_t{1024 * 1024};
+    auto const name = "/test_circular_buffer_prefault";
+    shm_unlink(name);
+
+    auto cb = circular_buffer_create(name, capacity, 0, CIRCULAR_BUFFER_PREFAULT);
+    assert(cb);
+    check_resident(cb, capacity);
+
+    // 附着的进程同样预分配
+    auto const other = circular_buffer_attach(name);
+    assert(other);
+    check_resident(other, capacity);
+    circular_buffer_detach(other);
+    circular_buffer_destroy(cb);
+
+    // 锁定受 RLIMIT_MEMLOCK 限制
+    cb = circular_buffer_create(name, capacity, 0, CIRCULAR_BUFFER_MLOCK);
+    if (!cb) {
+        assert(errno == ENOMEM || errno == EPERM || errno == EAGAIN);
+        return;
+    }
+
+    check_resident(cb, capacity);
+    check_mirror(cb);
+    circular_buffer_destroy(cb);
+}
+
+// 测试日志模式的持久化与恢复
+void test_journal(int flag) {
+    char path[] = "/tmp/test_circular_buffer_XXXXXX";
+    auto const fd = mkstemp(path);
+    assert(fd >= 0);
+    unlink(path);
+
+    auto const write_record = [](circular_buffer *cb, int i) {
+        auto const data = circular_buffer_reserve(cb, sizeof i + i % 11);
+        assert(data);
+        std::memset(data, i, sizeof i + i % 11);
+        std::memcpy(data, &i, sizeof i);
+        circular_buffer_commit(cb, data, 3);
+        return data;
+    };
+
+    auto const expect_next = [](int type, const void *data, size_t size, void *arg) {
+        int i;
+        std::memcpy(&i, data, sizeof i);
+        assert(type == 3 && size == sizeof i + i % 11);
+        assert(i == *static_cast<int *>(arg));
+        ++*static_cast<int *>(arg);
+    };
+
+    // 没有文件描述符时无法创建
+    assert(!circular_buffer_create(nullptr, 4096, 0, flag | CIRCULAR_BUFFER_JOURNAL));
+
+    // 子进程写入 100 条记录，消费前 40 条，再写入 10 条后崩溃
+    auto const pid = fork();
+    assert(pid >= 0);
+    if (pid == 0) {
+        auto const cb = circular_buffer_fcreate(fd, 8192, 0, flag | CIRCULAR_BUFFER_JOURNAL);
+        assert(cb);
+        circular_buffer_set_sync_interval(cb, 1024, 10);
+        for (int i = 0; i < 100; ++i) write_record(cb, i);
+
+        int next = 0;
+        assert(circular_buffer_read_records(cb, expect_next, &next, 40) == 40);
+        assert(circular_buffer_sync(cb) == 0);
+
+        for (int i = 100; i < 110; ++i) write_record(cb, i);
+
+        // 第 110 条记录只预订不提交
+        assert(circular_buffer_reserve(cb, 16));
+        abort();
+    }
+
+    int status;
+    assert(waitpid(pid, &status, 0) == pid && WIFSIGNALED(status));
+
+    // 重启后恢复，重放未消费的记录
+    auto const cb = circular_buffer_fattach(fd);
+    assert(cb);
+    assert(circular_buffer_recover(cb) == 70);
+    int next = 40;
+    assert(circular_buffer_read_records(cb, expect_next, &next, 1000) == 70);
+    assert(next == 110);
+
+    // 恢复后可以继续写入
+    write_record(cb, 110);
+    assert(circular_buffer_read_records(cb, expect_next, &next, 1000) == 1);
+
+    // 损坏的记录及其之后的记录被截断
+    void *damaged = nullptr;
+    for (int i = 111; i < 120; ++i) {
+        auto const data = write_record(cb, i);
+        if (i == 115) damaged = data;
+    }
+    static_cast<char *>(damaged)[5] ^= 1;
+    circular_buffer_detach(cb);
+
+    auto const again = circular_buffer_fattach(fd);
+    assert(again);
+    assert(circular_buffer_recover(again) == 4);
+    assert(circular_buffer_read_records(again, expect_next, &next, 1000) == 4);
+    assert(next == 115);
+    circular_buffer_detach(again);
+    close(fd);
+}
+
+// 多生产者日志模式下，持久化时已预订未提交的记录在提交后由下一次持久化覆盖
+void test_journal_late_commit() {
+    char path[] = "/tmp/test_circular_buffer_XXXXXX";
+    auto const fd = mkstemp(path);
+    assert(fd >= 0);
+    unlink(path);
+
+    auto const cb =
+        circular_buffer_fcreate(fd, 4096, 0, CIRCULAR_BUFFER_MPSC | CIRCULAR_BUFFER_JOURNAL);
+    assert(cb);
+
+    // 16 字节的数据连同记录头与校验和占 32 字节
+    auto const first = circular_buffer_reserve(cb, 16);
+    auto const second = circular_buffer_reserve(cb, 16);
+    assert(first && second);
+    circular_buffer_commit(cb, second, 3);
+
+    // 第一条记录尚未提交，已持久化的位置停在它之前
+    assert(circular_buffer_sync(cb) == 0);
+    assert(circular_buffer_get_synced(cb) == 0);
+
+    circular_buffer_commit(cb, first, 3);
+    assert(circular_buffer_sync(cb) == 0);
+    assert(circular_buffer_get_synced(cb) == 64);
+
+    // 已消费的记录不再持久化，位置从读索引继续
+    assert(circular_buffer_read_records(cb, [](int, const void *, size_t, void *) {}, nullptr, 10) == 2);
+    auto const third = circular_buffer_reserve(cb, 16);
+    assert(third);
+    circular_buffer_commit(cb, third, 3);
+    assert(circular_buffer_sync(cb) == 0);
+    assert(circular_buffer_get_synced(cb) == 96);
+
+    circular_buffer_detach(cb);
+    close(fd);
+}
+
+// 日志模式下等待可写空间时计入校验和，醒来后一定能预订
+void test_journal_wait_writable() {
+    char path[] = "/tmp/test_circular_buffer_XXXXXX";
+    auto const fd = mkstemp(path);
+    assert(fd >= 0);
+    unlink(path);
+
+    auto const cb =
+        circular_buffer_fcreate(fd, 4096, 0, CIRCULAR_BUFFER_MPSC | CIRCULAR_BUFFER_JOURNAL);
+    assert(cb);
+
+    // 以 16 字节的空记录写满
+    int count = 0;
+    while (auto const data = circular_buffer_reserve(cb, 0)) {
+        circular_buffer_commit(cb, data, 3);
+        ++count;
+    }
+    assert(count == 4096 / 16);
+
+    // 56 字节的记录连同记录头与校验和占 72 字节
+    std::atomic<bool> reserved{false};
+    std::thread producer([cb, &reserved] {
+        assert(circular_buffer_wait_writable(cb, 56, -1) >= 72);
+        auto const data = circular_buffer_reserve(cb, 56);
+        assert(data);
+        circular_buffer_commit(cb, data, 3);
+        reserved = true;
+    });
+
+    // 逐条消费，每次给生产者留出醒来预订的时间
+    auto const skip = [](int, const void *, size_t, void *) {};
+    while (!reserved) {
+        assert(circular_buffer_read_records(cb, skip, nullptr, 1) == 1);
+        for (int i = 0; i < 50 && !reserved; ++i) usleep(100);
+    }
+    producer.join();
+
+    circular_buffer_detach(cb);
+    close(fd);
+}
+
 int main() {
     test_sp_sc(0);
     test_sp_sc(100);
     test_attach();
+    test_partial_pop_push();
+    test_sp_sc_records();
+    test_mp_sc();
+    test_mp_sc_unblock();
+    test_wait();
+    test_huge_page();
+    test_numa();
+    test_journal(0);
+    test_journal(CIRCULAR_BUFFER_MPSC);
+    test_journal_late_commit();
+    test_journal_wait_writable();
+    test_prefault();
 }
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include <cpu_topology.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <task_queue_thread.h>
+#include <thread_pool.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using flyzero::cpu_topology;
+using flyzero::thread_placement;
+
+// 写入伪造的 sysfs 文件，逐级创建目录
+static void write_file(const std::string &path, const std::string &content) {
+    for (auto pos = path.find('/', 1); pos != std::string::npos; pos = path.find('/', pos + 1)) {
+        ::mkdir(path.substr(0, pos).c_str(), 0755);
+    }
+    std::ofstream{path} << content << '\n';
+}
+
+// 测试 CPU 列表解析
+void test_parse_list() {
+    using list = std::vector<unsigned>;
+    assert(cpu_topology::parse_list("0") == (list{0}));
+    assert(cpu_topology::parse_list("0-3,8,10-11") == (list{0, 1, 2, 3, 8, 10, 11}));
+    assert(cpu_topology::parse_list("") == list{});
+    assert(cpu_topology::parse_list("0-1,x") == (list{0, 1}));
+    assert(cpu_topology::parse_list("3-1") == list{});
+}
+
+// 测试从伪造的 sysfs 读取拓扑：2 个节点，每个节点 2 个物理核心，每个核心 2 个超线程，兄弟编号相邻
+void test_topology() {
+    char root[] = "/tmp/test_cpu_topology.XXXXXX";
+    assert(::mkdtemp(root));
+    std::string const base = root;
+
+    write_file(base + "/cpu/online", "0-7");
+    for (unsigned i = 0; i < 8; ++i) {
+        auto const dir = base + "/cpu/cpu" + std::to_string(i) + "/topology/";
+        write_file(dir + "physical_package_id", std::to_string(i / 4));
+        write_file(dir + "core_id", std::to_string(i / 2 % 2));
+    }
+    write_file(base + "/node/online", "0-1");
+    write_file(base + "/node/node0/cpulist", "0-3");
+    write_file(base + "/node/node1/cpulist", "4-7");
+
+    cpu_topology const topology{base};
+    assert(topology.cpus().size() == 8);
+    assert(topology.get_core_count() == 4);
+    assert(topology.get_node_count() == 2);
+    assert(topology.cpus()[5].package == 1 && topology.cpus()[5].core == 0);
+    assert(topology.node_cpus(1) == (std::vector<unsigned>{4, 5, 6, 7}));
+
+    // 先占满各物理核心，再使用超线程兄弟
+    assert(topology.spread() == (std::vector<unsigned>{0, 2, 4, 6, 1, 3, 5, 7}));
+
+    auto const spread = thread_placement::spread(topology);
+    assert(spread.get_policy() == thread_placement::policy::spread);
+    assert(spread.cpus_for(1) == std::vector<unsigned>{2});
+    assert(spread.cpus_for(9) == std::vector<unsigned>{2});
+
+    auto const numa = thread_placement::numa(0, topology);
+    assert(numa.cpus_for(3) == (std::vector<unsigned>{0, 1, 2, 3}));
+
+    assert(thread_placement{}.cpus_for(0).empty());
+
+    bool thrown = false;
+    try {
+        thread_placement::numa(2, topology);
+    } catch (const std::invalid_argument &) {
+        thrown = true;
+    }
+    assert(thrown);
+
+    std::system((std::string{"rm -rf "} + base).c_str());
+
+    // 读取失败时退化为每个逻辑 CPU 独占一个物理核心
+    cpu_topology const fallback{"/nonexistent"};
+    assert(fallback.cpus().size() == std::max(1u, std::thread::hardware_concurrency()));
+    assert(fallback.get_core_count() == fallback.cpus().size());
+    assert(fallback.get_node_count() == 1);
+}
+
+// 测试在本机上放置线程
+void test_apply() {
+    auto const &topology = cpu_topology::current();
+    assert(!topology.cpus().empty());
+    auto const last = topology.cpus().back().id;
+
+    // 放置调用线程
+    thread_placement::pin({last}).apply_current();
+    assert(static_cast<unsigned>(::sched_getcpu()) == last);
+    thread_placement::numa(topology.cpus().back().node).apply_current();
+
+    // 放置 task_queue_thread
+    flyzero::task_queue_thread thread{16};
+    thread.set_placement(thread_placement::pin({last}));
+    std::atomic<int> cpu{-1};
+    while (!thread.push([&cpu] { cpu = ::sched_getcpu(); })) std::this_thread::yield();
+    while (!thread.push([] { return false; })) std::this_thread::yield();
+    thread.join();
+    assert(cpu == static_cast<int>(last));
+
+    // 线程池的工作线程分散到各物理核心
+    flyzero::thread_pool::options opts;
+    opts.thread_count = 2;
+    opts.placement    = thread_placement::spread();
+    flyzero::thread_pool pool{opts};
+    assert(pool.get_thread_count() == 2);
+}
+
+int main() {
+    test_parse_list();
+    test_topology();
+    test_apply();
+}
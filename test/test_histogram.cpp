@@ -0,0 +1,139 @@
+#include <histogram.h>
+
+#include <cassert>
+#include <cstdint>
+#include <random>
+
+/**
+ * @brief 记录 value 和一个更大的值后，第 50 百分位即 value 所在桶的上界
+ */
+static uint64_t upper_of(uint64_t value) {
+    flyzero::histogram h;
+    h.record(value);
+    h.record(~uint64_t{0});
+    return h.percentile(50);
+}
+
+// 测试空直方图
+static void test_empty() {
+    flyzero::histogram const h;
+    assert(h.count() == 0);
+    assert(h.min() == 0);
+    assert(h.max() == 0);
+    assert(h.mean() == 0.0);
+    assert(h.percentile(50) == 0);
+}
+
+// 测试桶边界
+static void test_bucket_boundary() {
+    // 小于子桶数的值精确记录
+    for (uint64_t v = 0; v < flyzero::histogram::sub_count; ++v) assert(upper_of(v) == v);
+
+    // 第一个区间的子桶宽度为 1
+    assert(upper_of(8) == 8);
+    assert(upper_of(15) == 15);
+
+    // 之后每个区间的子桶宽度翻倍
+    assert(upper_of(16) == 17);
+    assert(upper_of(17) == 17);
+    assert(upper_of(18) == 19);
+    assert(upper_of(31) == 31);
+    assert(upper_of(32) == 35);
+
+    // 2 的幂及其前一个值分属相邻区间
+    for (unsigned bit = 4; bit < 64; ++bit) {
+        auto const p = uint64_t{1} << bit;
+        assert(upper_of(p - 1) == p - 1);
+        assert(upper_of(p) == p + (p >> 3) - 1);
+    }
+
+    // 最大值落在最后一个桶，上界不溢出
+    auto const max = ~uint64_t{0};
+    assert(upper_of(max) == max);
+    assert(upper_of(max - 1) == max);
+    assert(upper_of(uint64_t{15} << 60) == max);
+    assert(upper_of((uint64_t{15} << 60) - 1) == (uint64_t{15} << 60) - 1);
+
+    flyzero::histogram h;
+    h.record(max);
+    assert(h.count() == 1);
+    assert(h.min() == max);
+    assert(h.max() == max);
+    assert(h.percentile(0) == max);
+    assert(h.percentile(100) == max);
+}
+
+// 测试相对误差
+static void test_relative_error() {
+    std::mt19937_64 rng{42};
+    for (int i = 0; i < 100000; ++i) {
+        auto const v = rng() >> (rng() % 64);
+        auto const u = upper_of(v);
+        assert(u >= v);
+        assert(u - v <= v / flyzero::histogram::sub_count);
+    }
+}
+
+// 测试百分位
+static void test_percentile() {
+    flyzero::histogram h;
+    for (uint64_t v = 1; v <= 100; ++v) h.record(v);
+
+    assert(h.count() == 100);
+    assert(h.min() == 1);
+    assert(h.max() == 100);
+    assert(h.mean() == 50.5);
+
+    // 百分位不小于真实值，误差不超过所在桶的宽度
+    for (int p = 1; p <= 100; ++p) {
+        auto const v = h.percentile(p);
+        assert(v >= static_cast<uint64_t>(p));
+        assert(v - p <= static_cast<uint64_t>(p) / flyzero::histogram::sub_count);
+    }
+
+    // 不超过最大值
+    assert(h.percentile(0) == 1);
+    assert(h.percentile(100) == 100);
+    assert(h.percentile(99.9) == 100);
+
+    h.reset();
+    assert(h.count() == 0);
+    assert(h.percentile(50) == 0);
+}
+
+// 测试合并
+static void test_merge() {
+    flyzero::histogram a;
+    flyzero::histogram b;
+    for (uint64_t v = 1; v <= 7; ++v) a.record(v);
+    for (uint64_t v = 1000; v < 1010; ++v) b.record(v);
+    b.record(~uint64_t{0});
+
+    flyzero::histogram m;
+    m.merge(a);
+    m.merge(b);
+    assert(m.count() == a.count() + b.count());
+    assert(m.min() == 1);
+    assert(m.max() == ~uint64_t{0});
+    assert(m.percentile(0) == 1);
+    assert(m.percentile(100) == ~uint64_t{0});
+
+    // 前 7 个值来自 a，之后来自 b
+    assert(m.percentile(100.0 * 7 / 18) == 7);
+    assert(m.percentile(100.0 * 8 / 18) == b.percentile(100.0 / 11));
+
+    // 合并空直方图不改变结果
+    flyzero::histogram const empty;
+    a.merge(empty);
+    assert(a.count() == 7);
+    assert(a.min() == 1);
+    assert(a.max() == 7);
+}
+
+int main() {
+    test_empty();
+    test_bucket_boundary();
+    test_relative_error();
+    test_percentile();
+    test_merge();
+}
@@ -0,0 +1,93 @@
+#include <hot_restart.h>
+
+#include <sys/socket.h>
+
+#include <cassert>
+#include <string>
+#include <thread>
+
+class old_process : public flyzero::hot_restart_server {
+public:
+    using hot_restart_server::hot_restart_server;
+
+    volatile bool done{false};  ///< 是否已完成交接
+
+protected:
+    void on_export_state(state_writer &writer) override {
+        for (auto const s : {"hello", "world"}) {
+            auto const ok = writer.write(s, std::strlen(s));
+            assert(ok);
+        }
+    }
+
+    void on_handoff_complete() override { done = true; }
+};
+
+static int tcp_listen(sockaddr_in &addr) {
+    auto const sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    assert(sock >= 0);
+
+    addr                 = {};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    auto err             = ::bind(sock, reinterpret_cast<sockaddr *>(&addr), sizeof addr);
+    assert(err == 0);
+
+    socklen_t addrlen = sizeof addr;
+    err               = ::getsockname(sock, reinterpret_cast<sockaddr *>(&addr), &addrlen);
+    assert(err == 0);
+
+    err = ::listen(sock, 16);
+    assert(err == 0);
+    return sock;
+}
+
+int main() {
+    auto const path = "/tmp/test_hot_restart.sock";
+
+    // 旧进程的监听套接字
+    sockaddr_in                   addr;
+    flyzero::file_descriptor const listener{tcp_listen(addr)};
+
+    // 旧进程运行交接服务
+    flyzero::event_dispatch dispatch;
+    old_process             server{path, {listener.get()}};
+    dispatch.register_io_listener(server, flyzero::event_dispatch::event::read);
+    std::thread old_thread([&] {
+        while (!server.done) dispatch.run_once(std::chrono::milliseconds{10});
+    });
+
+    // 交接前发起的连接停留在 accept 队列中
+    flyzero::file_descriptor const conn{::socket(AF_INET, SOCK_STREAM, 0)};
+    auto err = ::connect(conn.get(), reinterpret_cast<sockaddr *>(&addr), sizeof addr);
+    assert(err == 0);
+
+    // 新进程接管
+    flyzero::hot_restart_client client{path};
+    assert(client.listeners().size() == 1);
+
+    std::vector<char> chunk;
+    std::string       state;
+    while (client.read_state(chunk)) {
+        state.append(chunk.begin(), chunk.end());
+        state.push_back(';');
+    }
+    assert(state == "hello;world;");
+
+    // 接管的监听套接字与旧进程的是同一个
+    sockaddr_in taken;
+    socklen_t   addrlen = sizeof taken;
+    err = ::getsockname(client.listeners()[0].get(), reinterpret_cast<sockaddr *>(&taken), &addrlen);
+    assert(err == 0);
+    assert(taken.sin_port == addr.sin_port);
+
+    client.complete();
+    old_thread.join();
+    assert(server.done);
+
+    // 新进程可以 accept 交接前发起的连接
+    flyzero::file_descriptor const accepted{::accept(client.listeners()[0].get(), nullptr, nullptr)};
+    assert(accepted);
+
+    ::unlink(path);
+}
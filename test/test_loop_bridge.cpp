@@ -0,0 +1,136 @@
+#include <loop_bridge.h>
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using flyzero::event_dispatch;
+using flyzero::loop_bridge;
+using flyzero::thread_pool;
+
+// 运行事件循环直到条件满足
+template <typename Pred>
+static void run_until(event_dispatch &dispatch, Pred pred) {
+    while (!pred()) dispatch.run_once(std::chrono::milliseconds{10});
+}
+
+// 测试结果与回调都在事件循环线程中送达，多个完成合并为较少的唤醒
+void test_submit() {
+    auto constexpr N = 1000;
+
+    event_dispatch dispatch;
+    loop_bridge    bridge{dispatch};
+
+    thread_pool::options opts;
+    opts.thread_count = 4;
+    thread_pool pool{opts};
+
+    auto const                        loop_thread = std::this_thread::get_id();
+    std::vector<flyzero::future<int>> futures;
+    long                              sum  = 0;
+    int                               done = 0;
+    for (int i = 0; i < N; ++i) {
+        auto f = bridge.submit(pool, [i] { return i; });
+        assert(f);
+        f.then([&, loop_thread](flyzero::future<int> &r) {
+            assert(std::this_thread::get_id() == loop_thread);
+            sum += r.get();
+            ++done;
+        });
+        futures.push_back(std::move(f));
+    }
+
+    // future 先被销毁时结果仍会送达，共享状态由执行流程释放
+    assert(bridge.submit(pool, [] { return 0; }));
+
+    run_until(dispatch, [&] { return done == N && bridge.get_completed_num() == N + 1; });
+    assert(sum == static_cast<long>(N) * (N - 1) / 2);
+    assert(bridge.get_wakeup_num() >= 1 && bridge.get_wakeup_num() <= N + 1);
+
+    // 已送达的 future 注册回调时立即执行
+    for (int i = 0; i < N; ++i) assert(futures[i].ready() && futures[i].get() == i);
+    bool called = false;
+    futures[0].then([&called](flyzero::future<int> &r) { called = r.get() == 0; });
+    assert(called);
+}
+
+// 测试异常、void 结果与线程池丢弃的任务
+void test_error() {
+    event_dispatch dispatch;
+    loop_bridge    bridge{dispatch};
+
+    thread_pool::options opts;
+    opts.thread_count = 1;
+
+    std::atomic<bool>     release{false};
+    std::atomic<bool>     started{false};
+    flyzero::future<void> thrown, blocker, dropped;
+    {
+        thread_pool pool{opts};
+
+        thrown = bridge.submit(pool, [] { throw std::runtime_error{"failed"}; });
+        run_until(dispatch, [&] { return thrown.ready(); });
+
+        blocker = bridge.submit(pool, [&] {
+            started = true;
+            while (!release) std::this_thread::yield();
+        });
+        while (!started) std::this_thread::yield();
+        dropped = bridge.submit(pool, [] {});
+
+        // 停止后工作线程不再取任务，剩余任务在线程池析构时被丢弃
+        pool.stop();
+        release = true;
+    }
+
+    run_until(dispatch, [&] { return blocker.ready() && dropped.ready(); });
+    blocker.get();
+
+    bool caught = false;
+    try {
+        thrown.get();
+    } catch (const std::runtime_error &) {
+        caught = true;
+    }
+    assert(caught);
+
+    caught = false;
+    try {
+        dropped.get();
+    } catch (const std::future_error &e) {
+        caught = e.code() == std::future_errc::broken_promise;
+    }
+    assert(caught);
+}
+
+// 测试投递可调用对象与析构时丢弃未处理的通知
+void test_post() {
+    event_dispatch dispatch;
+
+    int  ran    = 0;
+    auto bridge = std::make_unique<loop_bridge>(dispatch);
+    std::thread t{[&] {
+        for (int i = 0; i < 100; ++i) bridge->post([&ran] { ++ran; });
+    }};
+    t.join();
+
+    // 一个线程连续投递，事件循环只需唤醒一次
+    dispatch.run_once(std::chrono::milliseconds{10});
+    assert(ran == 100);
+    assert(bridge->get_wakeup_num() == 1);
+
+    bridge->post([&ran] { ++ran; });
+    bridge.reset();
+    assert(ran == 100);
+}
+
+int main() {
+    test_submit();
+    test_error();
+    test_post();
+}
@@ -0,0 +1,115 @@
+#include <mpmc_queue.h>
+
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// 测试单线程下的容量与回绕
+void test_basic() {
+    flyzero::mpmc_queue<int> q{3};
+    assert(q.capacity() == 4);
+    assert(q.empty());
+
+    int v;
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 4; ++i) assert(q.try_push(round * 4 + i));
+        assert(!q.try_push(100));
+        assert(q.size() == 4);
+
+        for (int i = 0; i < 4; ++i) {
+            assert(q.try_pop(v));
+            assert(v == round * 4 + i);
+        }
+        assert(!q.try_pop(v));
+    }
+
+    // 剩余元素由析构函数销毁
+    flyzero::mpmc_queue<std::unique_ptr<int>> p{4};
+    assert(p.try_push(std::make_unique<int>(1)));
+    assert(p.try_push(new int{2}));
+    std::unique_ptr<int> out;
+    assert(p.try_pop(out) && *out == 1);
+}
+
+// 测试超时
+void test_timeout() {
+    using namespace std::chrono;
+    flyzero::mpmc_queue<int> q{2};
+
+    int  v;
+    auto start = steady_clock::now();
+    assert(!q.pop_for(v, milliseconds{20}));
+    assert(steady_clock::now() - start >= milliseconds{20});
+
+    assert(q.push_for(milliseconds{20}, 1));
+    assert(q.push_for(milliseconds{20}, 2));
+    start = steady_clock::now();
+    assert(!q.push_for(milliseconds{20}, 3));
+    assert(steady_clock::now() - start >= milliseconds{20});
+
+    // 等待中被另一个线程唤醒
+    std::thread consumer([&q] {
+        std::this_thread::sleep_for(milliseconds{10});
+        int x;
+        q.pop(x);
+        assert(x == 1);
+    });
+    assert(q.push_for(seconds{10}, 3));
+    consumer.join();
+
+    assert(q.pop_for(v, seconds{10}) && v == 2);
+    assert(q.pop_for(v, seconds{10}) && v == 3);
+}
+
+// 测试多个生产者与多个消费者，小容量使双方频繁休眠
+void test_threads() {
+    auto constexpr P = 4;
+    auto constexpr C = 4;
+    auto constexpr N = 200000;
+
+    flyzero::mpmc_queue<long> q{16};
+    std::vector<std::thread> threads;
+    std::vector<long>        sums(C);
+    std::vector<long>        counts(C);
+
+    for (int c = 0; c < C; ++c) {
+        threads.emplace_back([&, c] {
+            for (;;) {
+                long v;
+                q.pop(v);
+                if (v < 0) break;
+                sums[c] += v;
+                ++counts[c];
+            }
+        });
+    }
+
+    for (int p = 0; p < P; ++p) {
+        threads.emplace_back([&q, p] {
+            for (long i = 0; i < N; ++i) q.push(p * N + i);
+        });
+    }
+
+    for (int p = 0; p < P; ++p) threads[C + p].join();
+    for (int c = 0; c < C; ++c) q.push(-1L);
+    for (int c = 0; c < C; ++c) threads[c].join();
+
+    long sum = 0, count = 0;
+    for (int c = 0; c < C; ++c) {
+        sum += sums[c];
+        count += counts[c];
+    }
+
+    long const total = long{P} * N;
+    assert(count == total);
+    assert(sum == total * (total - 1) / 2);
+    assert(q.empty());
+}
+
+int main() {
+    test_basic();
+    test_timeout();
+    test_threads();
+}
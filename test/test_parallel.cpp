@@ -0,0 +1,121 @@
+#include <parallel.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using flyzero::thread_pool;
+
+// 测试每个下标恰好执行一次
+void test_for(thread_pool &pool) {
+    auto constexpr N = 100000;
+
+    std::vector<std::atomic<int>> visited(N);
+    flyzero::parallel_for(pool, 0, N, [&visited](size_t i) { ++visited[i]; });
+    for (auto &v : visited) assert(v == 1);
+
+    // 按块执行，块不小于 grain
+    std::atomic<size_t> total{0};
+    std::atomic<size_t> chunks{0};
+    flyzero::parallel_for(
+        pool, 10, N,
+        [&](size_t lo, size_t hi) {
+            assert(hi - lo >= 100 || hi == N);
+            total += hi - lo;
+            ++chunks;
+        },
+        100);
+    assert(total == N - 10);
+    assert(chunks <= (N - 10) / 100 + 1);
+
+    // 空区间
+    flyzero::parallel_for(pool, 5, 5, [](size_t) { assert(false); });
+}
+
+// 测试异常传回调用线程，且剩余部分不再执行
+void test_exception(thread_pool &pool) {
+    std::atomic<size_t> ran{0};
+    bool                caught = false;
+    try {
+        flyzero::parallel_for(pool, 0, 1000000, [&ran](size_t i) {
+            ++ran;
+            if (i == 10) throw std::runtime_error{"failed"};
+        });
+    } catch (const std::runtime_error &) {
+        caught = true;
+    }
+    assert(caught);
+    assert(ran < 1000000);
+}
+
+// 测试并行归约
+void test_reduce(thread_pool &pool) {
+    auto const sum = flyzero::parallel_reduce(
+        pool, 1, 1000001, 0LL,
+        [](size_t lo, size_t hi, long long init) {
+            for (auto i = lo; i < hi; ++i) init += static_cast<long long>(i);
+            return init;
+        },
+        [](long long a, long long b) { return a + b; },
+        1000);
+    assert(sum == 500000500000LL);
+
+    auto const max = flyzero::parallel_reduce(
+        pool, 0, 0, -1, [](size_t, size_t, int init) { return init; },
+        [](int a, int b) { return std::max(a, b); });
+    assert(max == -1);
+}
+
+// 测试并行排序的结果与稳定性
+void test_sort(thread_pool &pool) {
+    std::mt19937 rng{42};
+    for (size_t const n : {0, 1, 100, 5000, 100000, 1000003}) {
+        // 键只有 1000 种，检查相同键的元素保持原有顺序
+        std::vector<std::pair<int, size_t>> v(n);
+        for (size_t i = 0; i < n; ++i) v[i] = {static_cast<int>(rng() % 1000), i};
+
+        auto expect = v;
+        auto comp   = [](auto const &a, auto const &b) { return a.first < b.first; };
+        std::stable_sort(expect.begin(), expect.end(), comp);
+        flyzero::parallel_sort(pool, v.begin(), v.end(), comp, 1024);
+        assert(v == expect);
+    }
+
+    // 默认比较函数与只能移动的元素
+    std::vector<std::unique_ptr<int>> p;
+    for (int i = 0; i < 20000; ++i) p.push_back(std::make_unique<int>(static_cast<int>(rng())));
+    flyzero::parallel_sort(pool, p.begin(), p.end(), [](auto const &a, auto const &b) {
+        return *a < *b;
+    });
+    assert(std::is_sorted(p.begin(), p.end(), [](auto const &a, auto const &b) { return *a < *b; }));
+
+    std::vector<int> d(300000);
+    for (auto &x : d) x = static_cast<int>(rng());
+    flyzero::parallel_sort(pool, d.begin(), d.end());
+    assert(std::is_sorted(d.begin(), d.end()));
+}
+
+// 测试在工作线程内嵌套调用
+void test_nested(thread_pool &pool) {
+    std::atomic<long> sum{0};
+    flyzero::parallel_for(pool, 0, 64, [&](size_t) {
+        flyzero::parallel_for(pool, 0, 1000, [&sum](size_t j) { sum += static_cast<long>(j); });
+    });
+    assert(sum == 64L * 999 * 1000 / 2);
+}
+
+int main() {
+    thread_pool::options opts;
+    opts.thread_count = 4;
+    thread_pool pool{opts};
+
+    test_for(pool);
+    test_exception(pool);
+    test_reduce(pool);
+    test_sort(pool);
+    test_nested(pool);
+}
@@ -0,0 +1,96 @@
+#include <priority_task_queue_thread.h>
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <thread>
+
+using flyzero::priority_task_queue_thread;
+using namespace std::chrono;
+
+// 让工作线程停在一个任务上，以便其余任务在队列中积压
+class gate {
+public:
+    void block(priority_task_queue_thread &thread) {
+        open_    = false;
+        started_ = false;
+        while (!thread.push(0, [this] {
+            started_ = true;
+            while (!open_) std::this_thread::yield();
+        })) {
+            std::this_thread::yield();
+        }
+        while (!started_) std::this_thread::yield();
+    }
+
+    void open() { open_ = true; }
+
+private:
+    std::atomic<bool> open_{false};
+    std::atomic<bool> started_{false};
+};
+
+// 等待工作线程退出
+static void stop(priority_task_queue_thread &thread) {
+    while (!thread.push(thread.get_priority_count() - 1, [] { return false; })) {
+        std::this_thread::yield();
+    }
+    thread.join();
+}
+
+// 测试加权轮转
+void test_weighted() {
+    priority_task_queue_thread::options opts;
+    opts.weights = {3, 1};
+    priority_task_queue_thread thread{opts};
+
+    gate g;
+    g.block(thread);
+
+    std::string order;
+    for (int i = 0; i < 6; ++i) assert(thread.push(0, [&order] { order += 'H'; }));
+    for (int i = 0; i < 3; ++i) assert(thread.push(1, [&order] { order += 'L'; }));
+    g.open();
+    stop(thread);
+
+    // 阻塞任务消耗了第一轮的一个高优先级配额
+    assert(order == "HHLHHHLHL");
+    assert(thread.get_processed_task_num(0) == 7);
+    assert(thread.get_processed_task_num(1) == 4);
+    assert(thread.get_queue_time(0).count() == 7);
+    assert(thread.get_queue_time(1).count() == 4);
+}
+
+// 测试丢弃过期任务与提前执行临近截止时间的任务
+void test_deadline() {
+    priority_task_queue_thread::options opts;
+    opts.weights = {2, 1};
+    opts.urgency = seconds{10};
+    priority_task_queue_thread thread{opts};
+
+    gate g;
+    g.block(thread);
+
+    std::string order;
+    auto const  now = priority_task_queue_thread::clock::now();
+    assert(thread.push(0, [&order] { order += 'a'; }));
+    assert(thread.push(0, [&order] { order += 'b'; }));
+    assert(thread.push(1, now + milliseconds{1}, [&order] { order += 'x'; }));
+    assert(thread.push(1, now + seconds{5}, [&order] { order += 'u'; }));
+
+    // 等到第一个带截止时间的任务过期
+    std::this_thread::sleep_for(milliseconds{5});
+    g.open();
+    stop(thread);
+
+    assert(order == "uab");
+    assert(thread.get_shed_task_num(1) == 1);
+    assert(thread.get_promoted_task_num(1) == 1);
+    assert(thread.get_queue_time(1).max() >= 5000000);
+}
+
+int main() {
+    test_weighted();
+    test_deadline();
+}
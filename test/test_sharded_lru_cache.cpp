@@ -0,0 +1,217 @@
+#include <sharded_lru_cache.h>
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct Hash {
+    std::size_t operator()(const std::string &key) const {
+        return boost::hash_range(key.begin(), key.end());
+    }
+
+    std::size_t operator()(const char *key) const {
+        return boost::hash_range(key, key + std::strlen(key));
+    }
+};
+
+struct Equal {
+    bool operator()(const std::string &lhs, const std::string &rhs) const { return lhs == rhs; }
+
+    bool operator()(const std::string &lhs, const char *rhs) const { return lhs == rhs; }
+
+    bool operator()(const char *lhs, const std::string &rhs) const { return lhs == rhs; }
+};
+
+using Cache = flyzero::ShardedLruCache<std::string, int, Hash, Equal>;
+
+/**
+ * @brief 有状态的哈希函数，没有默认构造函数
+ */
+struct CountingHash {
+    explicit CountingHash(size_t *calls) : calls_(calls) {}
+
+    std::size_t operator()(int key) const {
+        ++*calls_;
+        return std::hash<int>{}(key);
+    }
+
+    size_t *calls_;
+};
+
+/**
+ * @brief 有状态的比较函数，没有默认构造函数
+ */
+struct CountingEqual {
+    explicit CountingEqual(size_t *calls) : calls_(calls) {}
+
+    bool operator()(int lhs, int rhs) const {
+        ++*calls_;
+        return lhs == rhs;
+    }
+
+    size_t *calls_;
+};
+
+/**
+ * @brief 有状态的分配器，没有默认构造函数
+ */
+template <typename T>
+struct CountingAlloc {
+    using value_type = T;
+
+    explicit CountingAlloc(size_t *live) : live_(live) {}
+
+    template <typename U>
+    CountingAlloc(CountingAlloc<U> const &other) : live_(other.live_) {}
+
+    T *allocate(std::size_t n) {
+        ++*live_;
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T *p, std::size_t n) {
+        --*live_;
+        std::allocator<T>{}.deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(CountingAlloc<U> const &other) const {
+        return live_ == other.live_;
+    }
+
+    size_t *live_;
+};
+
+static void test_insert_find_erase() {
+    Cache cache{std::chrono::seconds{10}, 5};
+    assert(cache.shard_count() == 8);
+
+    auto const now = std::chrono::steady_clock::now();
+    assert(cache.insert(now, "hello", 1));
+    assert(!cache.insert(now, "hello", 2));
+
+    // 测试异构查询，回调中可以修改值
+    int value = 0;
+    assert(cache.find("hello", [&value](const std::string &, int &v) { value = v++; }));
+    assert(value == 1);
+    assert(cache.find(now, std::string{"hello"}, [&value](const std::string &k, int &v) {
+        assert(k == "hello");
+        value = v;
+    }));
+    assert(value == 2);
+    assert(!cache.find("world", [](const std::string &, int &) { assert(false); }));
+
+    assert(cache.touch(now, "hello"));
+    assert(!cache.touch(now, "world"));
+
+    assert(cache.erase("hello"));
+    assert(!cache.erase("hello"));
+    assert(cache.size() == 0);
+}
+
+static void test_expired() {
+    Cache cache{std::chrono::seconds{1}, 4};
+
+    auto const start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 100; ++i) {
+        cache.insert(start + std::chrono::milliseconds{i * 10}, std::to_string(i), i);
+    }
+
+    // 访问过的元素顺延超时时间
+    assert(cache.touch(start + std::chrono::milliseconds{500}, "0"));
+
+    // 逐个分片清理，与一次清理全部分片的结果相同
+    auto const now = start + std::chrono::milliseconds{1495};
+    size_t     n   = 0;
+    long       sum = 0;
+    for (size_t i = 0; i < cache.shard_count(); ++i) {
+        n += cache.clear_expired(i, now, [&sum](const std::string &, int v) { sum += v; });
+    }
+    assert(n == 49);
+    assert(sum == 49 * 50 / 2);
+    assert(cache.find("0", [](const std::string &, int &) {}));
+
+    assert(cache.clear_expired(start + std::chrono::seconds{10}) == 51);
+    assert(cache.size() == 0);
+}
+
+// 多个线程同时读写不同的键，另一个线程不断清理
+static void test_threads() {
+    auto constexpr threads = 4;
+    auto constexpr keys    = 20000;
+
+    Cache             cache{std::chrono::hours{1}, 16};
+    std::atomic<bool> stop{false};
+    std::thread       sweeper{[&] {
+        while (!stop) cache.clear_expired(std::chrono::steady_clock::now());
+    }};
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&cache, t] {
+            auto const now = std::chrono::steady_clock::now();
+            for (int i = 0; i < keys; ++i) {
+                auto const key = std::to_string(t) + ":" + std::to_string(i);
+                assert(cache.insert(now, key, i));
+                int v = -1;
+                assert(cache.find(now, key.c_str(), [&v](const std::string &, int &value) {
+                    v = value;
+                }));
+                assert(v == i);
+                if (i % 2 == 0) assert(cache.erase(key));
+            }
+        });
+    }
+
+    for (auto &w : workers) w.join();
+    stop = true;
+    sweeper.join();
+
+    assert(cache.size() == threads * keys / 2);
+}
+
+// 哈希函数、比较函数和分配器复制到每个分片
+static void test_stateful() {
+    using StatefulCache = flyzero::ShardedLruCache<int,
+                                                   int,
+                                                   CountingHash,
+                                                   CountingEqual,
+                                                   CountingAlloc<std::pair<int, int>>>;
+
+    size_t hash_calls  = 0;
+    size_t equal_calls = 0;
+    size_t live        = 0;
+
+    StatefulCache cache{std::chrono::seconds{10},
+                        4,
+                        CountingHash{&hash_calls},
+                        CountingEqual{&equal_calls},
+                        CountingAlloc<std::pair<int, int>>{&live}};
+
+    // 每个分片的桶数组由传入的分配器分配
+    assert(live == cache.shard_count());
+
+    auto const now = std::chrono::steady_clock::now();
+    for (int i = 0; i < 4; ++i) assert(cache.insert(now, i, i));
+    assert(live == cache.shard_count() + 4);
+
+    // 选择分片和分片内查找都使用传入的哈希函数
+    hash_calls = 0;
+    assert(cache.find(2, [](int, int &v) { assert(v == 2); }));
+    assert(hash_calls == 2);
+    assert(equal_calls > 0);
+
+    assert(cache.erase(2));
+    assert(live == cache.shard_count() + 3);
+}
+
+int main() {
+    test_insert_find_erase();
+    test_expired();
+    test_threads();
+    test_stateful();
+}
@@ -0,0 +1,121 @@
+#include <spsc_queue.h>
+
+#include <array>
+#include <cassert>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// 统计存活对象个数
+struct counted {
+    static int alive;
+
+    explicit counted(int v = 0) : value{v} { ++alive; }
+    counted(counted &&other) noexcept : value{other.value} { ++alive; }
+    counted &operator=(counted &&other) noexcept {
+        value = other.value;
+        return *this;
+    }
+    ~counted() { --alive; }
+
+    int value;
+};
+
+int counted::alive = 0;
+
+// 测试单线程下的容量与批量操作
+void test_basic() {
+    {
+        flyzero::spsc_queue<counted> q{5};
+        assert(q.capacity() == 8);
+        assert(q.empty());
+
+        // 单个写入直到写满
+        for (int i = 0; i < 3; ++i) assert(q.try_push(i));
+
+        // 批量写入只写入剩余空间
+        std::vector<counted> src;
+        for (int i = 3; i < 10; ++i) src.emplace_back(i);
+        assert(q.try_push_n(src.begin(), src.size()) == 5);
+        assert(q.size() == 8);
+        assert(!q.try_push(100));
+        assert(q.try_push_n(src.begin(), src.size()) == 0);
+
+        // 批量读出
+        std::array<counted, 6> dst;
+        assert(q.try_pop_n(dst.begin(), dst.size()) == 6);
+        for (int i = 0; i < 6; ++i) assert(dst[i].value == i);
+
+        // 写入跨越数组末尾
+        assert(q.try_push_n(src.begin() + 5, 2) == 2);
+
+        counted c;
+        for (int i = 6; i < 10; ++i) {
+            assert(q.try_pop(c));
+            assert(c.value == i);
+        }
+        assert(!q.try_pop(c));
+        assert(q.try_pop_n(dst.begin(), dst.size()) == 0);
+
+        // 查看并销毁队首元素
+        assert(!q.front());
+        assert(q.try_push(7));
+        assert(q.front() && q.front()->value == 7);
+        q.pop();
+        assert(!q.front());
+
+        // 剩余元素由析构函数销毁
+        assert(q.try_push(42));
+        assert(q.try_push(43));
+    }
+    assert(counted::alive == 0);
+}
+
+// 测试只能移动的元素
+void test_move_only() {
+    flyzero::spsc_queue<std::unique_ptr<int>> q{4};
+    assert(q.try_push(new int{1}));
+    assert(q.try_push(std::make_unique<int>(2)));
+
+    std::unique_ptr<int> p;
+    assert(q.try_pop(p) && *p == 1);
+    assert(q.try_pop(p) && *p == 2);
+}
+
+// 测试两个线程批量读写的顺序
+void test_threads() {
+    auto constexpr N = 1000000;
+    flyzero::spsc_queue<int> q{256};
+
+    std::thread producer([&q] {
+        std::array<int, 16> batch;
+        for (int i = 0; i < N;) {
+            auto const n = std::min<size_t>(batch.size(), N - i);
+            for (size_t j = 0; j < n; ++j) batch[j] = i + static_cast<int>(j);
+
+            // 写满时等待消费者
+            size_t pushed = 0;
+            while (pushed < n) {
+                pushed += q.try_push_n(batch.begin() + pushed, n - pushed);
+                if (pushed < n) std::this_thread::yield();
+            }
+            i += static_cast<int>(n);
+        }
+    });
+
+    std::array<int, 32> batch;
+    for (int expect = 0; expect < N;) {
+        auto const n = q.try_pop_n(batch.begin(), batch.size());
+        if (n == 0) std::this_thread::yield();
+        for (size_t j = 0; j < n; ++j) assert(batch[j] == expect++);
+    }
+
+    producer.join();
+    assert(q.empty());
+}
+
+int main() {
+    test_basic();
+    test_move_only();
+    test_threads();
+}
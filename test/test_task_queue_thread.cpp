@@ -0,0 +1,210 @@
+#include <task_queue_thread.h>
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+
+using flyzero::task_queue_thread;
+
+static std::atomic<int> allocated{0};
+static std::atomic<int> deallocated{0};
+
+static void *counting_alloc(std::size_t size) {
+    ++allocated;
+    return std::malloc(size);
+}
+
+static void counting_free(void *p) {
+    ++deallocated;
+    std::free(p);
+}
+
+// 测试小闭包内联存放，大闭包从分配器分配
+void test_small_task() {
+    using function = flyzero::small_task<int(int)>;
+    function::allocator_type const   alloc   = counting_alloc;
+    function::deallocator_type const dealloc = counting_free;
+    allocated = deallocated = 0;
+
+    auto const base = 10;
+    function   small{[base](int x) { return base + x; }, alloc, dealloc};
+    assert(allocated == 0);
+    assert(small(1) == 11);
+
+    std::array<int, 32> big_capture{};
+    big_capture[31] = 100;
+    function big{[big_capture](int x) { return big_capture[31] + x; }, alloc, dealloc};
+    assert(allocated == 1);
+    assert(big(1) == 101);
+
+    // 移动不重新分配
+    function moved{std::move(big)};
+    assert(!big && moved);
+    assert(moved(2) == 102);
+    assert(allocated == 1);
+
+    // 只能移动的捕获
+    auto     p = std::make_unique<int>(5);
+    function owner{[p = std::move(p)](int x) { return *p * x; }, alloc, dealloc};
+    assert(owner(3) == 15);
+
+    small = std::move(owner);
+    assert(small(2) == 10);
+
+    moved.reset();
+    assert(deallocated == 1);
+
+    // 直接传入函数指针，释放器是构造时的临时对象
+    {
+        function temporary{[big_capture](int x) { return big_capture[31] * x; }, counting_alloc,
+                           counting_free};
+        assert(temporary(2) == 200);
+    }
+    assert(allocated == 2 && deallocated == 2);
+}
+
+// 测试向任务队列线程提交可调用对象
+void test_push_callable() {
+    allocated = deallocated = 0;
+
+    auto constexpr N = 10000;
+    long sum = 0;
+    task_queue_thread thread{64, counting_alloc, counting_free};
+    auto const queue_allocations = allocated.load();
+
+    for (int i = 0; i < N; ++i) {
+        while (!thread.push([&sum, i] { sum += i; })) std::this_thread::yield();
+    }
+
+    // 不捕获线程对象、返回 bool 的形式
+    std::array<char, 128> big{};
+    big[0] = 1;
+    while (!thread.push([&sum, big](task_queue_thread &) { sum += big[0]; return true; })) {
+        std::this_thread::yield();
+    }
+    while (!thread.push([](task_queue_thread &) { return false; })) std::this_thread::yield();
+    thread.join();
+
+    assert(sum == long{N} * (N - 1) / 2 + 1);
+    assert(thread.get_processed_task_num() == N + 2);
+
+    // 只有大闭包分配了内存
+    assert(allocated == queue_allocations + 1);
+}
+
+// 测试兼容的任务接口
+class stop_task : public task_queue_thread::task {
+public:
+    explicit stop_task(int &runs) : runs_{runs} {}
+
+    bool run(task_queue_thread &) override {
+        ++runs_;
+        return false;
+    }
+
+private:
+    int &runs_;
+};
+
+void test_push_task() {
+    static int deleted = 0;
+    int        runs    = 0;
+    {
+        task_queue_thread thread{4};
+        assert(thread.push(new stop_task{runs}, [](task_queue_thread::task *th) {
+            delete th;
+            ++deleted;
+        }));
+        thread.join();
+    }
+    assert(runs == 1 && deleted == 1);
+}
+
+// 测试计数器与直方图
+void test_metrics() {
+    task_queue_thread thread{4};
+    thread.enable_metrics(true);
+
+    // 阻塞工作线程，使队列写满
+    std::atomic<bool> started{false};
+    std::atomic<bool> release{false};
+    assert(thread.push([&] {
+        started = true;
+        while (!release) std::this_thread::yield();
+    }));
+    while (!started) std::this_thread::yield();
+
+    for (int i = 0; i < 4; ++i) {
+        assert(thread.push([] { std::this_thread::sleep_for(std::chrono::microseconds{100}); }));
+    }
+    assert(!thread.push([] {}));
+    assert(thread.get_pushed_task_num() == 5);
+    assert(thread.get_rejected_task_num() == 1);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    release = true;
+
+    // 关闭后提交的任务不再计入直方图
+    while (thread.get_processed_task_num() < 5) std::this_thread::yield();
+    thread.enable_metrics(false);
+    while (!thread.push([] { return false; })) std::this_thread::yield();
+    thread.join();
+
+    assert(thread.get_processed_task_num() == 6);
+    assert(thread.get_wait_time().count() == 5);
+    assert(thread.get_wait_time().max() >= 1000000);
+    assert(thread.get_run_time().count() == 5);
+    assert(thread.get_run_time().max() >= 1000000);
+    assert(thread.get_run_time().min() >= 100000);
+
+    // 第二批一次取出积压的 4 个任务
+    assert(thread.get_queue_depth().max() == 4);
+    assert(thread.get_batch_num() >= 3);
+}
+
+// 开启统计时提交失败，任务仍归调用者所有
+void test_metrics_rejected() {
+    static int deleted = 0;
+    auto const deleter = [](task_queue_thread::task *th) {
+        delete th;
+        ++deleted;
+    };
+
+    task_queue_thread thread{2};
+    thread.enable_metrics(true);
+
+    std::atomic<bool> started{false};
+    std::atomic<bool> release{false};
+    assert(thread.push([&] {
+        started = true;
+        while (!release) std::this_thread::yield();
+    }));
+    while (!started) std::this_thread::yield();
+    assert(thread.push([] {}));
+    assert(thread.push([] {}));
+
+    int  runs = 0;
+    auto th   = new stop_task{runs};
+    assert(!thread.push(th, deleter));
+    assert(deleted == 0);
+    assert(thread.get_rejected_task_num() == 1);
+
+    // 调用者可以重新提交同一个任务
+    release = true;
+    while (!thread.push(th, deleter)) std::this_thread::yield();
+    thread.join();
+
+    assert(runs == 1 && deleted == 1);
+}
+
+int main() {
+    test_small_task();
+    test_push_callable();
+    test_push_task();
+    test_metrics();
+    test_metrics_rejected();
+}
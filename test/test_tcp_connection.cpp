@@ -0,0 +1,153 @@
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <tcp_connection.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+constexpr size_t const buffer_size  = 1 << 16;  ///< 连接的读写缓冲区大小
+constexpr size_t const message_size = 64;       ///< 每轮发送的字节数
+constexpr int const    rounds       = 32;       ///< 往返轮数
+
+/**
+ * @brief 回显收到的数据
+ */
+class echo_connection : public flyzero::tcp_connection {
+public:
+    using tcp_connection::tcp_connection;
+
+protected:
+    size_t on_read(const void *data, size_t size) override { return send(data, size); }
+
+    size_t on_write(void *, size_t) override { return 0; }
+
+    void on_close() override { assert(false); }
+};
+
+/**
+ * @brief 发送数据并统计收到的回显
+ */
+class client_connection : public flyzero::tcp_connection {
+public:
+    using tcp_connection::tcp_connection;
+
+    size_t received{0};  ///< 收到的字节数
+
+    void ping() {
+        char data[message_size];
+        std::memset(data, 'x', sizeof data);
+        auto const n = send(data, sizeof data);
+        assert(n == sizeof data);
+    }
+
+protected:
+    size_t on_read(const void *, size_t size) override {
+        received += size;
+        return size;
+    }
+
+    size_t on_write(void *, size_t) override { return 0; }
+
+    void on_close() override { assert(false); }
+};
+
+void set_nonblocking(int sock) {
+    auto const flags = ::fcntl(sock, F_GETFL);
+    auto err         = ::fcntl(sock, F_SETFL, flags | O_NONBLOCK);
+    assert(err == 0);
+
+    int const on = 1;
+    err          = ::setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    assert(err == 0);
+}
+
+/**
+ * @brief 建立一对回环 TCP 连接
+ */
+void connect_pair(int &client, int &server) {
+    flyzero::file_descriptor const listener{::socket(AF_INET, SOCK_STREAM, 0)};
+    assert(listener);
+
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    auto err = ::bind(listener.get(), reinterpret_cast<sockaddr *>(&addr), sizeof addr);
+    assert(err == 0);
+
+    socklen_t addrlen = sizeof addr;
+    err = ::getsockname(listener.get(), reinterpret_cast<sockaddr *>(&addr), &addrlen);
+    assert(err == 0);
+
+    err = ::listen(listener.get(), 1);
+    assert(err == 0);
+
+    client = ::socket(AF_INET, SOCK_STREAM, 0);
+    assert(client >= 0);
+    err = ::connect(client, reinterpret_cast<sockaddr *>(&addr), sizeof addr);
+    assert(err == 0);
+
+    server = ::accept(listener.get(), nullptr, nullptr);
+    assert(server >= 0);
+
+    set_nonblocking(client);
+    set_nonblocking(server);
+}
+
+}  // namespace
+
+// 测试启用时间戳后各时延直方图都有记录
+static void test_latency() {
+    int client_sock;
+    int server_sock;
+    connect_pair(client_sock, server_sock);
+
+    client_connection client{client_sock, buffer_size, buffer_size};
+    echo_connection   server{server_sock, buffer_size, buffer_size};
+    assert(client.latency() == nullptr);
+    assert(client.enable_timestamping());
+    assert(server.enable_timestamping());
+
+    auto const stats = client.latency();
+    assert(stats != nullptr);
+    assert(server.latency() != nullptr);
+
+    flyzero::event_dispatch dispatch;
+    dispatch.register_io_listener(client, flyzero::event_dispatch::event::read);
+    dispatch.register_io_listener(server, flyzero::event_dispatch::event::read);
+
+    // 逐轮往返；确认时间戳在对端确认后才产生，收到全部回显后继续等待
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    for (int i = 0; i < rounds; ++i) {
+        client.ping();
+        while (client.received < (i + 1) * message_size &&
+               std::chrono::steady_clock::now() < deadline) {
+            dispatch.run_once(std::chrono::milliseconds{10});
+        }
+    }
+
+    while (stats->handler_to_ack.count() < rounds && std::chrono::steady_clock::now() < deadline) {
+        dispatch.run_once(std::chrono::milliseconds{10});
+    }
+
+    assert(client.received == rounds * message_size);
+    assert(stats->kernel_to_handler.count() > 0);
+    assert(stats->handler_to_sched.count() > 0);
+    assert(stats->handler_to_wire.count() > 0);
+    assert(stats->handler_to_ack.count() == rounds);
+    assert(server.latency()->kernel_to_handler.count() > 0);
+
+    // 时间戳与处理时间同一时钟，时延不会大于整个测试的时长
+    assert(stats->handler_to_ack.max() < 5000000000ull);
+
+    dispatch.unregister_io_listener(client);
+    dispatch.unregister_io_listener(server);
+}
+
+int main() {
+    test_latency();
+}
@@ -0,0 +1,189 @@
+#include <thread_pool.h>
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <thread>
+
+using flyzero::thread_pool;
+
+static std::atomic<long> deleted{0};
+
+static void delete_task(thread_pool::task *th) {
+    delete th;
+    ++deleted;
+}
+
+// 等待线程池执行完 n 个任务
+static void wait_processed(thread_pool &pool, size_t n) {
+    while (pool.get_processed_task_num() < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+}
+
+// 累加任务
+class add_task : public thread_pool::task {
+public:
+    add_task(std::atomic<long> &sum, long value) : sum_{sum}, value_{value} {}
+
+    bool run(thread_pool &) override {
+        sum_ += value_;
+        return true;
+    }
+
+private:
+    std::atomic<long> &sum_;
+    long               value_;
+};
+
+// 递归展开的任务，在工作线程内提交子任务
+class tree_task : public thread_pool::task {
+public:
+    tree_task(std::atomic<long> &nodes, int depth) : nodes_{nodes}, depth_{depth} {}
+
+    bool run(thread_pool &pool) override {
+        ++nodes_;
+        if (depth_ > 0) {
+            for (int i = 0; i < 2; ++i) {
+                auto const child = new tree_task{nodes_, depth_ - 1};
+                while (!pool.push(child, delete_task)) std::this_thread::yield();
+            }
+        }
+        return true;
+    }
+
+private:
+    std::atomic<long> &nodes_;
+    int                depth_;
+};
+
+// 停止线程池的任务
+class stop_task : public thread_pool::task {
+public:
+    bool run(thread_pool &) override { return false; }
+};
+
+// 测试外部线程提交
+void test_external() {
+    thread_pool::options opts;
+    opts.thread_count   = 4;
+    opts.queue_capacity = 64;
+    thread_pool pool{opts};
+    assert(pool.get_thread_count() == 4);
+
+    auto constexpr N = 100000;
+    std::atomic<long> sum{0};
+    for (long i = 0; i < N; ++i) {
+        auto const th = new add_task{sum, i};
+        while (!pool.push(th, delete_task)) std::this_thread::yield();
+    }
+
+    wait_processed(pool, N);
+    assert(sum == long{N} * (N - 1) / 2);
+}
+
+// 测试工作线程内提交与窃取，本地队列很小，溢出到注入队列
+void test_nested() {
+    thread_pool::options opts;
+    opts.thread_count   = 3;
+    opts.deque_capacity = 8;
+    thread_pool pool{opts};
+
+    auto constexpr depth = 14;
+    std::atomic<long> nodes{0};
+    assert(pool.push(new tree_task{nodes, depth}, delete_task));
+
+    long const total = (1L << (depth + 1)) - 1;
+    wait_processed(pool, total);
+    assert(nodes == total);
+}
+
+// 测试任务停止线程池，未执行的任务在析构时释放
+void test_stop() {
+    deleted = 0;
+    std::atomic<long> sum{0};
+    {
+        thread_pool::options opts;
+        opts.thread_count = 2;
+        thread_pool pool{opts};
+        assert(pool.push(new stop_task, delete_task));
+        pool.join();
+
+        // 停止后提交失败，所有权仍归调用者
+        auto const th = new add_task{sum, 1};
+        assert(!pool.push(th, delete_task));
+        delete_task(th);
+    }
+    assert(deleted == 2);
+}
+
+// 测试空闲线程休眠后仍能及时被唤醒
+void test_idle_wakeup() {
+    thread_pool::options opts;
+    opts.thread_count = 2;
+    thread_pool pool{opts};
+
+    std::atomic<long> sum{0};
+    for (int i = 1; i <= 20; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{2});
+        assert(pool.push(new add_task{sum, 1}, delete_task));
+        wait_processed(pool, i);
+    }
+    assert(sum == 20);
+}
+
+// 阻塞工作线程直到放行
+class block_task : public thread_pool::task {
+public:
+    explicit block_task(std::atomic<bool> &release) : release_{release} {}
+
+    bool run(thread_pool &) override {
+        while (!release_) std::this_thread::yield();
+        return true;
+    }
+
+private:
+    std::atomic<bool> &release_;
+};
+
+// 测试注入队列满时 push 立即失败，push_for 等待工作线程腾出空间
+void test_back_pressure() {
+    thread_pool::options opts;
+    opts.thread_count   = 1;
+    opts.queue_capacity = 4;
+    thread_pool pool{opts};
+
+    std::atomic<bool> release{false};
+    assert(pool.push(new block_task{release}, delete_task));
+    while (pool.get_current_task_num() != 0) std::this_thread::yield();
+
+    // 唯一的工作线程被阻塞，写满注入队列
+    std::atomic<long> sum{0};
+    for (int i = 0; i < 4; ++i) assert(pool.push(new add_task{sum, 1}, delete_task));
+
+    auto const th = new add_task{sum, 1};
+    assert(!pool.push(th, delete_task));
+
+    auto const start = std::chrono::steady_clock::now();
+    assert(!pool.push_for(th, delete_task, std::chrono::milliseconds{10}));
+    assert(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds{10});
+
+    // 放行后工作线程取走任务，等待中的提交成功
+    std::thread releaser{[&release] {
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        release = true;
+    }};
+    assert(pool.push_for(th, delete_task, std::chrono::seconds{10}));
+    releaser.join();
+
+    wait_processed(pool, 6);
+    assert(sum == 5);
+}
+
+int main() {
+    test_external();
+    test_nested();
+    test_stop();
+    test_idle_wakeup();
+    test_back_pressure();
+}
@@ -0,0 +1,118 @@
+#include <udp_socket.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+class receiver : public flyzero::udp_socket {
+public:
+    using udp_socket::udp_socket;
+
+    std::vector<std::vector<char>> datagrams;  ///< 收到的报文
+    uint16_t                       port{0};    ///< 最后一个报文的发送方端口
+    in_addr                        ip{};       ///< 最后一个报文的发送方地址
+    size_t                         batches{0};  ///< 批次数
+
+protected:
+    void on_datagram(const datagram &dgram) override {
+        auto const p = static_cast<const char *>(dgram.data());
+        datagrams.emplace_back(p, p + dgram.size());
+        assert(dgram.family() == AF_INET);
+        ip   = dgram.ipv4().in_addr();
+        port = dgram.port();
+    }
+
+    void on_batch_end() override { ++batches; }
+};
+
+class sender : public flyzero::udp_socket {
+public:
+    using udp_socket::udp_socket;
+
+protected:
+    void on_datagram(const datagram &) override {}
+};
+
+static sockaddr_in local_addr(int sock) {
+    sockaddr_in addr{};
+    socklen_t   addrlen = sizeof addr;
+    auto const  err     = ::getsockname(sock, reinterpret_cast<sockaddr *>(&addr), &addrlen);
+    assert(err == 0);
+    return addr;
+}
+
+static void run_until(flyzero::event_dispatch &dispatch, receiver &r, size_t n) {
+    auto const deadline = std::chrono::steady_clock::now() + std::chrono::seconds{5};
+    while (r.datagrams.size() < n && std::chrono::steady_clock::now() < deadline) {
+        dispatch.run_once(std::chrono::milliseconds{10});
+    }
+}
+
+// 测试批量收发
+static void test_batch() {
+    flyzero::event_dispatch dispatch;
+
+    receiver r{flyzero::udp_socket::bind(INADDR_LOOPBACK, 0), {8, 2048, false}};
+    sender   s{flyzero::udp_socket::bind(INADDR_LOOPBACK, 0), {8, 2048, false}};
+    dispatch.register_io_listener(r, flyzero::event_dispatch::event::read);
+
+    auto const to   = local_addr(r.fd());
+    auto const from = local_addr(s.fd());
+
+    // 发送超过一批的报文，队列满时自动 flush
+    constexpr int N = 100;
+    for (int i = 0; i < N; ++i) {
+        auto const ok = s.send(&i, sizeof i, reinterpret_cast<const sockaddr *>(&to), sizeof to);
+        assert(ok);
+    }
+    s.flush();
+    assert(s.pending() == 0);
+
+    run_until(dispatch, r, N);
+    assert(r.datagrams.size() == N);
+    for (int i = 0; i < N; ++i) {
+        int v;
+        assert(r.datagrams[i].size() == sizeof v);
+        std::memcpy(&v, r.datagrams[i].data(), sizeof v);
+        assert(v == i);
+    }
+
+    // 批次数应远少于报文数
+    assert(r.batches < N);
+    assert(r.port == ntohs(from.sin_port));
+    assert(r.ip.s_addr == htonl(INADDR_LOOPBACK));
+}
+
+// 测试 GSO 发送与 GRO 接收
+static void test_segment(bool gro) {
+    flyzero::event_dispatch dispatch;
+
+    receiver r{flyzero::udp_socket::bind(INADDR_LOOPBACK, 0), {8, 65536, gro}};
+    sender   s{flyzero::udp_socket::bind(INADDR_LOOPBACK, 0), {8, 65536, false}};
+    dispatch.register_io_listener(r, flyzero::event_dispatch::event::read);
+
+    auto const to = local_addr(r.fd());
+
+    // 10 个 1000 字节的报文加一个 500 字节的尾报文
+    std::vector<char> data(10500);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<char>(i / 1000);
+
+    auto const ok =
+        s.send(data.data(), data.size(), 1000, reinterpret_cast<const sockaddr *>(&to), sizeof to);
+    assert(ok);
+    if (s.flush() == 0) return;  // 内核不支持 UDP_SEGMENT
+
+    run_until(dispatch, r, 11);
+    assert(r.datagrams.size() == 11);
+    for (size_t i = 0; i < r.datagrams.size(); ++i) {
+        assert(r.datagrams[i].size() == (i < 10 ? 1000 : 500));
+        assert(r.datagrams[i][0] == static_cast<char>(i));
+    }
+}
+
+int main() {
+    test_batch();
+    test_segment(false);
+    test_segment(true);
+}